@@ -21,6 +21,7 @@
 #include "nuclear_bits/extension/ChronoController.hpp"
 #include "nuclear_bits/extension/IOController.hpp"
 #include "nuclear_bits/extension/NetworkController.hpp"
+#include "nuclear_bits/extension/TCPController.hpp"
 
 namespace NUClear {
 
@@ -40,6 +41,7 @@ PowerPlant::PowerPlant(Configuration config, int argc, const char* argv[]) : con
     install<extension::ChronoController>();
     install<extension::IOController>();
     install<extension::NetworkController>();
+    install<extension::TCPController>();
 
     // Emit our arguments if any.
     message::CommandLineArguments args;
@@ -36,8 +36,21 @@ namespace extension {
             {
                 std::lock_guard<std::mutex> lock(mutex);
 
-                // Add our new task to the heap
-                tasks.push_back(*task);
+                // A task with an id we already have replaces that task so timers can be moved without piling up
+                // Tasks that remove themselves use an id of -1 and so are always added
+                auto it = task->id == uint64_t(-1)
+                              ? tasks.end()
+                              : std::find_if(tasks.begin(), tasks.end(), [&](const ChronoTask& t) {
+                                    return t.id == task->id;
+                                });
+
+                if (it != tasks.end()) {
+                    *it = *task;
+                }
+                // Otherwise add our new task to the heap
+                else {
+                    tasks.push_back(*task);
+                }
             }
 
             // Poke the system
@@ -74,14 +74,11 @@ namespace extension {
                 // Lock our mutex to avoid concurrent modification
                 std::lock_guard<std::mutex> lock(reaction_mutex);
 
-                // Find our reaction
-                auto reaction = std::find_if(std::begin(reactions), std::end(reactions), [&unbind](const Task& t) {
-                    return t.reaction->id == unbind.id;
-                });
-
-                if (reaction != std::end(reactions)) {
-                    reactions.erase(reaction);
-                }
+                // Remove our reaction, it may be watching more than one file descriptor
+                reactions.erase(std::remove_if(std::begin(reactions),
+                                               std::end(reactions),
+                                               [&unbind](const Task& t) { return t.reaction->id == unbind.id; }),
+                                std::end(reactions));
 
                 // Let the poll command know that stuff happened
                 dirty = true;
@@ -145,57 +142,57 @@ namespace extension {
                             // It's a regular handle
                             else {
 
-                                // Find our relevant reactions
-                                auto range = std::equal_range(std::begin(reactions),
-                                                              std::end(reactions),
-                                                              Task{fd.fd, 0, nullptr},
-                                                              [](const Task& a, const Task& b) { return a.fd < b.fd; });
-
-
-                                // There are no reactions for this!
-                                if (range.first == std::end(reactions)) {
-                                    // If this happens then our list is definitely dirty...
-                                    dirty = true;
-                                }
-                                else {
-
-
-                                    // TODO(trent): we also want to swap this element to the back of the list and remove
-                                    // it so that it does not fire again
+                                // Find our relevant reactions, copying them out as reactions can be bound and
+                                // unbound by other threads while we are submitting tasks
+                                std::vector<std::shared_ptr<threading::Reaction>> interested;
+                                /* Mutex Scope */ {
+                                    std::lock_guard<std::mutex> lock(reaction_mutex);
 
+                                    auto range =
+                                        std::equal_range(std::begin(reactions),
+                                                         std::end(reactions),
+                                                         Task{fd.fd, 0, nullptr},
+                                                         [](const Task& a, const Task& b) { return a.fd < b.fd; });
 
-                                    // Loop through our values
                                     for (auto it = range.first; it != range.second; ++it) {
-
                                         // We should emit if the reaction is interested
                                         if ((it->events & fd.revents) != 0) {
+                                            interested.push_back(it->reaction);
+                                        }
+                                    }
 
-                                            // Make our event to pass through
-                                            IO::Event e{};
-                                            e.fd = fd.fd;
+                                    // There are no reactions for this!
+                                    if (range.first == range.second) {
+                                        // If this happens then our list is definitely dirty...
+                                        dirty = true;
+                                    }
+                                }
 
-                                            // Evaluate and store our set in thread store
-                                            e.events = fd.revents;
+                                // Loop through our values
+                                for (const auto& reaction : interested) {
 
-                                            // Store the event in our thread local cache
-                                            IO::ThreadEventStore::value = &e;
+                                    // Make our event to pass through
+                                    IO::Event e{};
+                                    e.fd = fd.fd;
 
-                                            // Submit the task (which should run the get)
-                                            try {
-                                                auto task = it->reaction->get_task();
-                                                if (task) {
-                                                    powerplant.submit(std::move(task));
-                                                }
-                                            }
-                                            catch (...) {
-                                            }
+                                    // Evaluate and store our set in thread store
+                                    e.events = fd.revents;
 
-                                            // Reset our value
-                                            IO::ThreadEventStore::value = nullptr;
+                                    // Store the event in our thread local cache
+                                    IO::ThreadEventStore::value = &e;
 
-                                            // TODO(trent): If we had a close, or error stop listening?
+                                    // Submit the task (which should run the get)
+                                    try {
+                                        auto task = reaction->get_task();
+                                        if (task) {
+                                            powerplant.submit(std::move(task));
                                         }
                                     }
+                                    catch (...) {
+                                    }
+
+                                    // Reset our value
+                                    IO::ThreadEventStore::value = nullptr;
                                 }
                             }
 
@@ -29,8 +29,9 @@ namespace extension {
     using message::NetworkConfiguration;
     using dsl::word::NetworkListen;
     using dsl::word::emit::NetworkEmit;
+    using dsl::operation::ChronoTask;
     using Unbind = dsl::operation::Unbind<dsl::word::NetworkListen>;
-    struct ProcessNetwork {};
+    struct RetransmitNetwork {};
 
 
     NetworkController::NetworkController(std::unique_ptr<NUClear::Environment> environment)
@@ -40,28 +41,36 @@ namespace extension {
         network.set_packet_callback([this](const network::NUClearNetwork::NetworkTarget& remote,
                                            const uint64_t& hash,
                                            const bool& reliable,
+                                           const std::chrono::steady_clock::time_point& received,
                                            std::vector<char>&& payload) {
 
             // Construct our NetworkSource information
-            dsl::word::NetworkSource src;
-            src.name     = remote.name;
-            src.address  = remote.target;
-            src.reliable = reliable;
+            auto src      = std::make_shared<dsl::word::NetworkSource>();
+            src->name     = remote.name;
+            src->address  = remote.target;
+            src->reliable = reliable;
 
-            // Store in our thread local cache
-            dsl::store::ThreadStore<std::vector<char>>::value        = &payload;
-            dsl::store::ThreadStore<dsl::word::NetworkSource>::value = &src;
+            // Move the time it arrived onto our clock by going back as long as it has been waiting
+            src->received   = NUClear::clock::now() - std::chrono::duration_cast<NUClear::clock::duration>(
+                                                          std::chrono::steady_clock::now() - received);
+            src->round_trip = std::chrono::duration_cast<NUClear::clock::duration>(remote.round_trip_time);
 
-            /* Mutex Scope */ {
-                // Lock our reaction mutex
-                std::lock_guard<std::mutex> lock(reaction_mutex);
+            // Every reaction shares the source and payload, and whatever the payload is deserialised into
+            dsl::word::NetworkMessage message;
+            message.source  = std::move(src);
+            message.payload = std::make_shared<const std::vector<char>>(std::move(payload));
+
+            // Store in our thread local cache
+            dsl::store::ThreadStore<dsl::word::NetworkMessage>::value = &message;
 
-                // Find interested reactions
-                auto rs = reactions.equal_range(hash);
+            // Find interested reactions in the current table, which can't change while we use it
+            auto table = std::atomic_load(&reactions);
+            auto rs    = table->find(hash);
 
-                // Execute on our interested reactions
-                for (auto it = rs.first; it != rs.second; ++it) {
-                    auto task = it->second->get_task();
+            // Execute on our interested reactions
+            if (rs != table->end()) {
+                for (const auto& reaction : *rs->second) {
+                    auto task = reaction->get_task();
                     if (task) {
                         powerplant.submit(std::move(task));
                     }
@@ -69,8 +78,7 @@ namespace extension {
             }
 
             // Clear our cache
-            dsl::store::ThreadStore<std::vector<char>>::value        = nullptr;
-            dsl::store::ThreadStore<dsl::word::NetworkSource>::value = nullptr;
+            dsl::store::ThreadStore<dsl::word::NetworkMessage>::value = nullptr;
 
         });
 
@@ -90,38 +98,113 @@ namespace extension {
             emit(l);
         });
 
+        // Set our progress callback
+        network.set_progress_callback([this](const network::NUClearNetwork::NetworkTarget& remote,
+                                             const uint64_t& hash,
+                                             const bool& sending,
+                                             const uint32_t& done,
+                                             const uint32_t& total) {
+            auto p     = std::make_unique<message::NetworkProgress>();
+            p->name    = remote.name;
+            p->address = remote.target;
+            p->hash    = hash;
+            p->sending = sending;
+            p->done    = done;
+            p->total   = total;
+            emit(p);
+        });
+
         // Set our event timer callback
         network.set_next_event_callback([this](std::chrono::steady_clock::time_point t) {
-            emit<Scope::DELAY>(std::make_unique<ProcessNetwork>(), t - std::chrono::steady_clock::now());
+
+            // If we are not configured yet there is nothing to wake up
+            uint64_t id = retransmit_id;
+            if (id == 0) {
+                return;
+            }
+
+            // Our chrono task shares the id of the retransmit reaction so each new time replaces the last one
+            auto task = std::make_unique<ChronoTask>(
+                [this](NUClear::clock::time_point&) {
+                    emit(std::make_unique<RetransmitNetwork>());
+                    return false;
+                },
+                NUClear::clock::now() + (t - std::chrono::steady_clock::now()),
+                id);
+
+            emit<Scope::DIRECT>(task);
         });
 
         // Start listening for a new network type
         on<Trigger<NetworkListen>>().then("Network Bind", [this](const NetworkListen& l) {
 
-            // Lock our reaction mutex
-            std::lock_guard<std::mutex> lock(reaction_mutex);
+            /* Mutex Scope */ {
+                // Lock our reaction mutex
+                std::lock_guard<std::mutex> lock(reaction_mutex);
+
+                // Copy the list for this hash with our new reaction added
+                auto table = std::make_shared<ReactionTable>(*reactions);
+                auto list  = std::make_shared<ReactionList>();
+                auto it    = table->find(l.hash);
+                if (it != table->end()) {
+                    *list = *it->second;
+                }
+                list->push_back(l.reaction);
+                (*table)[l.hash] = std::move(list);
+
+                // Packets use the new table from now on
+                reaction_hashes[l.reaction->id] = l.hash;
+                std::atomic_store(&reactions, std::shared_ptr<const ReactionTable>(std::move(table)));
+            }
 
-            // Insert our new reaction
-            reactions.insert(std::make_pair(l.hash, l.reaction));
+            // Let everyone know we want this type now
+            update_subscriptions();
         });
 
         // Stop listening for a network type
         on<Trigger<Unbind>>().then("Network Unbind", [this](const Unbind& unbind) {
 
-            // Lock our reaction mutex
-            std::lock_guard<std::mutex> lock(reaction_mutex);
+            /* Mutex Scope */ {
+                // Lock our reaction mutex
+                std::lock_guard<std::mutex> lock(reaction_mutex);
 
-            // Find and delete this reaction
-            for (auto it = reactions.begin(); it != reactions.end(); ++it) {
-                if (it->second->id == unbind.id) {
-                    reactions.erase(it);
-                    break;
+                // Find the list this reaction is in
+                auto id = reaction_hashes.find(unbind.id);
+                if (id == reaction_hashes.end()) {
+                    return;
+                }
+                uint64_t hash = id->second;
+                reaction_hashes.erase(id);
+
+                // Copy the list without this reaction, removing it entirely if it is now empty
+                auto table = std::make_shared<ReactionTable>(*reactions);
+                auto it    = table->find(hash);
+                if (it != table->end()) {
+                    auto list = std::make_shared<ReactionList>(*it->second);
+                    list->erase(std::remove_if(list->begin(),
+                                               list->end(),
+                                               [&](const std::shared_ptr<threading::Reaction>& r) {
+                                                   return r->id == unbind.id;
+                                               }),
+                                list->end());
+                    if (list->empty()) {
+                        table->erase(it);
+                    }
+                    else {
+                        it->second = std::move(list);
+                    }
                 }
+
+                // Packets use the new table from now on
+                std::atomic_store(&reactions, std::shared_ptr<const ReactionTable>(std::move(table)));
             }
+
+            // If that was the last reaction for this type we don't want it anymore
+            update_subscriptions();
         });
 
         on<Trigger<NetworkEmit>>().then("Network Emit", [this](const NetworkEmit& emit) {
-            network.send(emit.hash, emit.payload, emit.target, emit.reliable);
+            network.send(emit.hash, emit.payload, emit.target, emit.reliable, emit.compress, emit.latest);
         });
 
         on<Shutdown>().then("Shutdown Network", [this] { network.shutdown(); });
@@ -129,9 +212,17 @@ namespace extension {
         // Configure the NUClearNetwork options
         on<Trigger<NetworkConfiguration>>().then([this](const NetworkConfiguration& config) {
 
-            // Unbind our announce handle
-            if (process_handle) {
-                process_handle.unbind();
+            // Stop our retransmit timer
+            uint64_t id = retransmit_id.exchange(0);
+            if (id != 0) {
+                emit<Scope::DIRECT>(std::make_unique<dsl::operation::Unbind<ChronoTask>>(id));
+            }
+
+            // Unbind our timed handles
+            for (auto& h : {&announce_handle, &timeout_handle, &retransmit_handle}) {
+                if (*h) {
+                    h->unbind();
+                }
             }
 
             // Unbind all our listen handles
@@ -147,17 +238,62 @@ namespace extension {
             std::string announce_address = config.announce_address;
             in_port_t announce_port      = config.announce_port;
             uint16_t mtu                 = config.mtu;
+            uint16_t receive_sockets     = config.receive_sockets;
+            uint32_t compression         = config.compression_threshold;
+            uint16_t fec_block_size      = config.fec_block_size;
+            uint16_t duplicate_window    = config.duplicate_window;
+            uint16_t max_mtu             = config.max_mtu;
 
             // Reset our network using this configuration
-            network.reset(name, announce_address, announce_port, mtu);
-
-            // Execution handle
-            process_handle = on<Trigger<ProcessNetwork>>().then("Network processing", [this] { network.process(); });
-
+            network.reset(name,
+                          announce_address,
+                          announce_port,
+                          mtu,
+                          receive_sockets,
+                          compression,
+                          fec_block_size,
+                          duplicate_window,
+                          max_mtu);
+            network.set_assembler_limits(config.assembler_memory_per_target, config.assembler_memory_total);
+
+            // Make sure our subscriptions are ready to go out with our first announce
+            update_subscriptions();
+
+            // Our timed work each runs on its own schedule so receiving packets only has to process them
+            announce_handle = on<Every<500, std::chrono::milliseconds>>().then("Network announce", [this] {
+                network.announce();
+            });
+            timeout_handle = on<Every<500, std::chrono::milliseconds>>().then("Network timeouts", [this] {
+                network.check_timeouts();
+            });
+            retransmit_handle = on<Trigger<RetransmitNetwork>>().then("Network retransmit", [this] {
+                network.retransmit();
+            });
+            retransmit_id = retransmit_handle.context.lock()->id;
+
+            // Each socket gets its own reaction so they can be read at the same time
             for (auto& fd : network.listen_fds()) {
-                listen_handles.push_back(on<IO>(fd, IO::READ).then("Packet", [this] { network.process(); }));
+                listen_handles.push_back(on<IO>(fd, IO::READ).then("Packet", [this, fd] { network.process(fd); }));
             }
+
+            // Announce now rather than waiting for our first timer so others find us quickly
+            network.announce();
         });
     }
+
+    void NetworkController::update_subscriptions() {
+
+        // Binds and unbinds can race so make sure the last list we make is the last one we give the network
+        std::lock_guard<std::mutex> subscription_lock(subscription_mutex);
+
+        // Get the hashes that we have reactions for from the current table
+        std::vector<uint64_t> hashes;
+        auto table = std::atomic_load(&reactions);
+        for (const auto& r : *table) {
+            hashes.push_back(r.first);
+        }
+
+        network.set_subscriptions(std::move(hashes));
+    }
 }  // namespace extension
 }  // namespace NUClear
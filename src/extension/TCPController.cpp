@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nuclear_bits/extension/TCPController.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+namespace NUClear {
+namespace extension {
+
+    using dsl::word::TCP;
+    using dsl::word::emit::TCPWrite;
+    using Unbind = dsl::operation::Unbind<TCP::StreamListen>;
+
+    /// The size of the buffers we read stream data into
+    constexpr size_t BUFFER_SIZE = 65536;
+    /// If there is less than this much room left in a buffer we move to a new one before reading
+    constexpr size_t MINIMUM_READ = 4096;
+    /// The most queued buffers we will hand to the kernel in a single write
+    constexpr size_t MAX_WRITE_BUFFERS = 64;
+
+    /// Writes must never block the thread that emitted them or raise SIGPIPE when the remote has gone away
+#if defined(MSG_DONTWAIT) && defined(MSG_NOSIGNAL)
+    constexpr int WRITE_FLAGS = MSG_DONTWAIT | MSG_NOSIGNAL;
+#elif defined(MSG_DONTWAIT)
+    constexpr int WRITE_FLAGS = MSG_DONTWAIT;
+#else
+    constexpr int WRITE_FLAGS = 0;
+#endif
+
+    TCPController::TCPController(std::unique_ptr<NUClear::Environment> environment)
+        : Reactor(std::move(environment)) {
+
+        on<Trigger<TCP::StreamListen>>().then("TCP Stream Bind", [this](const TCP::StreamListen& listen) {
+
+            auto listener = std::make_shared<Listener>(listen);
+
+            // Lock our listener mutex
+            std::lock_guard<std::mutex> lock(listener_mutex);
+
+            listener->handle = on<IO>(listener->fd, IO::READ).then("TCP Stream Accept", [this, listener] {
+                accept(listener);
+            });
+
+            listeners.insert(std::make_pair(listen.reaction->id, listener));
+        });
+
+        on<Trigger<Unbind>>().then("TCP Stream Unbind", [this](const Unbind& unbind) {
+
+            // Lock our listener mutex
+            std::lock_guard<std::mutex> lock(listener_mutex);
+
+            auto it = listeners.find(unbind.id);
+            if (it != listeners.end()) {
+                auto& listener = *it->second;
+
+                // Stop accepting connections
+                listener.handle.unbind();
+                close(listener.fd);
+
+                // Close all the connections that were made
+                for (auto& connection : listener.connections) {
+                    disconnect(*connection.second);
+                }
+
+                listeners.erase(it);
+            }
+        });
+
+        on<Trigger<TCPWrite>>().then("TCP Write", [this](const TCPWrite& write) {
+
+            // Find the writer for this connection, if the one we find is removed before we can lock it look again
+            std::shared_ptr<Writer> writer;
+            std::unique_lock<std::mutex> lock;
+            do {
+                {
+                    std::lock_guard<std::mutex> writers_lock(writer_mutex);
+                    auto& w = writers[write.fd];
+                    if (!w) {
+                        w = std::make_shared<Writer>(write.fd);
+                    }
+                    writer = w;
+                }
+                lock = std::unique_lock<std::mutex>(writer->mutex);
+            } while (writer->closed);
+
+            writer->high_water_mark = write.high_water_mark;
+            writer->queue.push_back(write.payload);
+            writer->pending += write.payload->size();
+
+            // If nothing was waiting we can usually write it all out right now without involving the IO thread
+            if (writer->queue.size() == 1 && !flush(*writer)) {
+                remove(*writer);
+            }
+            else {
+                update(writer);
+            }
+        });
+    }
+
+    void TCPController::accept(const std::shared_ptr<Listener>& listener) {
+
+        // Lock our listener mutex
+        std::lock_guard<std::mutex> lock(listener_mutex);
+
+        // Accept connections until there are none left waiting. They are non blocking as more than one read task can
+        // be queued for a connection, and a read that finds nothing left must not hold up a thread
+        for (TCP::Connection c = TCP::accept(listener->fd, true); c; c = TCP::accept(listener->fd, true)) {
+
+            auto connection = std::make_shared<Connection>(c);
+            fd_t fd         = c.fd;
+
+            // Hold the connection lock until we have our handle so the reaction can't close the connection before it
+            // is able to unbind itself
+            std::lock_guard<std::mutex> connection_lock(connection->mutex);
+
+            connection->handle =
+                on<IO>(fd, IO::READ | IO::CLOSE).then("TCP Stream Read", [this, listener, connection] {
+
+                    // Read our data and if the remote went away or misbehaved clean up the connection
+                    if (!read(*listener, *connection)) {
+                        std::lock_guard<std::mutex> lock(listener_mutex);
+
+                        // Only clean up if we are still in our listener (we may have been unbound)
+                        auto it = listener->connections.find(connection->info.fd);
+                        if (it != listener->connections.end() && it->second == connection) {
+                            disconnect(*connection);
+                            listener->connections.erase(it);
+                        }
+                    }
+                });
+
+            listener->connections.insert(std::make_pair(fd, connection));
+        }
+    }
+
+    bool TCPController::read(const Listener& listener, Connection& connection) {
+
+        std::lock_guard<std::mutex> lock(connection.mutex);
+
+        // We have already been closed
+        if (connection.info.fd == INVALID_SOCKET) {
+            return true;
+        }
+
+        // Make sure we have enough room in our buffer to do a decent sized read
+        size_t pending = connection.end - connection.start;
+        if (!connection.buffer || connection.buffer->size() - connection.end < MINIMUM_READ) {
+
+            // If no frames are using our buffer we can move the partial frame to the front and keep using it
+            if (connection.buffer && connection.buffer.use_count() == 1
+                && connection.buffer->size() - pending >= MINIMUM_READ) {
+                std::memmove(connection.buffer->data(), connection.buffer->data() + connection.start, pending);
+            }
+            // Otherwise we move to a new buffer and only copy the partial frame across
+            else {
+                auto buffer = std::make_shared<std::vector<char>>(std::max(BUFFER_SIZE, pending * 2));
+                if (pending > 0) {
+                    std::memcpy(buffer->data(), connection.buffer->data() + connection.start, pending);
+                }
+                connection.buffer = buffer;
+            }
+
+            connection.start = 0;
+            connection.end   = pending;
+        }
+
+        // Read as much as we can fit in our buffer
+        ssize_t received = ::recv(connection.info.fd,
+                                  connection.buffer->data() + connection.end,
+                                  connection.buffer->size() - connection.end,
+                                  0);
+
+        // An orderly shutdown from the remote
+        if (received == 0) {
+            return false;
+        }
+        else if (received < 0) {
+            // If we were woken for no reason try again later, otherwise the connection is broken
+            return network_errno == EAGAIN || network_errno == EWOULDBLOCK || network_errno == EINTR;
+        }
+        connection.end += received;
+
+        // Trigger our reaction for every complete frame we now have
+        while (connection.start < connection.end) {
+
+            const char* data   = connection.buffer->data() + connection.start;
+            size_t available   = connection.end - connection.start;
+            TCP::Extent extent = listener.framer(data, available);
+
+            // The remote decides how big frames are, so rather than buffering whatever it asks for we drop any
+            // connection that sends a frame larger than we accept
+            if (extent.length > listener.max_frame
+                || (extent.consumed == 0 && available > extent.offset + listener.max_frame)) {
+                return false;
+            }
+
+            // The rest of this frame hasn't arrived yet
+            if (extent.consumed == 0) {
+                break;
+            }
+
+            // Our frame points into our buffer so we don't need to copy the data
+            TCP::Frame frame;
+            frame.connection = connection.info;
+            frame.payload    = std::shared_ptr<const char>(connection.buffer, data + extent.offset);
+            frame.length     = extent.length;
+            connection.start += extent.consumed;
+
+            // Store in our thread local cache
+            dsl::store::ThreadStore<TCP::Frame>::value = &frame;
+
+            auto task = listener.reaction->get_task();
+            if (task) {
+                powerplant.submit(std::move(task));
+            }
+
+            // Clear our cache
+            dsl::store::ThreadStore<TCP::Frame>::value = nullptr;
+        }
+
+        // If we used up everything and nobody is holding onto our buffer we can start again from the front
+        if (connection.start == connection.end && connection.buffer.use_count() == 1) {
+            connection.start = 0;
+            connection.end   = 0;
+        }
+
+        return true;
+    }
+
+    bool TCPController::flush(Writer& writer) {
+
+        while (!writer.queue.empty()) {
+
+            // Gather as many of our queued buffers as we can into a single write
+            std::array<iovec, MAX_WRITE_BUFFERS> buffers;
+            size_t count     = 0;
+            size_t requested = 0;
+            for (auto it = writer.queue.begin(); it != writer.queue.end() && count < buffers.size(); ++it, ++count) {
+                size_t skip = count == 0 ? writer.offset : 0;
+
+                buffers[count].iov_base = const_cast<char*>((*it)->data() + skip);
+                buffers[count].iov_len  = static_cast<decltype(buffers[count].iov_len)>((*it)->size() - skip);
+                requested += (*it)->size() - skip;
+            }
+
+            msghdr message{};
+            message.msg_iov    = buffers.data();
+            message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(count);
+
+            ssize_t sent = sendmsg(writer.fd, &message, WRITE_FLAGS);
+
+            if (sent < 0) {
+                if (network_errno == EINTR) {
+                    continue;
+                }
+
+                // If the connection is full we wait until it is writable, otherwise the connection is broken
+                return network_errno == EAGAIN || network_errno == EWOULDBLOCK;
+            }
+
+            // Drop all the buffers that have been completely written
+            writer.pending -= sent;
+            writer.offset += sent;
+            while (!writer.queue.empty() && writer.offset >= writer.queue.front()->size()) {
+                writer.offset -= writer.queue.front()->size();
+                writer.queue.pop_front();
+            }
+
+            // The connection didn't take everything so it must be full
+            if (size_t(sent) < requested) {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    void TCPController::update(const std::shared_ptr<Writer>& writer) {
+
+        // Wait for the connection to become writable only while we have something to write, otherwise poll would
+        // wake up constantly for a connection that is almost always writable
+        if (writer->pending > 0 && !writer->handle) {
+            writer->handle = on<IO>(writer->fd, IO::WRITE | IO::CLOSE).then("TCP Flush", [this, writer] {
+
+                std::lock_guard<std::mutex> lock(writer->mutex);
+
+                // We may have been removed while this task was waiting to run
+                if (!writer->closed) {
+                    if (flush(*writer)) {
+                        update(writer);
+                    }
+                    else {
+                        remove(*writer);
+                    }
+                }
+            });
+        }
+
+        // Let producers know when we cross the high water mark, and only release them once we have drained to half of
+        // it so we don't flap around the limit
+        if (!writer->congested && writer->pending > writer->high_water_mark) {
+            writer->congested = true;
+            emit(std::make_unique<message::TCPBackpressure>(writer->fd, writer->pending, true));
+        }
+        else if (writer->congested && writer->pending <= writer->high_water_mark / 2) {
+            writer->congested = false;
+            emit(std::make_unique<message::TCPBackpressure>(writer->fd, writer->pending, false));
+        }
+
+        // Once everything is written this writer is finished with
+        if (writer->pending == 0) {
+            remove(*writer);
+        }
+    }
+
+    void TCPController::remove(Writer& writer) {
+
+        writer.closed = true;
+        writer.handle.unbind();
+        writer.handle = ReactionHandle();
+        writer.queue.clear();
+        writer.offset  = 0;
+        writer.pending = 0;
+
+        // Anyone waiting on this connection should stop waiting
+        if (writer.congested) {
+            writer.congested = false;
+            emit(std::make_unique<message::TCPBackpressure>(writer.fd, 0, false));
+        }
+
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        auto it = writers.find(writer.fd);
+        if (it != writers.end() && it->second.get() == &writer) {
+            writers.erase(it);
+        }
+    }
+
+    void TCPController::disconnect(Connection& connection) {
+
+        std::lock_guard<std::mutex> lock(connection.mutex);
+
+        connection.handle.unbind();
+        if (connection.info.fd != INVALID_SOCKET) {
+
+            // Throw away anything that was waiting to be written to this connection
+            std::shared_ptr<Writer> writer;
+            {
+                std::lock_guard<std::mutex> writers_lock(writer_mutex);
+                auto it = writers.find(connection.info.fd);
+                if (it != writers.end()) {
+                    writer = it->second;
+                }
+            }
+            if (writer) {
+                std::lock_guard<std::mutex> writer_lock(writer->mutex);
+                if (!writer->closed) {
+                    remove(*writer);
+                }
+            }
+
+            close(connection.info.fd);
+            connection.info.fd = INVALID_SOCKET;
+        }
+    }
+
+}  // namespace extension
+}  // namespace NUClear
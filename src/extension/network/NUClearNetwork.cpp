@@ -17,6 +17,7 @@
  */
 
 #include "nuclear_bits/extension/network/NUClearNetwork.hpp"
+#include "nuclear_bits/extension/network/lz4.hpp"
 
 #include <algorithm>
 #include <cerrno>
@@ -38,31 +39,219 @@ namespace extension {
             }
         }
 
-        NUClearNetwork::PacketQueue::PacketTarget::PacketTarget(std::weak_ptr<NetworkTarget> target,
-                                                                std::vector<uint8_t> acked)
-            : target(std::move(target)), acked(std::move(acked)), last_send(std::chrono::steady_clock::now()) {}
+        constexpr size_t NUClearNetwork::RECEIVE_BATCH;
+        constexpr size_t NUClearNetwork::SEND_BATCH;
+        constexpr size_t NUClearNetwork::MAX_DATAGRAM;
+        constexpr uint64_t NUClearNetwork::REORDER_THRESHOLD;
+        constexpr size_t NUClearNetwork::CONTROL_SIZE;
+        constexpr std::chrono::seconds NUClearNetwork::ASSEMBLER_TIMEOUT;
+        constexpr int NUClearNetwork::ASSEMBLER_RETRANSMITS;
+        constexpr std::chrono::seconds NUClearNetwork::RELIABLE_ASSEMBLER_TIMEOUT;
+        constexpr size_t NUClearNetwork::BULK_BYTES;
+        constexpr uint16_t NUClearNetwork::IPV4_DATAGRAM_OVERHEAD;
+        constexpr uint16_t NUClearNetwork::IPV6_DATAGRAM_OVERHEAD;
+        constexpr uint8_t NUClearNetwork::PROBE_ATTEMPTS;
+        constexpr uint32_t NUClearNetwork::PROBE_RESOLUTION;
+        constexpr std::chrono::minutes NUClearNetwork::PROBE_INTERVAL;
+        constexpr size_t NUClearNetwork::NetworkTarget::Assembler::ACK_RANGES;
+
+        /**
+         * @brief Ask the kernel to timestamp datagrams as they arrive on this socket
+         *
+         * @details
+         *  This is best effort, if the kernel can't do it we fall back to when we read the datagram.
+         */
+        void enable_timestamps(fd_t fd) {
+#ifdef SO_TIMESTAMPNS
+            int yes = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, reinterpret_cast<char*>(&yes), sizeof(yes));
+#else
+            (void) fd;
+#endif
+        }
+
+        /**
+         * @brief Set the don't fragment bit on everything sent from this socket so datagrams that are too big for the
+         *        path are dropped rather than split up
+         *
+         * @details
+         *  On Linux we also ignore the path mtu the kernel has cached, as finding it is what we are doing.
+         *
+         * @return true if the platform let us stop fragmentation
+         */
+        bool disable_fragmentation(fd_t fd, int family) {
+            int value = 1;
+            (void) value;
+            if (family == AF_INET) {
+#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_PROBE)
+                value = IP_PMTUDISC_PROBE;
+                return ::setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, reinterpret_cast<char*>(&value), sizeof(value))
+                       == 0;
+#elif defined(IP_DONTFRAG)
+                return ::setsockopt(fd, IPPROTO_IP, IP_DONTFRAG, reinterpret_cast<char*>(&value), sizeof(value)) == 0;
+#elif defined(IP_DONTFRAGMENT)
+                return ::setsockopt(fd, IPPROTO_IP, IP_DONTFRAGMENT, reinterpret_cast<char*>(&value), sizeof(value))
+                       == 0;
+#endif
+            }
+            if (family == AF_INET6) {
+#if defined(IPV6_MTU_DISCOVER) && defined(IPV6_PMTUDISC_PROBE)
+                value = IPV6_PMTUDISC_PROBE;
+                return ::setsockopt(
+                           fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, reinterpret_cast<char*>(&value), sizeof(value))
+                       == 0;
+#elif defined(IPV6_DONTFRAG)
+                return ::setsockopt(fd, IPPROTO_IPV6, IPV6_DONTFRAG, reinterpret_cast<char*>(&value), sizeof(value))
+                       == 0;
+#endif
+            }
+            (void) fd;
+            return false;
+        }
+
+#ifdef SO_TIMESTAMPNS
+        /**
+         * @brief Find when a datagram arrived using the kernel timestamp in its ancillary data
+         *
+         * @param mh        the message header the datagram was read with
+         * @param wall_now  the wall clock time now, which is the clock the kernel timestamps with
+         * @param now       the steady clock time now
+         *
+         * @return when the datagram arrived, or now if the kernel didn't timestamp it
+         */
+        std::chrono::steady_clock::time_point kernel_timestamp(msghdr& mh,
+                                                               std::chrono::system_clock::time_point wall_now,
+                                                               std::chrono::steady_clock::time_point now) {
+            for (cmsghdr* c = CMSG_FIRSTHDR(&mh); c != nullptr; c = CMSG_NXTHDR(&mh, c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                    timespec ts{};
+                    std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+
+                    // Work out how long ago it arrived and go back that far on the steady clock
+                    auto arrived = std::chrono::system_clock::time_point(std::chrono::duration_cast<
+                                                                         std::chrono::system_clock::duration>(
+                        std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+                    auto age = std::max(wall_now - arrived, std::chrono::system_clock::duration(0));
+                    return now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+                }
+            }
+            return now;
+        }
+#endif
+
+        NUClearNetwork::ReceiveBuffer::ReceiveBuffer()
+            : from(), length(), received(), control(RECEIVE_BATCH * CONTROL_SIZE), data(RECEIVE_BATCH * MAX_DATAGRAM) {}
+
+        NUClearNetwork::PacketQueue::PacketTarget::PacketTarget(const std::shared_ptr<NetworkTarget>& target,
+                                                                uint16_t fragment_size,
+                                                                uint32_t packet_count)
+            : target(target)
+            , identity(target.get())
+            , slot(target->slot)
+            , fragment_size(fragment_size)
+            , packet_count(packet_count)
+            , acked((packet_count / 8) + 1, 0)
+            , acked_below(0)
+            , acked_count(0)
+            , reported(0)
+            , last_send(std::chrono::steady_clock::now())
+            , sent(acked.size(), 0)
+            , next(0)
+            , sequence(packet_count, 0)
+            , highest_acked(0) {}
 
         NUClearNetwork::PacketQueue::PacketQueue() = default;
 
+        void NUClearNetwork::PacketQueue::add(const std::shared_ptr<NetworkTarget>& target,
+                                              uint16_t fragment_size,
+                                              uint32_t packet_count) {
+
+            // Don't add the same target twice
+            if (find(*target) != nullptr) {
+                return;
+            }
+
+            targets.emplace_back(target, fragment_size, packet_count);
+            if (slots.size() <= target->slot) {
+                slots.resize(target->slot + 1, 0);
+            }
+            slots[target->slot] = uint32_t(targets.size());
+        }
+
+        NUClearNetwork::PacketQueue::PacketTarget* NUClearNetwork::PacketQueue::find(const NetworkTarget& target) {
+
+            if (target.slot < slots.size() && slots[target.slot] != 0) {
+                PacketTarget& t = targets[slots[target.slot] - 1];
+
+                // Slots are reused once a target leaves, so make sure this is still the same target
+                if (t.identity == &target && !t.target.expired()) {
+                    return &t;
+                }
+            }
+            return nullptr;
+        }
+
+        void NUClearNetwork::PacketQueue::erase(size_t index) {
+
+            // Clear the slot of the target we are removing if it still points to it
+            uint32_t slot = targets[index].slot;
+            if (slot < slots.size() && slots[slot] == index + 1) {
+                slots[slot] = 0;
+            }
+
+            // Move the last target into this position
+            if (index + 1 < targets.size()) {
+                targets[index] = std::move(targets.back());
+                if (targets[index].slot < slots.size()) {
+                    slots[targets[index].slot] = uint32_t(index + 1);
+                }
+            }
+            targets.pop_back();
+        }
+
         NUClearNetwork::NUClearNetwork()
             : data_fd(-1)
             , announce_fd(-1)
+            , probe_fd(-1)
+            , network_mtu(1500)
             , packet_data_mtu(1000)
+            , min_mtu(576)
+            , min_data_mtu(uint16_t(576 - (sizeof(DataPacket) - 1) - IPV4_DATAGRAM_OVERHEAD))
+            , max_mtu(0)
             , packet_id_source(0)
-            , last_announce(std::chrono::seconds(0))
-            , next_event(std::chrono::seconds(0)) {}
+            , compression_threshold(0)
+            , fec_block_size(0)
+            , duplicate_window(4096)
+            , target_assembler_limit(128 * 1024 * 1024)
+            , total_assembler_limit(512 * 1024 * 1024)
+            , total_assembler_bytes(0)
+            , total_assemblers_evicted(0)
+            , last_announce(0)
+            , next_event(std::chrono::seconds(0))
+            , transmit_due(std::chrono::steady_clock::time_point::max())
+            , next_slot(0) {}
 
 
         NUClearNetwork::~NUClearNetwork() {
             shutdown();
         }
 
-        void NUClearNetwork::set_packet_callback(
-            std::function<void(const NetworkTarget&, const uint64_t&, const bool&, std::vector<char>&&)> f) {
+        void NUClearNetwork::set_packet_callback(std::function<void(const NetworkTarget&,
+                                                                     const uint64_t&,
+                                                                     const bool&,
+                                                                     const std::chrono::steady_clock::time_point&,
+                                                                     std::vector<char>&&)> f) {
             packet_callback = std::move(f);
         }
 
 
+        void NUClearNetwork::set_progress_callback(
+            std::function<void(const NetworkTarget&, const uint64_t&, const bool&, const uint32_t&, const uint32_t&)>
+                f) {
+            progress_callback = std::move(f);
+        }
+
+
         void NUClearNetwork::set_join_callback(std::function<void(const NetworkTarget&)> f) {
             join_callback = std::move(f);
         }
@@ -76,6 +265,17 @@ namespace extension {
             next_event_callback = std::move(f);
         }
 
+        void NUClearNetwork::schedule_event(std::chrono::steady_clock::time_point time) {
+
+            std::lock_guard<std::mutex> lock(event_mutex);
+
+            // Only ask for attention if this is before what we already asked for, or if that has already passed
+            if (time < next_event || next_event < std::chrono::steady_clock::now()) {
+                next_event = time;
+                next_event_callback(next_event);
+            }
+        }
+
         std::array<uint16_t, 9> NUClearNetwork::udp_key(const sock_t& address) {
 
             // Get our keys for our maps, it will be the ip and then port
@@ -121,11 +321,20 @@ namespace extension {
             auto t = std::find(targets.begin(), targets.end(), target);
             if (t != targets.end()) {
                 targets.erase(t);
+
+                // Let a new target use this slot
+                free_slots.push_back(target->slot);
             }
+
+            // Throw away the packet groups we were building from them
+            std::lock_guard<std::mutex> lock(target->assemblers_mutex);
+            target->removed = true;
+            target->assemblers.clear();
+            total_assembler_bytes -= target->assembler_bytes.exchange(0);
         }
 
 
-        void NUClearNetwork::open_data(const sock_t& announce_target) {
+        void NUClearNetwork::open_data(const sock_t& announce_target, uint16_t receive_sockets) {
 
             // Create the "join any" address for this address family
             sock_t address = announce_target;
@@ -141,22 +350,52 @@ namespace extension {
                 address.ipv6.sin6_port = 0;
             }
 
-            // Open a socket with the same family as our announce target
-            data_fd = ::socket(address.sock.sa_family, SOCK_DGRAM, IPPROTO_UDP);
-            if (data_fd < 0) {
-                throw std::system_error(network_errno, std::system_category(), "Unable to open the UDP socket");
-            }
+// Without SO_REUSEPORT we can't share our port between sockets
+#ifndef SO_REUSEPORT
+            receive_sockets = 1;
+#endif
+            receive_sockets = std::max(receive_sockets, uint16_t(1));
 
-            // If we are a broadcast address we need to state we are explicitly before binding
-            int yes = 1;
-            if (::setsockopt(data_fd, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<char*>(&yes), sizeof(yes)) < 0) {
-                throw std::system_error(network_errno, std::system_category(), "Unable to set broadcast on the socket");
-            }
+            for (uint16_t i = 0; i < receive_sockets; ++i) {
 
-            // Bind to the address, and if we fail throw an error
-            if (::bind(data_fd, &address.sock, socket_size(address)) != 0) {
-                throw std::system_error(
-                    network_errno, std::system_category(), "Unable to bind the UDP socket to the port");
+                // Open a socket with the same family as our announce target
+                fd_t fd = ::socket(address.sock.sa_family, SOCK_DGRAM, IPPROTO_UDP);
+                if (fd < 0) {
+                    throw std::system_error(network_errno, std::system_category(), "Unable to open the UDP socket");
+                }
+                data_fds.push_back(fd);
+                enable_timestamps(fd);
+
+                // If we are a broadcast address we need to state we are explicitly before binding
+                int yes = 1;
+                if (::setsockopt(fd, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<char*>(&yes), sizeof(yes)) < 0) {
+                    throw std::system_error(
+                        network_errno, std::system_category(), "Unable to set broadcast on the socket");
+                }
+
+// If we have more than one socket they share the port and the kernel spreads senders between them
+#ifdef SO_REUSEPORT
+                if (receive_sockets > 1
+                    && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<char*>(&yes), sizeof(yes)) < 0) {
+                    throw std::system_error(network_errno, std::system_category(), "Unable to reuse port on the socket");
+                }
+#endif
+
+                // Bind to the address, and if we fail throw an error
+                if (::bind(fd, &address.sock, socket_size(address)) != 0) {
+                    throw std::system_error(
+                        network_errno, std::system_category(), "Unable to bind the UDP socket to the port");
+                }
+
+                // The first socket picks a port and the rest bind to the same one
+                if (i == 0) {
+                    socklen_t len = sizeof(sock_t);
+                    if (::getsockname(fd, &address.sock, &len) != 0) {
+                        throw std::system_error(
+                            network_errno, std::system_category(), "Unable to get the port of the UDP socket");
+                    }
+                    data_fd = fd;
+                }
             }
         }
 
@@ -184,6 +423,7 @@ namespace extension {
             if (announce_fd < 0) {
                 throw std::system_error(network_errno, std::system_category(), "Unable to open the UDP socket");
             }
+            enable_timestamps(announce_fd);
 
             // Set that we reuse the address so more than one application can bind (this applies for unicast as well)
             int yes = 1;
@@ -280,6 +520,38 @@ namespace extension {
         }
 
 
+        void NUClearNetwork::open_probe(const sock_t& announce_target) {
+
+            // Create the "join any" address for this address family
+            sock_t address = announce_target;
+            if (address.sock.sa_family == AF_INET) {
+                address.ipv4.sin_addr.s_addr = htonl(INADDR_ANY);
+                address.ipv4.sin_port        = 0;
+            }
+            else if (address.sock.sa_family == AF_INET6) {
+                address.ipv6.sin6_addr = IN6ADDR_ANY_INIT;
+                address.ipv6.sin6_port = 0;
+            }
+
+            probe_fd = ::socket(address.sock.sa_family, SOCK_DGRAM, IPPROTO_UDP);
+            if (probe_fd < 0) {
+                throw std::system_error(network_errno, std::system_category(), "Unable to open the UDP probe socket");
+            }
+            enable_timestamps(probe_fd);
+
+            if (::bind(probe_fd, &address.sock, socket_size(address)) != 0) {
+                throw std::system_error(
+                    network_errno, std::system_category(), "Unable to bind the UDP probe socket to a port");
+            }
+
+            // Without the don't fragment bit our probes would always get through so there is no point probing
+            if (!disable_fragmentation(probe_fd, address.sock.sa_family)) {
+                close(probe_fd);
+                probe_fd = -1;
+            }
+        }
+
+
         void NUClearNetwork::shutdown() {
 
             // If we have an fd, send a shutdown message
@@ -301,34 +573,57 @@ namespace extension {
             }
 
             // Close our existing FDs if they exist
-            if (data_fd > 0) {
-                close(data_fd);
-                data_fd = -1;
+            for (auto& fd : data_fds) {
+                close(fd);
             }
+            data_fds.clear();
+            data_fd = -1;
             if (announce_fd > 0) {
                 close(announce_fd);
                 announce_fd = -1;
             }
+            if (probe_fd > 0) {
+                close(probe_fd);
+                probe_fd = -1;
+            }
         }
 
 
         void NUClearNetwork::reset(const std::string& name,
                                    const std::string& address,
                                    in_port_t port,
-                                   uint16_t network_mtu) {
+                                   uint16_t network_mtu,
+                                   uint16_t receive_sockets,
+                                   uint32_t compression_threshold,
+                                   uint16_t fec_block_size,
+                                   uint16_t duplicate_window,
+                                   uint16_t max_mtu) {
 
             // Close our existing FDs if they exist
             shutdown();
 
             // Lock all mutexes
-            std::lock_guard<std::mutex> target_lock(target_mutex);
+            std::lock_guard<std::shared_timed_mutex> target_lock(target_mutex);
             std::lock_guard<std::mutex> send_lock(send_queue_mutex);
 
             // Clear all our data structures
             send_queue.clear();
+            retransmit_timers = decltype(retransmit_timers)();
+            transmit_due      = std::chrono::steady_clock::time_point::max();
             name_target.clear();
             targets.clear();
             udp_target.clear();
+            free_slots.clear();
+            next_slot = 0;
+
+            // Anything at least this big is compressed
+            this->compression_threshold = compression_threshold;
+
+            // How much parity to send with unreliable data
+            this->fec_block_size = fec_block_size;
+
+            // How many finished packet groups to remember from each target
+            this->duplicate_window = duplicate_window;
 
             // Setup some hints for what our address is
             addrinfo hints{};
@@ -382,18 +677,21 @@ namespace extension {
             }
 
             // Add the target for our multicast packets
-            auto all_target = std::make_shared<NetworkTarget>("", announce_target);
+            auto all_target  = std::make_shared<NetworkTarget>("", announce_target, duplicate_window, network_mtu);
+            all_target->slot = next_slot++;
             targets.push_front(all_target);
             name_target.insert(std::make_pair("", all_target));
             udp_target.insert(std::make_pair(udp_key(announce_target), all_target));
 
             // Work out our MTU for udp packets
-            packet_data_mtu = network_mtu;              // Start with the total mtu
-            packet_data_mtu -= sizeof(DataPacket) - 1;  // Now remove data packet header size
-            // IPv6 headers are always 40 bytes, and IPv4 can be 20-60 but if we assume 40 for all cases it should
-            // be safe enough
-            packet_data_mtu -= 40;  // Remove size of an IPv4 header or IPv6 header
-            packet_data_mtu -= 8;   // Size of a UDP packet header
+            this->network_mtu = network_mtu;
+            packet_data_mtu   = data_mtu(network_mtu, announce_target);
+
+            // Every IPv4 path carries 576 byte datagrams and every IPv6 path 1280, so we search for each target's path
+            // mtu between that and our maximum
+            min_mtu       = announce_target.sock.sa_family == AF_INET6 ? 1280 : 576;
+            min_data_mtu  = data_mtu(min_mtu, announce_target);
+            this->max_mtu = max_mtu >= min_mtu ? max_mtu : 0;
 
             // Build our announce packet
             announce_packet.resize(sizeof(AnnouncePacket) + name.size(), 0);
@@ -403,65 +701,129 @@ namespace extension {
 
             // Open our data socket and then our multicast one
 
-            open_data(announce_target);
+            open_data(announce_target, receive_sockets);
             open_announce(announce_target);
+            if (this->max_mtu != 0) {
+                open_probe(announce_target);
+            }
+        }
+
+
+        uint16_t NUClearNetwork::datagram_overhead(const sock_t& address) {
+            return address.sock.sa_family == AF_INET6 ? IPV6_DATAGRAM_OVERHEAD : IPV4_DATAGRAM_OVERHEAD;
         }
 
 
-        std::pair<util::network::sock_t, std::vector<char>> NUClearNetwork::read_socket(fd_t fd) {
+        uint16_t NUClearNetwork::data_mtu(uint16_t mtu, const sock_t& address) {
+            return uint16_t(mtu - (sizeof(DataPacket) - 1) - datagram_overhead(address));
+        }
+
 
-            // Allocate a vector that can hold a datagram
-            std::vector<char> payload(1500);
-            iovec iov{};
-            iov.iov_base = payload.data();
-            iov.iov_len  = payload.size();
+        size_t NUClearNetwork::read_socket(fd_t fd, ReceiveBuffer& buffer) {
+
+            // Point each of our io vectors at its own slice of the buffer
+            std::array<iovec, RECEIVE_BATCH> iov{};
+            for (size_t i = 0; i < RECEIVE_BATCH; ++i) {
+                iov[i].iov_base = buffer.data.data() + i * MAX_DATAGRAM;
+                iov[i].iov_len  = MAX_DATAGRAM;
+            }
 
-            // Who we are receiving from
-            sock_t from{};
-            std::memset(&from, 0, sizeof(from));
+#ifdef __linux__
+            // Setup our message headers to receive
+            std::array<mmsghdr, RECEIVE_BATCH> mh{};
+            std::memset(mh.data(), 0, sizeof(mh));
+            for (size_t i = 0; i < RECEIVE_BATCH; ++i) {
+                mh[i].msg_hdr.msg_name    = &buffer.from[i].sock;
+                mh[i].msg_hdr.msg_namelen = sizeof(sock_t);
+                mh[i].msg_hdr.msg_iov     = &iov[i];
+                mh[i].msg_hdr.msg_iovlen  = 1;
+                mh[i].msg_hdr.msg_control    = buffer.control.data() + i * CONTROL_SIZE;
+                mh[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+            }
 
-            // Setup our message header to receive
-            msghdr mh{};
-            memset(&mh, 0, sizeof(msghdr));
-            mh.msg_name    = &from.sock;
-            mh.msg_namelen = sizeof(from);
-            mh.msg_iov     = &iov;
-            mh.msg_iovlen  = 1;
+            // Read as many datagrams as are waiting in a single call without waiting for more
+            int received = recvmmsg(fd, mh.data(), RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+            received     = std::max(received, 0);
 
-            // Now read the data for real
-            ssize_t received = recvmsg(fd, &mh, 0);
-            payload.resize(received);
+            // The kernel's timestamps are on the wall clock so we measure their age against it
+            auto wall_now = std::chrono::system_clock::now();
+            auto now      = std::chrono::steady_clock::now();
+            for (int i = 0; i < received; ++i) {
+                buffer.length[i]   = mh[i].msg_len;
+                buffer.received[i] = kernel_timestamp(mh[i].msg_hdr, wall_now, now);
+            }
+#else
+            size_t received = 0;
+            for (; received < RECEIVE_BATCH; ++received) {
+
+                // Setup our message header to receive
+                msghdr mh{};
+                memset(&mh, 0, sizeof(msghdr));
+                mh.msg_name    = &buffer.from[received].sock;
+                mh.msg_namelen = sizeof(sock_t);
+                mh.msg_iov     = &iov[received];
+                mh.msg_iovlen  = 1;
+
+#ifdef _WIN32
+                // Windows can't do non blocking reads per call so check if there is anything to read first
+                unsigned long count = 0;
+                ioctl(fd, FIONREAD, &count);
+                if (count == 0) {
+                    break;
+                }
+                ssize_t r = recvmsg(fd, &mh, 0);
+#else
+                ssize_t r = recvmsg(fd, &mh, MSG_DONTWAIT);
+#endif
+                if (r < 0) {
+                    break;
+                }
+                buffer.length[received]   = r;
+                buffer.received[received] = std::chrono::steady_clock::now();
+            }
+#endif
 
-            return std::make_pair(from, std::move(payload));
+            return received;
         }
 
 
         void NUClearNetwork::process() {
 
-            // Record the time
-            auto now = std::chrono::steady_clock::now();
+            // Do our timed work and then read everything that is waiting
+            housekeeping();
+            for (auto& fd : listen_fds()) {
+                process(fd);
+            }
+        }
+
+
+        void NUClearNetwork::housekeeping() {
 
             // Check if we should announce now
-            if (now - last_announce > std::chrono::milliseconds(500)) {
-                last_announce = now;
+            auto now = std::chrono::steady_clock::now();
+            if (now - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(last_announce))
+                > std::chrono::milliseconds(500)) {
                 announce();
+            }
 
-                // Update our event timer
-                auto next_announce = now + std::chrono::milliseconds(500);
-                if (next_announce > next_event) {
-                    next_event = next_announce;
+            // Check if any of our existing connections have timed out
+            check_timeouts();
 
-                    // Let the system know when we need attention again
-                    next_event_callback(next_event);
-                }
-            }
+            // Check if we have packets to resend and if so resend
+            retransmit();
+        }
+
+
+        void NUClearNetwork::check_timeouts() {
+
+            // Record the time
+            auto now = std::chrono::steady_clock::now();
 
             // We need to make this list outside mutex scope in case the callback needs the mutex
             std::vector<std::shared_ptr<NetworkTarget>> leavers;
 
-            // Check if any of our existing connections have timed out
             /* Mutex Scope */ {
-                std::lock_guard<std::mutex> lock(target_mutex);
+                std::lock_guard<std::shared_timed_mutex> lock(target_mutex);
 
                 // Always skip the first element since it's the "all" target
                 for (auto it = std::next(targets.begin(), 1); it != targets.end();) {
@@ -469,12 +831,43 @@ namespace extension {
                     auto ptr = *it;
                     ++it;
 
-                    if (now - ptr->last_update > std::chrono::seconds(2)) {
+                    if (now
+                            - std::chrono::steady_clock::time_point(
+                                std::chrono::steady_clock::duration(ptr->last_update))
+                        > std::chrono::seconds(2)) {
 
                         // Remove this, it timed out
                         leavers.push_back(ptr);
                         remove_target(ptr);
                     }
+                    else {
+                        // Reliable data keeps being resent until we have it all, so only give up on it once it has
+                        // missed several of the retransmissions that should have finished it
+                        std::chrono::steady_clock::duration reliable_timeout;
+                        /* Mutex Scope */ {
+                            std::lock_guard<std::mutex> send_lock(send_queue_mutex);
+                            reliable_timeout = std::max<std::chrono::steady_clock::duration>(
+                                RELIABLE_ASSEMBLER_TIMEOUT, ptr->retransmit_timeout() * ASSEMBLER_RETRANSMITS);
+                        }
+
+                        std::lock_guard<std::mutex> assemblers_lock(ptr->assemblers_mutex);
+
+                        // Find the packet groups that have stopped arriving, a group that is still getting fragments
+                        // is never stale
+                        std::vector<uint16_t> stale;
+                        ptr->assemblers.for_each([&](uint16_t id, const NetworkTarget::Assembler& assembler) {
+                            if (now - assembler.last_update
+                                > (assembler.reliable ? reliable_timeout
+                                                      : std::chrono::steady_clock::duration(ASSEMBLER_TIMEOUT))) {
+                                stale.push_back(id);
+                            }
+                        });
+
+                        // And throw them away
+                        for (const auto& id : stale) {
+                            evict_assembler(*ptr, id);
+                        }
+                    }
                 }
             }
 
@@ -482,91 +875,378 @@ namespace extension {
             for (auto& l : leavers) {
                 leave_callback(*l);
             }
+        }
 
-            // Check if we have packets to resend and if so resend
-            if (!send_queue.empty()) {
-                retransmit();
+
+        void NUClearNetwork::process(fd_t fd) {
+
+            // Take a receive buffer from the pool, or make one if they are all in use
+            std::unique_ptr<ReceiveBuffer> buffer;
+            /* Mutex Scope */ {
+                std::lock_guard<std::mutex> lock(receive_pool_mutex);
+                if (!receive_pool.empty()) {
+                    buffer = std::move(receive_pool.back());
+                    receive_pool.pop_back();
+                }
+            }
+            if (!buffer) {
+                buffer = std::make_unique<ReceiveBuffer>();
             }
 
-            // Used for storing how many bytes are available on a socket
-            unsigned long count = 0;
+            // Read packets from the socket until it is empty
+            bool more = true;
+            while (more) {
+                size_t count = read_socket(fd, *buffer);
 
-            // Read packets from the multicast socket while there is data available
-            ioctl(announce_fd, FIONREAD, &(count = 0));
-            while (count > 0) {
-                auto packet = read_socket(announce_fd);
-                process_packet(packet.first, std::move(packet.second));
-                ioctl(announce_fd, FIONREAD, &(count = 0));
+                // If we filled our batch there is probably more waiting
+                more = count == RECEIVE_BATCH;
+
+                for (size_t i = 0; i < count; ++i) {
+                    process_packet(buffer->from[i],
+                                   buffer->data.data() + i * MAX_DATAGRAM,
+                                   buffer->length[i],
+                                   buffer->received[i]);
+                }
             }
 
-            // Check if we have a packet available on the data socket
-            ioctl(data_fd, FIONREAD, &(count = 0));
-            while (count > 0) {
-                auto packet = read_socket(data_fd);
-                process_packet(packet.first, std::move(packet.second));
-                ioctl(data_fd, FIONREAD, &(count = 0));
+            // Return our buffer to the pool for the next read
+            std::lock_guard<std::mutex> lock(receive_pool_mutex);
+            receive_pool.push_back(std::move(buffer));
+        }
+
+        size_t NUClearNetwork::mark_lost(NetworkTarget& target,
+                                         PacketQueue::PacketTarget& queue,
+                                         uint64_t first,
+                                         uint64_t last) {
+
+            // Find the packets that are still in flight from this range, which can only be between the packets that
+            // have all been acked and the ones that have never been sent
+            size_t lost = 0;
+            for (uint32_t i = queue.acked_below; i < queue.next; ++i) {
+                if (i % 8 == 0 && queue.sent[i / 8] == 0) {
+                    i += 7;
+                    continue;
+                }
+                uint8_t bit = uint8_t(1 << (i % 8));
+                if ((queue.sent[i / 8] & bit) != 0 && queue.sequence[i] >= first && queue.sequence[i] <= last) {
+                    queue.sent[i / 8] &= ~bit;
+                    ++lost;
+                }
             }
+
+            // They are no longer in flight
+            target.congestion.in_flight -= std::min(target.congestion.in_flight, lost);
+            return lost;
         }
 
+
         void NUClearNetwork::retransmit() {
 
             // Locking send_queue_mutex second after target_mutex
-            std::lock_guard<std::mutex> target_lock(target_mutex);
+            std::shared_lock<std::shared_timed_mutex> target_lock(target_mutex);
             std::lock_guard<std::mutex> send_lock(send_queue_mutex);
 
-            for (auto qit = send_queue.begin(); qit != send_queue.end();) {
-                for (auto it = qit->second.targets.begin(); it != qit->second.targets.end();) {
+            auto now  = std::chrono::steady_clock::now();
+            bool lost = false;
 
-                    // Get the pointer to our target
-                    auto ptr = it->target.lock();
+            // Go through the timers that have expired
+            while (!retransmit_timers.empty() && retransmit_timers.top().deadline <= now) {
+                RetransmitTimer timer = retransmit_timers.top();
+                retransmit_timers.pop();
 
-                    // If our pointer is valid (they haven't disconnected)
-                    if (ptr) {
+                // The packet may have been completed, or the target may have left
+                auto ptr = timer.target.lock();
+                auto q   = send_queue.find(timer.packet_id);
+                if (!ptr || q == nullptr) {
+                    continue;
+                }
 
-                        auto now     = std::chrono::steady_clock::now();
-                        auto timeout = it->last_send + ptr->round_trip_time;
+                // Anything from this timer that is still in flight is lost, which means we are sending too fast
+                auto s = q->find(*ptr);
+                if (s != nullptr && mark_lost(*ptr, *s, timer.first, timer.last) > 0) {
+                    ptr->congestion_lost(now);
+                    lost = true;
+                }
+            }
 
-                        // Check if we should have expected an ack by now for some packets
-                        if (timeout < now) {
+            // Send lost packets and anything that was waiting on pacing
+            if (lost || transmit_due <= now) {
+                transmit();
+            }
 
-                            // We last sent now
-                            it->last_send = now;
+            // Keep our path mtu searches going
+            probe_paths(now);
 
-                            // The next time we should check for a timeout
-                            auto next_timeout = now + ptr->round_trip_time;
-                            if (next_timeout < next_event) {
-                                next_event = next_timeout;
-                                next_event_callback(next_event);
-                            }
+            // Make sure we are woken for the next timer
+            if (!retransmit_timers.empty()) {
+                schedule_event(retransmit_timers.top().deadline);
+            }
+        }
 
-                            // Work out which packets to resend and resend them
-                            for (int i = 0; i < qit->second.header.packet_count; ++i) {
-                                if ((it->acked[i / 8] & uint8_t(1 << (i % 8))) == 0) {
-                                    send_packet(ptr->target, qit->second.header, i, qit->second.payload, true);
-                                }
+
+        void NUClearNetwork::probe_paths(std::chrono::steady_clock::time_point now) {
+
+            if (probe_fd < 0) {
+                return;
+            }
+
+            for (const auto& target : targets) {
+
+                // Our announce targets are not a single path so there is nothing to find
+                if (target->name.empty()) {
+                    continue;
+                }
+                auto& probe = target->probe;
+
+                // Waiting to hear back about a probe
+                if (probe.size != 0) {
+                    auto deadline = probe.sent + target->retransmit_timeout();
+                    if (now < deadline) {
+                        schedule_event(deadline);
+                    }
+                    // It may have been lost for some other reason so give it a few tries
+                    else if (++probe.attempts < PROBE_ATTEMPTS) {
+                        send_probe(*target, probe.size);
+                        probe.sent = now;
+                        schedule_event(now + target->retransmit_timeout());
+                    }
+                    // Otherwise it is too big to get through
+                    else {
+                        probe.high = probe.size;
+                        probe.size = 0;
+                        next_probe(*target, now);
+                    }
+                }
+                // Time to start a new search
+                else if (probe.high == 0) {
+                    if (now < probe.next) {
+                        schedule_event(probe.next);
+                    }
+                    else {
+                        probe.low       = min_mtu;
+                        probe.high      = uint32_t(max_mtu) + 1;
+                        probe.confirmed = false;
+                        next_probe(*target, now);
+                    }
+                }
+            }
+        }
+
+
+        void NUClearNetwork::next_probe(NetworkTarget& target, std::chrono::steady_clock::time_point now) {
+
+            auto& probe = target.probe;
+            while (probe.high - probe.low > PROBE_RESOLUTION) {
+
+                // Paths that carry more than the minimum usually carry as much as we will try, so try that first and
+                // then halve the range each time
+                probe.size     = uint16_t(probe.high == uint32_t(max_mtu) + 1 ? max_mtu : (probe.low + probe.high) / 2);
+                probe.attempts = 0;
+                probe.sent     = now;
+                if (send_probe(target, probe.size)) {
+                    schedule_event(now + target.retransmit_timeout());
+                    return;
+                }
+
+                // Too big for our own network interface so there is no need to wait to find out
+                probe.high = probe.size;
+            }
+
+            // We have narrowed it down enough, if nothing got through we have no better idea than our configuration
+            if (probe.confirmed) {
+                target.mtu = uint16_t(probe.low);
+            }
+            probe.size = 0;
+            probe.high = 0;
+            probe.next = now + PROBE_INTERVAL;
+            schedule_event(probe.next);
+        }
+
+
+        bool NUClearNetwork::send_probe(const NetworkTarget& target, uint16_t size) {
+
+            // The probe is padded with zeros so the whole datagram is the size we are testing
+            std::vector<char> packet(size - datagram_overhead(target.target), 0);
+            ProbePacket& probe = *reinterpret_cast<ProbePacket*>(packet.data());
+            probe              = ProbePacket();
+            probe.mtu          = size;
+
+            if (::sendto(probe_fd, packet.data(), packet.size(), 0, &target.target.sock, socket_size(target.target))
+                < 0) {
+                return network_errno != EMSGSIZE;
+            }
+            return true;
+        }
+
+
+        void NUClearNetwork::transmit(const std::shared_ptr<NetworkTarget>& target) {
+
+            auto now = std::chrono::steady_clock::now();
+
+            // How many more packets each target may be sent in this call
+            std::map<NetworkTarget*, size_t> budgets;
+
+            // If a target still has data waiting once its budget is spent, when we should try again
+            auto next_transmit = std::chrono::steady_clock::time_point::max();
+
+            // Packet groups that have no targets left once we remove the ones that disconnected
+            std::vector<uint16_t> finished;
+
+            // Send what we can of a packet group to one target, true if it had packets left that didn't fit the budget
+            auto send_target = [&](uint16_t packet_id,
+                                   PacketQueue& queue,
+                                   PacketQueue::PacketTarget& t,
+                                   const std::shared_ptr<NetworkTarget>& ptr) {
+                // Work out how much we can send to this target the first time we see it
+                auto b = budgets.find(ptr.get());
+                if (b == budgets.end()) {
+                    b = budgets.insert(std::make_pair(ptr.get(), ptr->congestion_budget(now))).first;
+                }
+                size_t& budget = b->second;
+
+                // Find the packets we need to send, packets that have been sent before go first
+                bool blocked = false;
+                std::vector<uint32_t> resend;
+                std::vector<uint32_t> fresh;
+                for (uint32_t i = t.acked_below; i < t.packet_count; ++i) {
+
+                    // Skip over whole bytes of packets that are acked or in flight
+                    if (i % 8 == 0 && (t.acked[i / 8] | t.sent[i / 8]) == 0xFF) {
+                        i += 7;
+                        continue;
+                    }
+
+                    uint8_t bit = uint8_t(1 << (i % 8));
+                    if (((t.acked[i / 8] | t.sent[i / 8]) & bit) == 0) {
+
+                        // Not allowed to send any more right now, check back when we can
+                        if (budget == 0) {
+                            if (ptr->congestion.window - double(ptr->congestion.in_flight) >= 1.0) {
+                                next_transmit = std::min(next_transmit, now + ptr->congestion_delay());
                             }
+                            blocked = true;
+                            break;
                         }
 
-                        ++it;
+                        (i < t.next ? resend : fresh).push_back(i);
+                        t.sent[i / 8] |= bit;
+                        --budget;
                     }
-                    // Remove them from the list
-                    else {
-                        it = qit->second.targets.erase(it);
+                }
+
+                if (resend.empty() && fresh.empty()) {
+                    return blocked;
+                }
+
+                // Give each packet a sequence number in the order they are sent
+                uint64_t first = ptr->congestion.sequence;
+                for (const auto& i : resend) {
+                    t.sequence[i] = ptr->congestion.sequence++;
+                }
+                for (const auto& i : fresh) {
+                    t.sequence[i] = ptr->congestion.sequence++;
+                }
+
+                // Account for what we are about to send
+                size_t count = resend.size() + fresh.size();
+                ptr->congestion.in_flight += count;
+                ptr->congestion.tokens -= double(count);
+                ptr->fragments_sent += count;
+                ptr->fragments_retransmitted += resend.size();
+                t.last_send = now;
+
+                // Packets that have been sent before are marked as retransmissions so a finished packet isn't
+                // processed twice
+                DataPacket header   = queue.header;
+                header.packet_count = t.packet_count;
+                if (!resend.empty()) {
+                    send_packets(ptr->target, header, t.fragment_size, resend, *queue.payload);
+                }
+                if (!fresh.empty()) {
+                    header.type = DATA;
+                    send_packets(ptr->target, header, t.fragment_size, fresh, *queue.payload);
+                    t.next = fresh.back() + 1;
+                }
+
+                // These packets should be acked within a round trip
+                retransmit_timers.push(RetransmitTimer{
+                    now + ptr->retransmit_timeout(), packet_id, ptr, first, ptr->congestion.sequence - 1});
+                schedule_event(retransmit_timers.top().deadline);
+
+                return blocked;
+            };
+
+            auto send_group = [&](uint16_t packet_id, PacketQueue& queue) {
+                for (size_t index = 0; index < queue.targets.size();) {
+
+                    // Remove targets that have disconnected
+                    auto ptr = queue.targets[index].target.lock();
+                    if (!ptr) {
+                        queue.erase(index);
+                        continue;
                     }
+                    send_target(packet_id, queue, queue.targets[index], ptr);
+                    ++index;
                 }
 
-                if (qit->second.targets.empty()) {
-                    qit = send_queue.erase(qit);
+                if (queue.targets.empty()) {
+                    finished.push_back(packet_id);
+                }
+            };
+
+            // Bulk transfers go last so they only get the window that smaller packet groups leave
+            bool blocked = false;
+            for (bool bulk : {false, true}) {
+
+                // For one target we only look at the groups queued for it, so handling an ack doesn't walk every group
+                if (target) {
+                    auto& groups = target->queued_groups;
+                    for (size_t index = 0; !blocked && index < groups.size();) {
+                        auto q = send_queue.find(groups[index]);
+                        auto t = q != nullptr ? q->find(*target) : nullptr;
+
+                        // Forget groups that have finished or been cancelled for this target
+                        if (t == nullptr) {
+                            groups.erase(std::next(groups.begin(), index));
+                            continue;
+                        }
+
+                        // Once a group doesn't fit the window, none of the groups after it will either
+                        if ((q->payload->size() >= BULK_BYTES) == bulk) {
+                            blocked = send_target(groups[index], *q, *t, target);
+                        }
+                        ++index;
+                    }
                 }
                 else {
-                    ++qit;
+                    send_queue.for_each([&](uint16_t packet_id, PacketQueue& queue) {
+                        if ((queue.payload->size() >= BULK_BYTES) == bulk) {
+                            send_group(packet_id, queue);
+                        }
+                    });
                 }
             }
+
+            for (const auto& packet_id : finished) {
+                send_queue.erase(packet_id);
+            }
+
+            // If we only looked at one target, any other target that was waiting is still waiting
+            transmit_due = target ? std::min(transmit_due, next_transmit) : next_transmit;
+            if (next_transmit != std::chrono::steady_clock::time_point::max()) {
+                schedule_event(next_transmit);
+            }
         }
 
 
         void NUClearNetwork::announce() {
 
+            // Remember when we last announced
+            last_announce = std::chrono::steady_clock::now().time_since_epoch().count();
+
+            // We can be called from a timer at the same time as packets are arriving
+            std::shared_lock<std::shared_timed_mutex> lock(target_mutex);
+
             // Get all our targets that are global targets
             auto announce_targets = name_target.equal_range("");
             for (auto it = announce_targets.first; it != announce_targets.second; ++it) {
@@ -582,52 +1262,210 @@ namespace extension {
                     throw std::system_error(
                         network_errno, std::system_category(), "Network error when sending the announce packet");
                 }
+
+                // Remind everyone what we want in case they missed it
+                send_subscriptions(it->second->target);
             }
         }
 
 
-        void NUClearNetwork::process_packet(const sock_t& address, std::vector<char>&& payload) {
+        void NUClearNetwork::set_subscriptions(std::vector<uint64_t> hashes) {
 
-            // First validate this is a NUClear network packet we can read (a version 2 NUClear packet)
-            if (payload.size() >= sizeof(PacketHeader) && payload[0] == '\xE2' && payload[1] == '\x98'
-                && payload[2] == '\xA2' && payload[3] == 0x02) {
+            // Keep the hashes sorted so the receiver can search them and we can compare them
+            std::sort(hashes.begin(), hashes.end());
+            hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
 
-                // This is a real packet! get our header information
-                const PacketHeader& header = *reinterpret_cast<const PacketHeader*>(payload.data());
+            // Build our new subscribe packet
+            std::vector<char> packet(sizeof(SubscribePacket) - sizeof(uint64_t) + hashes.size() * sizeof(uint64_t));
+            SubscribePacket& pkt = *reinterpret_cast<SubscribePacket*>(packet.data());
+            pkt                  = SubscribePacket();
+            pkt.hash_count       = uint32_t(hashes.size());
+            std::memcpy(&pkt.hashes, hashes.data(), hashes.size() * sizeof(uint64_t));
 
-                // Get the map key for this device
-                auto key = udp_key(address);
+            /* Mutex Scope */ {
+                std::lock_guard<std::mutex> lock(subscribe_mutex);
 
-                // From here on, we are doing things with our target lists that if changed would make us sad
-                std::shared_ptr<NetworkTarget> remote;
-                /* Mutex scope */ {
-                    std::lock_guard<std::mutex> lock(target_mutex);
-                    auto r = udp_target.find(key);
-                    remote = r == udp_target.end() ? nullptr : r->second;
+                // If nothing changed there is nobody to tell
+                if (packet == subscribe_packet) {
+                    return;
                 }
+                subscribe_packet = std::move(packet);
+            }
 
-                switch (header.type) {
+            // Tell everyone straight away rather than waiting for our next announce
+            if (data_fd != -1) {
+                std::shared_lock<std::shared_timed_mutex> lock(target_mutex);
+                auto announce_targets = name_target.equal_range("");
+                for (auto it = announce_targets.first; it != announce_targets.second; ++it) {
+                    send_subscriptions(it->second->target);
+                }
+            }
+        }
 
-                    // A packet announcing that a user is on the network
-                    case ANNOUNCE: {
-                        // This is an announce packet!
-                        const AnnouncePacket& announce = *reinterpret_cast<const AnnouncePacket*>(payload.data());
 
-                        // They're new!
-                        if (!remote) {
-                            std::string name(&announce.name, payload.size() - sizeof(AnnouncePacket));
+        void NUClearNetwork::set_assembler_limits(size_t per_target, size_t total) {
+            target_assembler_limit = per_target;
+            total_assembler_limit  = total;
+        }
 
-                            // If they sent us an empty name ignore that's reserved for multicast transmissions
+
+        uint64_t NUClearNetwork::assembler_evictions() const {
+            return total_assemblers_evicted;
+        }
+
+
+        void NUClearNetwork::send_complete_ack(const sock_t& to, const DataPacket& packet) {
+
+            // We got the whole thing so everything is before the cumulative point and there are no ranges
+            ACKPacket response;
+            response.packet_id    = packet.packet_id;
+            response.packet_no    = packet.packet_no;
+            response.packet_count = packet.packet_count;
+            response.cumulative   = packet.packet_count;
+
+            // Send the packet
+            ::sendto(data_fd, &response, sizeof(ACKPacket) - sizeof(AckRange), 0, &to.sock, socket_size(to));
+        }
+
+
+        void NUClearNetwork::send_ack(const sock_t& to,
+                                      const DataPacket& packet,
+                                      const NetworkTarget::Assembler& assembler) {
+
+            // Allocate room for the ack and each of its ranges, the range inside the ack is only used as the first
+            std::vector<char> r(sizeof(ACKPacket) + assembler.ranges.size() * sizeof(AckRange), 0);
+            ACKPacket& response   = *reinterpret_cast<ACKPacket*>(r.data());
+            response              = ACKPacket();
+            response.packet_id    = packet.packet_id;
+            response.packet_no    = packet.packet_no;
+            response.packet_count = packet.packet_count;
+            response.cumulative   = assembler.contiguous;
+            response.range_count  = uint8_t(assembler.ranges.size());
+
+            for (size_t i = 0; i < assembler.ranges.size(); ++i) {
+                AckRange range{assembler.ranges[i].first, assembler.ranges[i].second};
+                std::memcpy(&response.ranges + i, &range, sizeof(AckRange));
+            }
+
+            // Send the packet without the spare range on the end
+            ::sendto(data_fd, r.data(), r.size() - sizeof(AckRange), 0, &to.sock, socket_size(to));
+        }
+
+
+        void NUClearNetwork::send_nack(const sock_t& to,
+                                       uint16_t packet_id,
+                                       uint32_t count,
+                                       const NetworkTarget::Assembler* held) {
+
+            // Allocate room for the nack and each of the runs we still hold, like an ack
+            size_t ranges = held == nullptr ? 0 : held->ranges.size();
+            std::vector<char> r(sizeof(NACKPacket) + ranges * sizeof(AckRange), 0);
+            NACKPacket& response  = *reinterpret_cast<NACKPacket*>(r.data());
+            response              = NACKPacket();
+            response.packet_id    = packet_id;
+            response.packet_count = count;
+            response.cumulative   = held == nullptr ? 0 : held->contiguous;
+            response.range_count  = uint8_t(ranges);
+
+            for (size_t i = 0; i < ranges; ++i) {
+                AckRange range{held->ranges[i].first, held->ranges[i].second};
+                std::memcpy(&response.ranges + i, &range, sizeof(AckRange));
+            }
+
+            // Send the packet without the spare range on the end
+            ::sendto(data_fd, r.data(), r.size() - sizeof(AckRange), 0, &to.sock, socket_size(to));
+        }
+
+
+        void NUClearNetwork::report_progress(const NetworkTarget& target,
+                                             const uint64_t& hash,
+                                             bool sending,
+                                             uint32_t done,
+                                             uint32_t total,
+                                             uint16_t fragment_size,
+                                             uint32_t& reported) {
+
+            // Only bulk transfers are worth reporting, and only once they have moved another 64th of the way
+            if (uint64_t(total) * fragment_size < BULK_BYTES || !progress_callback) {
+                return;
+            }
+            uint32_t step = uint32_t(uint64_t(done) * 64 / total);
+            if (step > reported) {
+                reported = step;
+                progress_callback(target, hash, sending, done, total);
+            }
+        }
+
+
+        void NUClearNetwork::send_subscriptions(const sock_t& to) {
+            std::lock_guard<std::mutex> lock(subscribe_mutex);
+
+            // We haven't been told what we want yet so we still want everything
+            if (subscribe_packet.empty()) {
+                return;
+            }
+
+            // This is resent with every announce so if it's lost it will be fixed soon
+            ::sendto(data_fd, subscribe_packet.data(), subscribe_packet.size(), 0, &to.sock, socket_size(to));
+        }
+
+
+        void NUClearNetwork::process_packet(const sock_t& address,
+                                            const char* payload,
+                                            size_t length,
+                                            std::chrono::steady_clock::time_point received) {
+
+            // First validate this is a NUClear network packet we can read (the protocol version in PacketHeader)
+            if (length >= sizeof(PacketHeader) && payload[0] == '\xE2' && payload[1] == '\x98'
+                && payload[2] == '\xA2' && payload[3] == 0x06) {
+
+                // This is a real packet! get our header information
+                const PacketHeader& header = *reinterpret_cast<const PacketHeader*>(payload);
+
+                // Get the map key for this device
+                auto key = udp_key(address);
+
+                // From here on, we are doing things with our target lists that if changed would make us sad
+                std::shared_ptr<NetworkTarget> remote;
+                /* Mutex scope */ {
+                    std::shared_lock<std::shared_timed_mutex> lock(target_mutex);
+                    auto r = udp_target.find(key);
+                    remote = r == udp_target.end() ? nullptr : r->second;
+                }
+
+                switch (header.type) {
+
+                    // A packet announcing that a user is on the network
+                    case ANNOUNCE: {
+                        // This is an announce packet!
+                        const AnnouncePacket& announce = *reinterpret_cast<const AnnouncePacket*>(payload);
+
+                        // They're new!
+                        if (!remote) {
+                            std::string name(&announce.name, length - sizeof(AnnouncePacket));
+
+                            // If they sent us an empty name ignore that's reserved for multicast transmissions
                             if (!name.empty()) {
                                 // Add them into our list
-                                auto ptr            = std::make_shared<NetworkTarget>(name, address);
+                                auto ptr =
+                                    std::make_shared<NetworkTarget>(name, address, duplicate_window, network_mtu);
                                 bool new_connection = false;
                                 /* Mutex scope */ {
-                                    std::lock_guard<std::mutex> lock(target_mutex);
+                                    std::lock_guard<std::shared_timed_mutex> lock(target_mutex);
 
                                     // Double check they are new
                                     if (udp_target.count(key) == 0) {
                                         new_connection = true;
+
+                                        // Give them a slot, reusing one from a target that left if we can
+                                        if (free_slots.empty()) {
+                                            ptr->slot = next_slot++;
+                                        }
+                                        else {
+                                            ptr->slot = free_slots.back();
+                                            free_slots.pop_back();
+                                        }
+
                                         targets.push_back(ptr);
                                         udp_target.insert(std::make_pair(key, ptr));
                                         name_target.insert(std::make_pair(name, ptr));
@@ -639,18 +1477,24 @@ namespace extension {
                                                  0,
                                                  &ptr->target.sock,
                                                  socket_size(ptr->target));
+
+                                        // And let them know what we want before they start sending to us
+                                        send_subscriptions(ptr->target);
                                     }
                                 }
 
-                                // Only call the callback if it is new
+                                // Only call the callback if it is new, and start looking for their path mtu
                                 if (new_connection) {
                                     join_callback(*ptr);
+                                    if (probe_fd >= 0) {
+                                        schedule_event(std::chrono::steady_clock::now());
+                                    }
                                 }
                             }
                         }
                         // They're old but at least they're not timing out
                         else {
-                            remote->last_update = std::chrono::steady_clock::now();
+                            remote->last_update = std::chrono::steady_clock::now().time_since_epoch().count();
                         }
                     } break;
                     case LEAVE: {
@@ -661,7 +1505,7 @@ namespace extension {
 
                             // Remove from our list
                             /* Mutex scope */ {
-                                std::lock_guard<std::mutex> lock(target_mutex);
+                                std::lock_guard<std::shared_timed_mutex> lock(target_mutex);
 
                                 // Double check they are gone after locking before removal
                                 if (udp_target.count(key) > 0) {
@@ -677,16 +1521,92 @@ namespace extension {
 
                     } break;
 
+                    // A packet testing if datagrams this big can get to us, which comes from a socket we don't know
+                    case PROBE: {
+                        const ProbePacket& packet = *reinterpret_cast<const ProbePacket*>(payload);
+
+                        // Tell them how much of it arrived so they can match it with the probe they sent
+                        if (length >= sizeof(ProbePacket) - 1) {
+                            ProbePacket ack(PROBE_ACK);
+                            ack.mtu = uint16_t(std::min<size_t>(length + datagram_overhead(address), packet.mtu));
+                            ::sendto(data_fd,
+                                     reinterpret_cast<const char*>(&ack),
+                                     sizeof(ProbePacket) - 1,
+                                     0,
+                                     &address.sock,
+                                     socket_size(address));
+                        }
+                    } break;
+
+                    // A remote telling us that one of our path mtu probes got through
+                    case PROBE_ACK: {
+                        const ProbePacket& packet = *reinterpret_cast<const ProbePacket*>(payload);
+
+                        if (remote && length == sizeof(ProbePacket) - 1) {
+
+                            // We got a packet from them recently
+                            remote->last_update = std::chrono::steady_clock::now().time_since_epoch().count();
+
+                            std::lock_guard<std::mutex> send_lock(send_queue_mutex);
+                            auto& probe = remote->probe;
+                            if (probe.size != 0 && packet.mtu == probe.size) {
+
+                                // It is as good a round trip measurement as any other, unless we have resent it and
+                                // can't tell which one this answers
+                                if (probe.attempts == 0) {
+                                    remote->measure_round_trip(received - probe.sent);
+                                }
+
+                                // Datagrams this big get through so search the sizes above it
+                                probe.low       = probe.size;
+                                probe.size      = 0;
+                                probe.confirmed = true;
+                                next_probe(*remote, std::chrono::steady_clock::now());
+                            }
+                        }
+                    } break;
+
+                    // A packet telling us which types a remote wants to receive
+                    case SUBSCRIBE: {
+                        const SubscribePacket& packet = *reinterpret_cast<const SubscribePacket*>(payload);
+
+                        // Make sure we have the whole list before we use it
+                        size_t header_size = sizeof(SubscribePacket) - sizeof(uint64_t);
+                        if (!remote || length < header_size
+                            || length != header_size + size_t(packet.hash_count) * sizeof(uint64_t)) {
+                            return;
+                        }
+
+                        // We got a packet from them recently
+                        remote->last_update = std::chrono::steady_clock::now().time_since_epoch().count();
+
+                        std::vector<uint64_t> hashes(packet.hash_count);
+                        std::memcpy(hashes.data(), &packet.hashes, hashes.size() * sizeof(uint64_t));
+                        std::sort(hashes.begin(), hashes.end());
+
+                        // This is resent with every announce so only take the write lock if it changed
+                        bool changed = false;
+                        /* Mutex scope */ {
+                            std::shared_lock<std::shared_timed_mutex> lock(target_mutex);
+                            changed = !remote->subscribed || remote->subscriptions != hashes;
+                        }
+                        if (changed) {
+                            std::lock_guard<std::shared_timed_mutex> lock(target_mutex);
+                            remote->subscriptions = std::move(hashes);
+                            remote->subscribed    = true;
+                        }
+                    } break;
+
                     // A packet containing data
                     case DATA_RETRANSMISSION:
                     case DATA: {
 
                         // It's a data packet
-                        const DataPacket& packet = *reinterpret_cast<const DataPacket*>(payload.data());
+                        const DataPacket& packet = *reinterpret_cast<const DataPacket*>(payload);
 
                         // If the packet is obviously corrupt, drop it and since we didn't ack it it'll be resent if
                         // it's important
-                        if (packet.packet_no > packet.packet_count) {
+                        if (length + 1 < sizeof(DataPacket) || packet.packet_no >= packet.packet_count) {
                             return;
                         }
 
@@ -694,41 +1614,38 @@ namespace extension {
                         if (remote) {
 
                             // We got a packet from them recently
-                            remote->last_update = std::chrono::steady_clock::now();
+                            remote->last_update = std::chrono::steady_clock::now().time_since_epoch().count();
 
-                            // Check if this packet is a retransmission of data
-                            if (header.type == DATA_RETRANSMISSION) {
+                            // If we recently processed this packet it is a repeat, either a retransmission because
+                            // our ack failed or a fragment that arrived after we rebuilt it from parity. Reliable data
+                            // is only sent again as a retransmission, so the first time it is sent it is always new.
+                            if (remote->recently_received(packet.packet_id)
+                                && (packet.type == DATA_RETRANSMISSION || !packet.reliable)) {
 
-                                // See if we recently processed this packet
-                                auto it = std::find(
-                                    remote->recent_packets.begin(), remote->recent_packets.end(), packet.packet_id);
-
-                                // We recently processed this packet, this is just a failed ack
                                 // Send the ack again if it was reliable
-                                if (it != remote->recent_packets.end() && packet.reliable) {
-
-                                    // Allocate room for the whole ack packet
-                                    std::vector<char> r(sizeof(ACKPacket) + (packet.packet_count / 8), 0);
-                                    ACKPacket& response   = *reinterpret_cast<ACKPacket*>(r.data());
-                                    response              = ACKPacket();
-                                    response.packet_id    = packet.packet_id;
-                                    response.packet_no    = packet.packet_no;
-                                    response.packet_count = packet.packet_count;
-
-                                    // Set the bits for all packets (we got the whole thing)
-                                    for (int i = 0; i < packet.packet_count; ++i) {
-                                        (&response.packets)[i / 8] |= uint8_t(1 << (i % 8));
-                                    }
+                                if (packet.reliable) {
+                                    send_complete_ack(remote->target, packet);
+                                }
+
+                                // We don't need to process this packet we already did
+                                return;
+                            }
 
-                                    // Make who we are sending it to into a useable address
-                                    sock_t& to = remote->target;
+                            // Latest only data that is no newer than what we have already delivered is of no use
+                            if (packet.latest != 0
+                                && remote->stale(packet.hash, packet.latest, std::chrono::steady_clock::now())) {
 
-                                    // Send the packet
-                                    ::sendto(data_fd, r.data(), r.size(), 0, &to.sock, socket_size(to));
+                                // Tell the sender we are done with it so it stops sending it
+                                if (packet.reliable) {
+                                    send_complete_ack(remote->target, packet);
+                                }
 
-                                    // We don't need to process this packet we already did
-                                    return;
+                                // And throw away what we had of it
+                                if (packet.packet_count > 1) {
+                                    std::lock_guard<std::mutex> lock(remote->assemblers_mutex);
+                                    erase_assembler(*remote, packet.packet_id);
                                 }
+                                return;
                             }
 
                             // If this is a solo packet (in a single chunk)
@@ -736,210 +1653,412 @@ namespace extension {
 
                                 // Copy our data into a vector
                                 std::vector<char> out(&packet.data,
-                                                      &packet.data + payload.size() - sizeof(DataPacket) + 1);
+                                                      &packet.data + length - sizeof(DataPacket) + 1);
 
                                 // If this is a reliable packet, send an ack back
                                 if (packet.reliable) {
                                     // This response is easy since there is only one packet
-                                    ACKPacket response;
-                                    response.packet_id    = packet.packet_id;
-                                    response.packet_no    = packet.packet_no;
-                                    response.packet_count = packet.packet_count;
-                                    response.packets      = 1;
-
-                                    // Make who we are sending it to into a useable address
-                                    sock_t& to = remote->target;
-
-                                    sendto(data_fd,
-                                           reinterpret_cast<const char*>(&response),
-                                           sizeof(response),
-                                           0,
-                                           &to.sock,
-                                           socket_size(to));
+                                    send_complete_ack(remote->target, packet);
 
                                     // Set this packet to have been recently received
-                                    remote->recent_packets[++remote->recent_packets_index] = packet.packet_id;
+                                    remote->set_recently_received(packet.packet_id);
                                 }
 
-                                packet_callback(*remote, packet.hash, packet.reliable, std::move(out));
+                                if ((packet.latest == 0 || remote->deliver_latest(packet.hash, packet.latest))
+                                    && decompress(packet, out)) {
+                                    packet_callback(*remote, packet.hash, packet.reliable, received, std::move(out));
+                                }
                             }
                             else {
                                 std::lock_guard<std::mutex> lock(remote->assemblers_mutex);
 
-                                // Grab the payload and put it in our list of assemblers targets
-                                auto& assemblers = remote->assemblers;
-
-                                auto& assembler = assemblers[packet.packet_id];
-
-                                // First check that our cache isn't super corrupted by ensuring that our last packet
-                                // in our list isn't after the number of packets we have
-                                if (!assembler.second.empty()
-                                    && std::next(assembler.second.end(), -1)->first >= packet.packet_count) {
-
-                                    // If so, we need to purge our cache and if this was a reliable packet, send a
-                                    // NACK back for all the packets we thought we had
-                                    // We don't know if we have any packets except the one we just got
-                                    if (packet.reliable) {
-
-                                        // A basic ack has room for 8 packets and we need 1 extra byte for each 8
-                                        // additional packets
-                                        std::vector<char> r(sizeof(NACKPacket) + (packet.packet_count / 8), 0);
-                                        NACKPacket& response  = *reinterpret_cast<NACKPacket*>(r.data());
-                                        response              = NACKPacket();
-                                        response.packet_id    = packet.packet_id;
-                                        response.packet_count = packet.packet_count;
-
-                                        // Set the bits for the packets we thought we received
-                                        for (auto& p : assembler.second) {
-                                            (&response.packets)[p.first / 8] |= uint8_t(1 << (p.first % 8));
-                                        }
+                                // If they have left while we were getting this, there is nobody to build it for
+                                if (remote->removed) {
+                                    return;
+                                }
+
+                                // Work out where this fragment's data is and how big it is
+                                const char* fragment      = &packet.data;
+                                const size_t fragment_len = length - sizeof(DataPacket) + 1;
+                                const bool last           = packet.packet_no + 1 == packet.packet_count;
 
-                                        // Ensure the bit for this packet isn't NACKed
-                                        (&response.packets)[packet.packet_no / 8] &=
-                                            ~uint8_t(1 << (packet.packet_no % 8));
+                                // A fragment that isn't the last can't be empty
+                                if (!last && fragment_len == 0) {
+                                    return;
+                                }
 
-                                        // Make who we are sending it to into a useable address
-                                        sock_t& to = remote->target;
+                                // Make room for everything this fragment makes us allocate before allocating any
+                                // of it, so one packet claiming to be part of a huge group can't exceed our limits
+                                if (!reserve_assembler(*remote,
+                                                       packet.packet_id,
+                                                       NetworkTarget::Assembler::layout(
+                                                           packet.packet_count, last ? 0 : fragment_len, 0)
+                                                           + (last ? fragment_len : 0))) {
+                                    return;
+                                }
 
-                                        // Send the packet
-                                        ::sendto(data_fd, r.data(), r.size(), 0, &to.sock, socket_size(to));
+                                // Grab the payload and put it in our list of assemblers targets
+                                auto& assembler = remote->assemblers[packet.packet_id];
+
+                                // First check that our cache isn't corrupted by ensuring that this fragment agrees
+                                // with the shape of the packet group we have been building
+                                bool corrupt = false;
+                                if (assembler.packet_count != 0) {
+                                    if (assembler.packet_count != packet.packet_count) {
+                                        corrupt = true;
                                     }
+                                    else if (last) {
+                                        corrupt =
+                                            assembler.fragment_size != 0 && fragment_len > assembler.fragment_size;
+                                    }
+                                    else if (assembler.fragment_size != 0) {
+                                        corrupt = fragment_len != assembler.fragment_size;
+                                    }
+                                    else {
+                                        corrupt = assembler.tail.size() > fragment_len;
+                                    }
+                                }
+                                if (corrupt) {
 
+                                    // If so, we need to purge our cache, and if this was a reliable packet we NACK it
+                                    // below so the packets we thought we had are sent again
                                     // Clear our packets here (the one we just got will be added right after this)
-                                    assembler.second.clear();
+                                    // We keep the memory we counted it as using so it is released when we recount it
+                                    size_t bytes    = assembler.bytes;
+                                    assembler       = NetworkTarget::Assembler();
+                                    assembler.bytes = bytes;
                                 }
 
-                                // Add our packet to our list of assemblers
-                                assembler.first                    = std::chrono::steady_clock::now();
-                                assembler.second[packet.packet_no] = std::move(payload);
+                                // If this is a new packet group, set up the bitset of what we have received
+                                if (assembler.packet_count == 0) {
+                                    assembler.packet_count = packet.packet_count;
+                                    assembler.received.assign((packet.packet_count / 8) + 1, 0);
+                                }
+                                assembler.reliable    = packet.reliable;
+                                assembler.last_update = std::chrono::steady_clock::now();
+
+                                // Add our fragment if we haven't already got it
+                                if (!assembler.has(packet.packet_no)) {
+                                    assembler.add(packet.packet_no);
+
+                                    // Every fragment but the last is the same size, so once we have seen one of them
+                                    // we know where every fragment goes and can allocate the whole group at once
+                                    if (!last && assembler.fragment_size == 0) {
+                                        assembler.fragment_size = fragment_len;
+                                        assembler.data.resize(size_t(assembler.packet_count) * fragment_len);
+
+                                        // Place the last fragment if it arrived before we knew where it goes
+                                        if (!assembler.tail.empty()) {
+                                            std::memcpy(
+                                                assembler.data.data()
+                                                    + size_t(assembler.packet_count - 1) * fragment_len,
+                                                assembler.tail.data(),
+                                                assembler.tail.size());
+                                            assembler.tail = std::vector<char>();
+                                        }
+                                    }
 
-                                // Create and send our ACK packet if this is a reliable transmission
-                                if (packet.reliable) {
-                                    // A basic ack has room for 8 packets and we need 1 extra byte for each 8
-                                    // additional packets
-                                    std::vector<char> r(sizeof(ACKPacket) + (packet.packet_count / 8), 0);
-                                    ACKPacket& response   = *reinterpret_cast<ACKPacket*>(r.data());
-                                    response              = ACKPacket();
-                                    response.packet_id    = packet.packet_id;
-                                    response.packet_no    = packet.packet_no;
-                                    response.packet_count = packet.packet_count;
-
-                                    // Set the bits for the packets we have received
-                                    for (auto& p : assembler.second) {
-                                        (&response.packets)[p.first / 8] |= uint8_t(1 << (p.first % 8));
+                                    if (last) {
+                                        // The last fragment tells us how big the whole group is
+                                        assembler.last_size = fragment_len;
+                                        if (assembler.fragment_size == 0) {
+                                            assembler.tail.assign(fragment, fragment + fragment_len);
+                                        }
+                                        else {
+                                            std::memcpy(assembler.data.data()
+                                                            + packet.packet_no * assembler.fragment_size,
+                                                        fragment,
+                                                        fragment_len);
+                                        }
+                                    }
+                                    else {
+                                        std::memcpy(assembler.data.data() + packet.packet_no * assembler.fragment_size,
+                                                    fragment,
+                                                    fragment_len);
                                     }
+                                }
 
-                                    // Make who we are sending it to into a useable address
-                                    sock_t& to = remote->target;
+                                // If we have parity for this fragment's block we might be able to rebuild a lost one
+                                if (assembler.block_size != 0) {
+                                    recover_fragment(assembler, packet.packet_no / assembler.block_size);
+                                }
 
-                                    // Send the packet
-                                    ::sendto(data_fd, r.data(), r.size(), 0, &to.sock, socket_size(to));
+                                // Create and send our ACK packet if this is a reliable transmission, or our NACK
+                                // saying this fragment is all we have if we threw away the rest
+                                if (packet.reliable) {
+                                    if (corrupt) {
+                                        send_nack(remote->target, packet.packet_id, packet.packet_count, &assembler);
+                                    }
+                                    else {
+                                        send_ack(remote->target, packet, assembler);
+                                    }
                                 }
 
+                                // Let anyone watching know how far through a bulk transfer we are
+                                report_progress(*remote,
+                                                packet.hash,
+                                                false,
+                                                assembler.received_count,
+                                                packet.packet_count,
+                                                assembler.fragment_size,
+                                                assembler.reported);
+
                                 // Check to see if we have enough to assemble the whole thing
-                                if (assembler.second.size() == packet.packet_count) {
+                                if (assembler.received_count == packet.packet_count) {
 
-                                    // Work out exactly how much data we will need first so we only need one
-                                    // allocation
-                                    size_t payload_size = 0;
-                                    for (auto& packet : assembler.second) {
-                                        payload_size += packet.second.size() - sizeof(DataPacket) + 1;
-                                    }
-
-                                    // Read in our data
-                                    std::vector<char> out;
-                                    out.reserve(payload_size);
-                                    for (auto& packet : assembler.second) {
-                                        const DataPacket& p = *reinterpret_cast<DataPacket*>(packet.second.data());
-                                        out.insert(out.end(),
-                                                   &p.data,
-                                                   &p.data + packet.second.size() - sizeof(DataPacket) + 1);
-                                    }
+                                    // Trim the space we reserved for the last fragment, which leaves the data in place
+                                    std::vector<char> out = std::move(assembler.data);
+                                    out.resize((packet.packet_count - 1) * assembler.fragment_size
+                                               + assembler.last_size);
 
                                     // Send our assembled data packet
-                                    packet_callback(*remote, packet.hash, packet.reliable, std::move(out));
+                                    if ((packet.latest == 0 || remote->deliver_latest(packet.hash, packet.latest))
+                                        && decompress(packet, out)) {
+                                        packet_callback(
+                                            *remote, packet.hash, packet.reliable, received, std::move(out));
+                                    }
 
-                                    // If the packet was reliable add that it was recently received
-                                    if (packet.reliable) {
+                                    // If the packet was reliable or has parity that may still arrive, add that it
+                                    // was recently received
+                                    if (packet.reliable || assembler.block_size != 0) {
                                         // Set this packet to have been recently received
-                                        remote->recent_packets[++remote->recent_packets_index] = packet.packet_id;
+                                        remote->set_recently_received(packet.packet_id);
                                     }
 
                                     // We have completed this packet, discard the data
-                                    assemblers.erase(assemblers.find(packet.packet_id));
+                                    erase_assembler(*remote, packet.packet_id);
+                                }
+                                else {
+                                    // Count the memory it now uses and make sure we haven't used too much
+                                    account_assembler(*remote, assembler);
+                                    limit_assemblers(*remote, packet.packet_id);
                                 }
                             }
                         }
                     } break;
 
+                    // Parity that lets us rebuild a lost fragment of unreliable data
+                    case PARITY: {
+                        const ParityPacket& packet = *reinterpret_cast<const ParityPacket*>(payload);
+
+                        // Check the parity makes sense before we trust it
+                        if (!remote || length < sizeof(ParityPacket) - 1
+                            || length != sizeof(ParityPacket) - 1 + packet.fragment_size || packet.packet_count < 2
+                            || packet.block_size == 0 || packet.fragment_size == 0
+                            || packet.last_size > packet.fragment_size
+                            || uint64_t(packet.block_no) * packet.block_size >= packet.packet_count) {
+                            return;
+                        }
+
+                        // We got a packet from them recently
+                        remote->last_update = std::chrono::steady_clock::now().time_since_epoch().count();
+
+                        // If we already finished this group there is nothing to rebuild
+                        if (remote->recently_received(packet.packet_id)) {
+                            return;
+                        }
+
+                        std::lock_guard<std::mutex> lock(remote->assemblers_mutex);
+                        if (remote->removed) {
+                            return;
+                        }
+
+                        // Make room for the whole group before we allocate any of it
+                        size_t blocks = (size_t(packet.packet_count) + packet.block_size - 1) / packet.block_size;
+                        if (!reserve_assembler(
+                                *remote,
+                                packet.packet_id,
+                                NetworkTarget::Assembler::layout(packet.packet_count, packet.fragment_size, blocks))) {
+                            return;
+                        }
+                        auto& assembler = remote->assemblers[packet.packet_id];
+
+                        // If this doesn't match what we have been building, it's not for the same group
+                        if (assembler.packet_count != 0
+                            && (assembler.packet_count != packet.packet_count
+                                || (assembler.fragment_size != 0 && assembler.fragment_size != packet.fragment_size))) {
+                            return;
+                        }
+
+                        // Parity tells us the shape of the group so we can set it up if it's the first we've seen
+                        if (assembler.packet_count == 0) {
+                            assembler.packet_count = packet.packet_count;
+                            assembler.received.assign((packet.packet_count / 8) + 1, 0);
+                        }
+                        if (assembler.fragment_size == 0) {
+                            assembler.fragment_size = packet.fragment_size;
+                            assembler.data.resize(size_t(assembler.packet_count) * packet.fragment_size);
+
+                            // Place the last fragment if it arrived before we knew where it goes
+                            if (!assembler.tail.empty()) {
+                                std::memcpy(assembler.data.data()
+                                                + size_t(assembler.packet_count - 1) * packet.fragment_size,
+                                            assembler.tail.data(),
+                                            assembler.tail.size());
+                                assembler.tail = std::vector<char>();
+                            }
+                        }
+                        assembler.last_size   = packet.last_size;
+                        assembler.block_size  = packet.block_size;
+                        assembler.last_update = std::chrono::steady_clock::now();
+
+                        // Keep the parity until we are able to use it
+                        assembler.parity.resize(blocks);
+                        assembler.parity[packet.block_no].assign(&packet.data, &packet.data + packet.fragment_size);
+                        recover_fragment(assembler, packet.block_no);
+
+                        // If that was the last piece we needed, we have the whole thing
+                        if (assembler.received_count == assembler.packet_count) {
+                            std::vector<char> out = std::move(assembler.data);
+                            out.resize((assembler.packet_count - 1) * assembler.fragment_size + assembler.last_size);
+
+                            DataPacket header;
+                            header.compression = packet.compression;
+                            if ((packet.latest == 0 || remote->deliver_latest(packet.hash, packet.latest))
+                                && decompress(header, out)) {
+                                packet_callback(*remote, packet.hash, false, received, std::move(out));
+                            }
+
+                            // Remember we finished this so later parity doesn't start it again
+                            remote->set_recently_received(packet.packet_id);
+                            erase_assembler(*remote, packet.packet_id);
+                        }
+                        else {
+                            account_assembler(*remote, assembler);
+                            limit_assemblers(*remote, packet.packet_id);
+                        }
+                    } break;
+
                     // Packet acknowledging the receipt of a packet of data
                     case ACK: {
 
                         // It's an ack packet
-                        const ACKPacket& packet = *reinterpret_cast<const ACKPacket*>(payload.data());
+                        const ACKPacket& packet = *reinterpret_cast<const ACKPacket*>(payload);
 
                         // Check if we know who this is and if we don't know them, ignore
                         if (remote) {
 
                             // We got a packet from them recently
-                            remote->last_update = std::chrono::steady_clock::now();
+                            remote->last_update = std::chrono::steady_clock::now().time_since_epoch().count();
 
                             // lock the send queue mutex
                             std::lock_guard<std::mutex> send_lock(send_queue_mutex);
 
                             // Check for our packet id in the send queue
-                            if (send_queue.count(packet.packet_id) > 0) {
+                            auto q = send_queue.find(packet.packet_id);
+                            if (q != nullptr) {
 
-                                auto& queue = send_queue[packet.packet_id];
+                                auto& queue = *q;
 
                                 // Find this target in the send queue
-                                auto s = std::find_if(queue.targets.begin(),
-                                                      queue.targets.end(),
-                                                      [&](const PacketQueue::PacketTarget& target) {
-                                                          return target.target.lock() == remote;
-                                                      });
+                                auto s = queue.find(*remote);
 
                                 // Check for all the ways this ACK could be invalid:
                                 // From an unknown person
-                                if (s != queue.targets.end()
+                                if (s != nullptr
                                     // Wrong packet
-                                    && packet.packet_count == queue.header.packet_count
+                                    && packet.packet_count == s->packet_count
                                     // Truncated packet
-                                    && payload.size() == (sizeof(ACKPacket) + (queue.header.packet_count / 8))) {
-
-                                    // Work out about how long our round trip time is
+                                    && length >= sizeof(ACKPacket) - sizeof(AckRange)
+                                    && length
+                                           == sizeof(ACKPacket) - sizeof(AckRange)
+                                                  + size_t(packet.range_count) * sizeof(AckRange)
+                                    // Nonsense packet
+                                    && packet.packet_no < packet.packet_count
+                                    && packet.cumulative <= packet.packet_count) {
+
+                                    // Work out about how long our round trip time is, using when the ACK arrived
+                                    // rather than when we got around to processing it
                                     auto now        = std::chrono::steady_clock::now();
-                                    auto round_trip = now - s->last_send;
+                                    auto round_trip = received - s->last_send;
 
                                     // Approximate how long the round trip is to this remote so we can work out how
                                     // long before retransmitting
                                     // We use a baby kalman filter to help smooth out jitter
                                     remote->measure_round_trip(round_trip);
 
-                                    // Update our acks
-                                    bool all_acked = true;
-                                    for (unsigned i = 0; i < s->acked.size(); ++i) {
+                                    // Update our acks, counting the packets this ack tells us about for the first
+                                    // time
+                                    size_t newly_acked   = 0;
+                                    size_t acked_flights = 0;
+                                    auto ack             = [&](uint32_t i) {
+                                        uint8_t bit = uint8_t(1 << (i % 8));
+                                        if ((s->acked[i / 8] & bit) == 0) {
+                                            if ((s->sent[i / 8] & bit) != 0) {
+                                                s->sent[i / 8] &= ~bit;
+                                                ++acked_flights;
+                                            }
+                                            s->acked[i / 8] |= bit;
+                                            ++s->acked_count;
+                                            ++newly_acked;
+                                            s->highest_acked = std::max(s->highest_acked, s->sequence[i]);
+                                        }
+                                    };
+
+                                    // Everything before the cumulative point has been received, and we already know
+                                    // about everything before our own
+                                    for (uint32_t i = s->acked_below; i < packet.cumulative; ++i) {
+                                        ack(i);
+                                    }
 
-                                        // Update our bitset
-                                        s->acked[i] |= (&packet.packets)[i];
+                                    // Then the runs received after it, skipping bytes we know are all acked
+                                    for (uint8_t r = 0; r < packet.range_count; ++r) {
+                                        const AckRange& range = (&packet.ranges)[r];
+                                        if (range.first > range.last || range.last >= packet.packet_count) {
+                                            continue;
+                                        }
+                                        for (uint32_t i = range.first; i <= range.last; ++i) {
+                                            if (i % 8 == 0 && range.last - i >= 7 && s->acked[i / 8] == 0xFF) {
+                                                i += 7;
+                                                continue;
+                                            }
+                                            ack(i);
+                                        }
+                                    }
 
-                                        // Work out what a "fully acked" packet would look like
-                                        uint8_t expected = i + 1 < s->acked.size() || packet.packet_count % 8 == 0
-                                                               ? 0xFF
-                                                               : 0xFF >> (8 - (packet.packet_count % 8));
+                                    // And the packet that caused this ack
+                                    ack(packet.packet_no);
 
-                                        all_acked &= static_cast<int>((s->acked[i] & expected) == expected);
+                                    // Move our own cumulative point past everything that is now acked
+                                    while (s->acked_below < packet.packet_count
+                                           && (s->acked[s->acked_below / 8] & uint8_t(1 << (s->acked_below % 8)))
+                                                  != 0) {
+                                        ++s->acked_below;
+                                    }
+                                    bool all_acked = s->acked_count == packet.packet_count;
+
+                                    // Let anyone watching know how far through a bulk transfer we are
+                                    report_progress(*remote,
+                                                    queue.header.hash,
+                                                    true,
+                                                    s->acked_count,
+                                                    packet.packet_count,
+                                                    s->fragment_size,
+                                                    s->reported);
+
+                                    // Acked packets are no longer in flight and tell us we can send a little faster
+                                    remote->congestion.in_flight -= std::min(remote->congestion.in_flight, acked_flights);
+                                    remote->congestion_acked(newly_acked);
+
+                                    // If packets sent well after one that is still in flight have been acked, it was
+                                    // most likely lost so resend it now rather than waiting for its timer
+                                    if (s->highest_acked >= REORDER_THRESHOLD
+                                        && mark_lost(*remote, *s, 0, s->highest_acked - REORDER_THRESHOLD) > 0) {
+                                        remote->congestion_lost(now);
                                     }
 
                                     // The remote has received this entire packet we can erase our sender
                                     if (all_acked) {
-                                        queue.targets.erase(s);
+                                        queue.erase(s - queue.targets.data());
 
                                         // If we're all done remove the whole thing
                                         if (queue.targets.empty()) {
                                             send_queue.erase(packet.packet_id);
                                         }
                                     }
+
+                                    // Now that there is room in the window send more
+                                    transmit(remote);
                                 }
                             }
                         }
@@ -948,61 +2067,84 @@ namespace extension {
                     // Packet requesting a retransmission of some corrupt data
                     case NACK: {
                         // It's a nack packet
-                        const NACKPacket& packet = *reinterpret_cast<const NACKPacket*>(payload.data());
+                        const NACKPacket& packet = *reinterpret_cast<const NACKPacket*>(payload);
 
                         // Check if we know who this is and if we don't know them, ignore
                         if (remote) {
 
                             // We got a packet from them recently
-                            remote->last_update = std::chrono::steady_clock::now();
+                            remote->last_update = std::chrono::steady_clock::now().time_since_epoch().count();
+
+                            // lock the send queue mutex
+                            std::lock_guard<std::mutex> send_lock(send_queue_mutex);
 
                             // Check for our packet id in the send queue
-                            if (send_queue.count(packet.packet_id) > 0) {
+                            auto q = send_queue.find(packet.packet_id);
+                            if (q != nullptr) {
 
                                 // Find this packet in our sending queue
-                                auto& queue = send_queue[packet.packet_id];
+                                auto& queue = *q;
 
                                 // Find this target in the send queue
-                                auto s = std::find_if(queue.targets.begin(),
-                                                      queue.targets.end(),
-                                                      [&](const PacketQueue::PacketTarget& target) {
-                                                          return target.target.lock() == remote;
-                                                      });
+                                auto s = queue.find(*remote);
 
                                 // Validate that the nack is relevant and valid
                                 // We know who it is
-                                if (s != queue.targets.end()
+                                if (s != nullptr
                                     // It's not corrupted
-                                    && packet.packet_count == queue.header.packet_count
+                                    && packet.packet_count == s->packet_count
                                     // It's not truncated
-                                    && payload.size() == (sizeof(NACKPacket) + (queue.header.packet_count / 8))) {
-
-                                    // Store the time as we are now sending new packets
-                                    s->last_send = std::chrono::steady_clock::now();
-
-                                    // The next time we should check for a timeout
-                                    auto next_timeout = s->last_send + remote->round_trip_time;
-                                    if (next_timeout < next_event) {
-                                        next_event = next_timeout;
-                                        next_event_callback(next_event);
+                                    && length >= sizeof(NACKPacket) - sizeof(AckRange)
+                                    && length
+                                           == sizeof(NACKPacket) - sizeof(AckRange)
+                                                  + size_t(packet.range_count) * sizeof(AckRange)
+                                    // Nonsense packet
+                                    && packet.cumulative <= packet.packet_count) {
+
+                                    // Packets that were in flight are now lost
+                                    size_t lost = 0;
+                                    for (uint8_t sent : s->sent) {
+                                        for (uint8_t b = sent; b != 0; b &= b - 1) {
+                                            ++lost;
+                                        }
                                     }
 
-                                    // Update our acks with the nacked data
-                                    for (unsigned i = 0; i < s->acked.size(); ++i) {
-
-                                        // Update our bitset
-                                        s->acked[i] &= ~(&packet.packets)[i];
+                                    // They threw away what they had so only what they still hold counts as acked
+                                    std::fill(s->acked.begin(), s->acked.end(), 0);
+                                    std::fill(s->sent.begin(), s->sent.end(), 0);
+                                    s->acked_below = 0;
+                                    s->acked_count = 0;
+                                    auto held      = [&](uint32_t i) {
+                                        uint8_t bit = uint8_t(1 << (i % 8));
+                                        if ((s->acked[i / 8] & bit) == 0) {
+                                            s->acked[i / 8] |= bit;
+                                            ++s->acked_count;
+                                        }
+                                    };
+                                    for (uint32_t i = 0; i < packet.cumulative; ++i) {
+                                        held(i);
                                     }
-
-                                    // Now we have to retransmit the nacked packets
-                                    for (int i = 0; i < packet.packet_count * 8; ++i) {
-
-                                        // Check if this packet needs to be sent
-                                        uint8_t bit = 1 << (i % 8);
-                                        if (((&packet.packets)[i] & bit) == bit) {
-                                            send_packet(remote->target, queue.header, i, queue.payload, true);
+                                    for (uint8_t r = 0; r < packet.range_count; ++r) {
+                                        const AckRange& range = (&packet.ranges)[r];
+                                        if (range.first > range.last || range.last >= packet.packet_count) {
+                                            continue;
+                                        }
+                                        for (uint32_t i = range.first; i <= range.last; ++i) {
+                                            held(i);
                                         }
                                     }
+                                    while (s->acked_below < packet.packet_count
+                                           && (s->acked[s->acked_below / 8] & uint8_t(1 << (s->acked_below % 8)))
+                                                  != 0) {
+                                        ++s->acked_below;
+                                    }
+
+                                    // Losing packets means we are sending too fast
+                                    remote->congestion.in_flight -= std::min(remote->congestion.in_flight, lost);
+                                    remote->congestion_lost(std::chrono::steady_clock::now());
+
+                                    // Now we have to retransmit the rest of the group as our window allows
+                                    transmit(remote);
                                 }
                             }
                         }
@@ -1013,12 +2155,18 @@ namespace extension {
 
 
         std::vector<fd_t> NUClearNetwork::listen_fds() {
-            return std::vector<fd_t>({data_fd, announce_fd});
+            std::vector<fd_t> fds(data_fds);
+            fds.push_back(announce_fd);
+            if (probe_fd >= 0) {
+                fds.push_back(probe_fd);
+            }
+            return fds;
         }
 
         void NUClearNetwork::send_packet(const sock_t& target,
                                          NUClear::extension::network::DataPacket header,
-                                         uint16_t packet_no,
+                                         uint16_t fragment_size,
+                                         uint32_t packet_no,
                                          const std::vector<char>& payload,
                                          const bool& /*reliable*/) {
 
@@ -1037,8 +2185,8 @@ namespace extension {
 
             // Work out what chunk of data we are sending const cast is fine as posix guarantees it won't be
             // modified
-            data[1].iov_base = const_cast<char*>(payload.data() + (packet_data_mtu * packet_no));  // NOLINT
-            data[1].iov_len  = packet_no + 1 < header.packet_count ? packet_data_mtu : payload.size() % packet_data_mtu;
+            data[1].iov_base = const_cast<char*>(payload.data() + (size_t(fragment_size) * packet_no));  // NOLINT
+            data[1].iov_len  = packet_no + 1 < header.packet_count ? fragment_size : payload.size() % fragment_size;
 
             // Set our target and send (once again const cast is fine)
             message.msg_name    = const_cast<sockaddr*>(&target.sock);  // NOLINT
@@ -1050,16 +2198,321 @@ namespace extension {
         }
 
 
+        void NUClearNetwork::send_packets(const sock_t& target,
+                                          const DataPacket& header,
+                                          uint16_t fragment_size,
+                                          const std::vector<uint32_t>& packet_nos,
+                                          const std::vector<char>& payload) {
+
+#ifdef __linux__
+            // Each packet needs its own header and iovecs since the packet number changes
+            std::array<DataPacket, SEND_BATCH> headers;
+            std::array<std::array<iovec, 2>, SEND_BATCH> data{};
+            std::array<mmsghdr, SEND_BATCH> messages{};
+
+            for (size_t start = 0; start < packet_nos.size(); start += SEND_BATCH) {
+                size_t count = std::min(SEND_BATCH, packet_nos.size() - start);
+
+                std::memset(messages.data(), 0, sizeof(messages));
+                for (size_t i = 0; i < count; ++i) {
+                    uint32_t packet_no = packet_nos[start + i];
+
+                    // Update our headers packet number and set it in the message
+                    headers[i]           = header;
+                    headers[i].packet_no = packet_no;
+                    data[i][0].iov_base  = reinterpret_cast<char*>(&headers[i]);
+                    data[i][0].iov_len   = sizeof(DataPacket) - 1;
+
+                    // Work out what chunk of data we are sending const cast is fine as posix guarantees it won't be
+                    // modified
+                    data[i][1].iov_base =
+                        const_cast<char*>(payload.data() + (size_t(fragment_size) * packet_no));  // NOLINT
+                    data[i][1].iov_len =
+                        packet_no + 1 < header.packet_count ? fragment_size : payload.size() % fragment_size;
+
+                    // Set our target (once again const cast is fine)
+                    messages[i].msg_hdr.msg_iov     = data[i].data();
+                    messages[i].msg_hdr.msg_iovlen  = 2;
+                    messages[i].msg_hdr.msg_name    = const_cast<sockaddr*>(&target.sock);  // NOLINT
+                    messages[i].msg_hdr.msg_namelen = socket_size(target);
+                }
+
+                // Send the whole batch, the kernel may not take all of it at once
+                for (size_t sent = 0; sent < count;) {
+                    int result = sendmmsg(data_fd, messages.data() + sent, count - sent, 0);
+                    if (result < 0) {
+                        // If we were interrupted try again, otherwise give up and let the retransmission handle it
+                        if (network_errno == EINTR) {
+                            continue;
+                        }
+                        break;
+                    }
+                    sent += result;
+                }
+            }
+#else
+            for (const auto& packet_no : packet_nos) {
+                send_packet(target, header, fragment_size, packet_no, payload, header.reliable);
+            }
+#endif
+        }
+
+
+        std::vector<std::vector<char>> NUClearNetwork::make_parity(const DataPacket& header,
+                                                                   uint16_t fragment_size,
+                                                                   const std::vector<char>& payload) {
+
+            std::vector<std::vector<char>> parity;
+            for (uint64_t first = 0; first < header.packet_count; first += fec_block_size) {
+
+                std::vector<char> p(sizeof(ParityPacket) - 1 + fragment_size, 0);
+                ParityPacket& pkt = *reinterpret_cast<ParityPacket*>(p.data());
+                pkt               = ParityPacket();
+                pkt.packet_id     = header.packet_id;
+                pkt.block_no      = uint32_t(first / fec_block_size);
+                pkt.block_size    = fec_block_size;
+                pkt.packet_count  = header.packet_count;
+                pkt.fragment_size = fragment_size;
+                pkt.last_size     = uint16_t(payload.size() % fragment_size);
+                pkt.compression   = header.compression;
+                pkt.latest        = header.latest;
+                pkt.hash          = header.hash;
+
+                // XOR together every fragment in this block, the last fragment is shorter and padded with zeros
+                char* out = &pkt.data;
+                for (uint64_t i = first; i < std::min<uint64_t>(first + fec_block_size, header.packet_count); ++i) {
+                    const char* fragment = payload.data() + i * fragment_size;
+                    size_t size          = i + 1 < header.packet_count ? fragment_size : payload.size() % fragment_size;
+                    for (size_t j = 0; j < size; ++j) {
+                        out[j] ^= fragment[j];
+                    }
+                }
+
+                parity.push_back(std::move(p));
+            }
+
+            return parity;
+        }
+
+
+        void NUClearNetwork::recover_fragment(NetworkTarget::Assembler& assembler, uint32_t block) {
+
+            // We need the parity for this block and to know where fragments go
+            if (block >= assembler.parity.size() || assembler.parity[block].empty() || assembler.fragment_size == 0) {
+                return;
+            }
+
+            // Parity can only rebuild a block that is missing exactly one fragment
+            uint64_t first   = uint64_t(block) * assembler.block_size;
+            uint64_t end     = std::min<uint64_t>(first + assembler.block_size, assembler.packet_count);
+            bool all_present = true;
+            uint64_t missing = 0;
+            for (uint64_t i = first; i < end; ++i) {
+                if (!assembler.has(uint32_t(i))) {
+                    if (!all_present) {
+                        return;
+                    }
+                    all_present = false;
+                    missing     = i;
+                }
+            }
+
+            // The lost fragment is the parity with every other fragment in the block XORed out of it
+            if (!all_present) {
+                const size_t size = assembler.fragment_size;
+                char* out         = assembler.data.data() + missing * size;
+                std::memcpy(out, assembler.parity[block].data(), size);
+                for (uint64_t i = first; i < end; ++i) {
+                    if (i != missing) {
+                        const char* fragment = assembler.data.data() + i * size;
+                        for (size_t j = 0; j < size; ++j) {
+                            out[j] ^= fragment[j];
+                        }
+                    }
+                }
+
+                assembler.add(uint32_t(missing));
+            }
+
+            // Either way this block is complete and we don't need its parity anymore
+            assembler.parity[block] = std::vector<char>();
+        }
+
+
+        void NUClearNetwork::account_assembler(NetworkTarget& target, NetworkTarget::Assembler& assembler) {
+
+            // Apply the change in its memory to the target and to our total
+            size_t bytes = assembler.memory();
+            if (bytes > assembler.bytes) {
+                target.assembler_bytes += bytes - assembler.bytes;
+                total_assembler_bytes += bytes - assembler.bytes;
+            }
+            else {
+                target.assembler_bytes -= assembler.bytes - bytes;
+                total_assembler_bytes -= assembler.bytes - bytes;
+            }
+            assembler.bytes = bytes;
+        }
+
+
+        void NUClearNetwork::erase_assembler(NetworkTarget& target, uint16_t packet_id) {
+
+            auto assembler = target.assemblers.find(packet_id);
+            if (assembler != nullptr) {
+                target.assembler_bytes -= assembler->bytes;
+                total_assembler_bytes -= assembler->bytes;
+                target.assemblers.erase(packet_id);
+            }
+        }
+
+
+        void NUClearNetwork::evict_assembler(NetworkTarget& target, uint16_t packet_id) {
+
+            auto assembler = target.assemblers.find(packet_id);
+            if (assembler == nullptr) {
+                return;
+            }
+
+            // The sender thinks we have the fragments we acked, so NACK the group to have it sent again
+            if (assembler->reliable && assembler->received_count > 0) {
+                send_nack(target.target, packet_id, assembler->packet_count);
+            }
+
+            ++target.assemblers_evicted;
+            ++total_assemblers_evicted;
+            erase_assembler(target, packet_id);
+        }
+
+
+        bool NUClearNetwork::limit_assemblers(NetworkTarget& target, uint16_t current, size_t growth) {
+
+            auto over = [&] {
+                return target.assembler_bytes + growth > target_assembler_limit
+                       || total_assembler_bytes + growth > total_assembler_limit;
+            };
+            if (!over()) {
+                return true;
+            }
+
+            // Order the other packet groups from the one that has waited longest for a fragment
+            std::vector<std::pair<std::chrono::steady_clock::time_point, uint16_t>> groups;
+            target.assemblers.for_each([&](uint16_t id, const NetworkTarget::Assembler& assembler) {
+                if (id != current) {
+                    groups.emplace_back(assembler.last_update, id);
+                }
+            });
+            std::sort(groups.begin(), groups.end());
+
+            // Throw them away until we fit, and if they weren't enough throw away this one too
+            for (const auto& group : groups) {
+                if (!over()) {
+                    return true;
+                }
+                evict_assembler(target, group.second);
+            }
+            if (over()) {
+                evict_assembler(target, current);
+                return false;
+            }
+            return true;
+        }
+
+
+        bool NUClearNetwork::reserve_assembler(NetworkTarget& target, uint16_t packet_id, size_t bytes) {
+
+            // Only the memory the group doesn't already have counts against our limits
+            auto assembler   = target.assemblers.find(packet_id);
+            size_t allocated = assembler == nullptr ? 0 : assembler->allocated();
+            if (bytes <= allocated) {
+                return true;
+            }
+
+            bool exists = assembler != nullptr;
+            if (limit_assemblers(target, packet_id, bytes - allocated)) {
+                return true;
+            }
+
+            // A group we never started is still one we had to throw away
+            if (!exists) {
+                ++target.assemblers_evicted;
+                ++total_assemblers_evicted;
+            }
+            return false;
+        }
+
+
+        bool NUClearNetwork::decompress(const DataPacket& packet, std::vector<char>& data) const {
+
+            switch (packet.compression) {
+                case NONE: return true;
+                case LZ4: {
+                    // Read how big the data was before it was compressed
+                    if (data.size() < sizeof(uint32_t)) {
+                        return false;
+                    }
+                    uint32_t size = 0;
+                    for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+                        size |= uint32_t(uint8_t(data[i])) << (i * 8);
+                    }
+
+                    // Don't allocate more than the data could really hold or we would hold for a packet group
+                    size_t compressed = data.size() - sizeof(uint32_t);
+                    if (size > compressed * lz4::MAX_EXPANSION
+                        || size > std::min(target_assembler_limit.load(), total_assembler_limit.load())) {
+                        return false;
+                    }
+
+                    std::vector<char> out(size);
+                    if (!lz4::decompress(
+                            data.data() + sizeof(uint32_t), data.size() - sizeof(uint32_t), out.data(), out.size())) {
+                        return false;
+                    }
+                    data = std::move(out);
+                    return true;
+                }
+                // We don't know how to read this
+                default: return false;
+            }
+        }
+
+
         void NUClearNetwork::send(const uint64_t& hash,
-                                  const std::vector<char>& payload,
+                                  const std::shared_ptr<const std::vector<char>>& uncompressed,
                                   const std::string& target,
-                                  bool reliable) {
+                                  bool reliable,
+                                  bool compress,
+                                  bool latest) {
 
             // If we are not connected throw an error
             if (targets.empty()) {
                 throw std::runtime_error("Cannot send messages as the network is not connected");
             }
 
+            // Compress the data if we were asked to or it is big enough, but only keep it if it got smaller
+            auto data               = uncompressed;
+            Compression compression = NONE;
+            if (compress || (compression_threshold != 0 && uncompressed->size() >= compression_threshold)) {
+                auto block = lz4::compress(uncompressed->data(), uncompressed->size());
+
+                if (block.size() + sizeof(uint32_t) < uncompressed->size()) {
+                    auto out = std::make_shared<std::vector<char>>(sizeof(uint32_t));
+                    for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+                        (*out)[i] = char((uncompressed->size() >> (i * 8)) & 0xFF);
+                    }
+                    out->insert(out->end(), block.begin(), block.end());
+
+                    data        = std::move(out);
+                    compression = LZ4;
+                }
+            }
+
+            const std::vector<char>& payload = *data;
+
+            // Packet numbers are 32 bit so that is the most fragments we can split the data into, even for a target
+            // with the smallest path mtu
+            if (payload.size() / std::min(packet_data_mtu, min_data_mtu) >= std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Cannot send messages that need more than 2^32 - 1 packets");
+            }
 
             // The header for our packet
             DataPacket header;
@@ -1067,19 +2520,29 @@ namespace extension {
             /* Mutex Scope */ {
                 std::lock_guard<std::mutex> lock(send_queue_mutex);
                 // For the packet id we ensure that it's not currently used for retransmission
-                while (send_queue.count(header.packet_id = ++packet_id_source) > 0) {
+                while (send_queue.contains(header.packet_id = ++packet_id_source)) {
+                }
+
+                // Latest only data is numbered so receivers can tell which is newest, 0 means it isn't latest only
+                if (latest) {
+                    uint32_t& sequence = latest_sequence[hash];
+                    if (++sequence == 0) {
+                        ++sequence;
+                    }
+                    header.latest = sequence;
                 }
             }
 
             header.packet_no    = 0;
-            header.packet_count = uint16_t((payload.size() / packet_data_mtu) + 1);
+            header.packet_count = uint32_t((payload.size() / packet_data_mtu) + 1);
             header.reliable     = reliable;
+            header.compression  = compression;
             header.hash         = hash;
 
-            // If this was a reliable packet we need to cache it in case it needs to be resent
+            // If this was a reliable packet we queue it and send it as fast as the network will let us
             if (reliable) {
 
-                std::lock_guard<std::mutex> lock_target(target_mutex);
+                std::shared_lock<std::shared_timed_mutex> lock_target(target_mutex);
                 std::lock_guard<std::mutex> lock_send(send_queue_mutex);
 
                 auto& queue = send_queue[header.packet_id];
@@ -1088,38 +2551,130 @@ namespace extension {
                 // overtransmitted
                 queue.header      = header;
                 queue.header.type = DATA_RETRANSMISSION;
-                // TODO(trent): there might be some better memory management that can happen here
-                queue.payload = payload;
-                std::vector<uint8_t> acks((header.packet_count / 8) + 1, 0);
+                // Keep a reference to the payload so we can resend it without needing our own copy
+                queue.payload = data;
 
                 // Find interested parties or if multicast it's everyone we are connected to
                 auto range = target.empty() ? std::make_pair(name_target.begin(), name_target.end())
                                             : name_target.equal_range(target);
                 for (auto it = range.first; it != range.second; ++it) {
-                    // If this target is an announce target ignore it
-                    if (it->first != "") {
-                        // Add this guy to the queue
-                        queue.targets.emplace_back(it->second, acks);
-
-                        // The next time we should check for a timeout
-                        auto next_timeout = std::chrono::steady_clock::now() + it->second->round_trip_time;
-                        if (next_timeout < next_event) {
-                            next_event = next_timeout;
-                            next_event_callback(next_event);
+                    // If this target is an announce target or doesn't want this data ignore it
+                    if (it->first != "" && it->second->wants(hash)) {
+                        // Add this guy to the queue, split up to fit their path
+                        uint16_t fragment_size = data_mtu(it->second->mtu, it->second->target);
+                        queue.add(it->second, fragment_size, uint32_t((payload.size() / fragment_size) + 1));
+
+                        // An id can still be listed for a group that finished if we haven't looked at the list since
+                        auto& groups = it->second->queued_groups;
+                        if (std::find(groups.begin(), groups.end(), header.packet_id) == groups.end()) {
+                            groups.push_back(header.packet_id);
                         }
                     }
                 }
+
+                // Older latest only data of this type is no longer worth sending to the targets getting this
+                if (latest) {
+                    std::vector<uint16_t> cancelled;
+                    send_queue.for_each([&](uint16_t packet_id, PacketQueue& older) {
+                        if (packet_id == header.packet_id || older.header.latest == 0 || older.header.hash != hash) {
+                            return;
+                        }
+                        for (const auto& t : queue.targets) {
+                            auto ptr = t.target.lock();
+                            auto s   = ptr ? older.find(*ptr) : nullptr;
+                            if (s != nullptr) {
+
+                                // The fragments we sent of it are no longer in flight as we will ignore their acks
+                                size_t in_flight = 0;
+                                for (uint8_t b : s->sent) {
+                                    for (; b != 0; b &= b - 1) {
+                                        ++in_flight;
+                                    }
+                                }
+                                ptr->congestion.in_flight -= std::min(ptr->congestion.in_flight, in_flight);
+                                older.erase(s - older.targets.data());
+                            }
+                        }
+                        if (older.targets.empty()) {
+                            cancelled.push_back(packet_id);
+                        }
+                    });
+                    for (const auto& packet_id : cancelled) {
+                        send_queue.erase(packet_id);
+                    }
+                }
+
+                // Send what we can now, the rest will be sent as acks come back
+                transmit();
             }
+            // Unreliable packets are sent straight away
+            else {
+                std::shared_lock<std::shared_timed_mutex> lock(target_mutex);
+
+                // Work out who wants this data
+                std::vector<const NetworkTarget*> send_to;
+                bool everyone = true;
+                auto range    = target.empty() ? std::make_pair(name_target.begin(), name_target.end())
+                                            : name_target.equal_range(target);
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (it->first != "") {
+                        if (it->second->wants(hash)) {
+                            send_to.push_back(it->second.get());
+                        }
+                        else {
+                            everyone = false;
+                        }
+                    }
+                }
 
-            /* Mutex Scope */ {
-                std::lock_guard<std::mutex> lock(target_mutex);
+                // If everyone wants it we can send it to our announce targets once split to fit our network, otherwise
+                // just send it to the targets that want it split to fit their paths
+                std::vector<std::pair<const sock_t*, uint16_t>> addresses;
+                if (target.empty() && everyone) {
+                    auto all = name_target.equal_range("");
+                    for (auto it = all.first; it != all.second; ++it) {
+                        addresses.emplace_back(&it->second->target, packet_data_mtu);
+                    }
+                }
+                else {
+                    for (auto& t : send_to) {
+                        addresses.emplace_back(&t->target, data_mtu(t->mtu, t->target));
+                    }
+                }
+
+                // The packets and parity for each fragment size, so targets with the same path share them
+                struct Split {
+                    DataPacket header;
+                    std::vector<uint32_t> packet_nos;
+                    std::vector<std::vector<char>> parity;
+                };
+                std::map<uint16_t, Split> splits;
+
+                for (const auto& address : addresses) {
+                    auto split = splits.find(address.second);
+                    if (split == splits.end()) {
+                        split = splits.insert(std::make_pair(address.second, Split())).first;
+                        Split& s = split->second;
+
+                        s.header              = header;
+                        s.header.packet_count = uint32_t((payload.size() / address.second) + 1);
+                        s.packet_nos.resize(s.header.packet_count);
+                        for (uint32_t i = 0; i < s.header.packet_count; ++i) {
+                            s.packet_nos[i] = i;
+                        }
+
+                        // Parity lets the receiver rebuild lost fragments without asking us for them
+                        if (fec_block_size != 0 && s.header.packet_count > 1) {
+                            s.parity = make_parity(s.header, address.second, payload);
+                        }
+                    }
+                    const Split& s = split->second;
 
-                // Now send all our packets to our targets
-                auto send_to = name_target.equal_range(target);
-                for (size_t i = 0; i < header.packet_count; ++i) {
-                    for (auto s = send_to.first; s != send_to.second; ++s) {
-                        send_packet(s->second->target, header, i, payload, reliable);
+                    // Parity goes first so the receiver knows to expect it and can remember the group once it is done
+                    for (const auto& p : s.parity) {
+                        ::sendto(data_fd, p.data(), p.size(), 0, &address.first->sock, socket_size(*address.first));
                     }
+                    send_packets(*address.first, s.header, address.second, s.packet_nos, payload);
                 }
             }
         }
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nuclear_bits/extension/network/lz4.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace NUClear {
+namespace extension {
+    namespace network {
+        namespace lz4 {
+
+            namespace {
+                /// The shortest match the format can describe
+                constexpr size_t MIN_MATCH = 4;
+                /// The format requires the last bytes of a block to be literals
+                constexpr size_t LAST_LITERALS = 5;
+                /// The last match must start at least this far from the end of the block
+                constexpr size_t MATCH_LIMIT = 12;
+                /// The furthest back a match can refer to
+                constexpr size_t MAX_OFFSET = 65535;
+                /// How many bits of hash we use to find earlier matches
+                constexpr int HASH_LOG = 12;
+
+                inline uint32_t read32(const char* p) {
+                    uint32_t v;
+                    std::memcpy(&v, p, sizeof(v));
+                    return v;
+                }
+
+                inline uint32_t hash(uint32_t sequence) {
+                    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+                }
+
+                /// Write a length that did not fit in its nibble of the token
+                inline void write_length(std::vector<char>& out, size_t length) {
+                    for (; length >= 255; length -= 255) {
+                        out.push_back(char(255));
+                    }
+                    out.push_back(char(length));
+                }
+
+                /// Write a sequence of literals followed by a match, or just literals if match_length is 0
+                void write_sequence(std::vector<char>& out,
+                                    const char* literals,
+                                    size_t literal_length,
+                                    size_t offset,
+                                    size_t match_length) {
+
+                    size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+                    out.push_back(char(((literal_length < 15 ? literal_length : 15) << 4)
+                                       | (match_code < 15 ? match_code : 15)));
+
+                    if (literal_length >= 15) {
+                        write_length(out, literal_length - 15);
+                    }
+                    out.insert(out.end(), literals, literals + literal_length);
+
+                    if (match_length != 0) {
+                        out.push_back(char(offset & 0xFF));
+                        out.push_back(char(offset >> 8));
+                        if (match_code >= 15) {
+                            write_length(out, match_code - 15);
+                        }
+                    }
+                }
+            }  // namespace
+
+            std::vector<char> compress(const char* data, size_t length) {
+
+                std::vector<char> out;
+                out.reserve(length + length / 255 + 16);
+
+                size_t anchor = 0;
+
+                // Blocks that are too short to hold a match are all literals
+                if (length > MATCH_LIMIT) {
+
+                    // Where we last saw each hashed sequence of four bytes, offset by one so zero means never
+                    std::array<uint32_t, 1 << HASH_LOG> table{};
+
+                    const size_t match_end = length - LAST_LITERALS;
+                    for (size_t ip = 0; ip < length - MATCH_LIMIT;) {
+
+                        uint32_t sequence = read32(data + ip);
+                        uint32_t& entry   = table[hash(sequence)];
+                        size_t ref        = entry;
+                        entry             = uint32_t(ip + 1);
+
+                        if (ref == 0 || ip + 1 - ref > MAX_OFFSET || read32(data + ref - 1) != sequence) {
+                            // Skip ahead faster the longer we go without finding a match
+                            ip += 1 + ((ip - anchor) >> 6);
+                            continue;
+                        }
+                        --ref;
+
+                        // Extend the match as far as we can
+                        size_t match_length = MIN_MATCH;
+                        while (ip + match_length < match_end && data[ref + match_length] == data[ip + match_length]) {
+                            ++match_length;
+                        }
+
+                        write_sequence(out, data + anchor, ip - anchor, ip - ref, match_length);
+                        ip += match_length;
+                        anchor = ip;
+                    }
+                }
+
+                // Everything after our last match goes out as literals
+                write_sequence(out, data + anchor, length - anchor, 0, 0);
+                return out;
+            }
+
+            bool decompress(const char* data, size_t length, char* output, size_t output_length) {
+
+                const auto* in = reinterpret_cast<const uint8_t*>(data);
+                size_t ip      = 0;
+                size_t op      = 0;
+
+                while (ip < length) {
+                    uint8_t token = in[ip++];
+
+                    // Read how many literals there are
+                    size_t literal_length = token >> 4;
+                    if (literal_length == 15) {
+                        uint8_t b;
+                        do {
+                            if (ip >= length) {
+                                return false;
+                            }
+                            b = in[ip++];
+                            literal_length += b;
+                        } while (b == 255);
+                    }
+
+                    // Copy the literals
+                    if (literal_length > length - ip || literal_length > output_length - op) {
+                        return false;
+                    }
+                    if (literal_length > 0) {
+                        std::memcpy(output + op, data + ip, literal_length);
+                    }
+                    ip += literal_length;
+                    op += literal_length;
+
+                    // The last sequence has no match
+                    if (ip == length) {
+                        break;
+                    }
+
+                    // Read where the match is
+                    if (length - ip < 2) {
+                        return false;
+                    }
+                    size_t offset = size_t(in[ip]) | (size_t(in[ip + 1]) << 8);
+                    ip += 2;
+                    if (offset == 0 || offset > op) {
+                        return false;
+                    }
+
+                    // Read how long the match is
+                    size_t match_length = token & 0x0F;
+                    if (match_length == 15) {
+                        uint8_t b;
+                        do {
+                            if (ip >= length) {
+                                return false;
+                            }
+                            b = in[ip++];
+                            match_length += b;
+                        } while (b == 255);
+                    }
+                    match_length += MIN_MATCH;
+
+                    // Copy the match a byte at a time as it may overlap what it is writing
+                    if (match_length > output_length - op) {
+                        return false;
+                    }
+                    for (size_t i = 0; i < match_length; ++i, ++op) {
+                        output[op] = output[op - offset];
+                    }
+                }
+
+                return op == output_length;
+            }
+
+        }  // namespace lz4
+    }      // namespace network
+}  // namespace extension
+}  // namespace NUClear
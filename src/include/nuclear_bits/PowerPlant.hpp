@@ -251,6 +251,7 @@ void log(Arguments&&... args) {
 #include "nuclear_bits/message/CommandLineArguments.hpp"
 #include "nuclear_bits/message/NetworkConfiguration.hpp"
 #include "nuclear_bits/message/NetworkEvent.hpp"
+#include "nuclear_bits/message/TCPBackpressure.hpp"
 
 // Include all of our implementation files (which use the previously included reactor.h)
 #include "nuclear_bits/PowerPlant.ipp"
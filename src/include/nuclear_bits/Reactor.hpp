@@ -54,6 +54,8 @@ namespace dsl {
 
         struct TCP;
 
+        struct UnixSocket;
+
         template <typename...>
         struct Optional;
 
@@ -67,6 +69,12 @@ namespace dsl {
 
         struct NetworkSource;
 
+        template <typename>
+        struct NetworkView;
+
+        template <typename>
+        struct SharedMemory;
+
         template <typename...>
         struct Trigger;
 
@@ -107,6 +115,12 @@ namespace dsl {
             struct Network;
             template <typename T>
             struct UDP;
+            template <typename T>
+            struct TCP;
+            template <typename T>
+            struct UnixSocket;
+            template <typename T>
+            struct SharedMemory;
         }  // namespace emit
     }      // namespace word
 }  // namespace dsl
@@ -175,6 +189,9 @@ protected:
     /// @copydoc dsl::word::TCP
     using TCP = dsl::word::TCP;
 
+    /// @copydoc dsl::word::UnixSocket
+    using UnixSocket = dsl::word::UnixSocket;
+
     /// @copydoc dsl::word::With
     template <typename... Ts>
     using With = dsl::word::With<Ts...>;
@@ -200,6 +217,14 @@ protected:
     /// @copydoc dsl::word::Network
     using NetworkSource = dsl::word::NetworkSource;
 
+    /// @copydoc dsl::word::NetworkView
+    template <typename T>
+    using NetworkView = dsl::word::NetworkView<T>;
+
+    /// @copydoc dsl::word::SharedMemory
+    template <typename T>
+    using SharedMemory = dsl::word::SharedMemory<T>;
+
     /// @copydoc dsl::word::Shutdown
     using Shutdown = dsl::word::Shutdown;
 
@@ -250,6 +275,18 @@ protected:
         /// @copydoc dsl::word::emit::Network
         template <typename T>
         using UDP = dsl::word::emit::UDP<T>;
+
+        /// @copydoc dsl::word::emit::TCP
+        template <typename T>
+        using TCP = dsl::word::emit::TCP<T>;
+
+        /// @copydoc dsl::word::emit::UnixSocket
+        template <typename T>
+        using UNIX = dsl::word::emit::UnixSocket<T>;
+
+        /// @copydoc dsl::word::emit::SharedMemory
+        template <typename T>
+        using SHM = dsl::word::emit::SharedMemory<T>;
     };
 
     /// @brief This provides functions to modify how an on statement runs after it has been created
@@ -386,6 +423,7 @@ public:
 #include "nuclear_bits/dsl/word/Network.hpp"
 #include "nuclear_bits/dsl/word/Optional.hpp"
 #include "nuclear_bits/dsl/word/Priority.hpp"
+#include "nuclear_bits/dsl/word/SharedMemory.hpp"
 #include "nuclear_bits/dsl/word/Shutdown.hpp"
 #include "nuclear_bits/dsl/word/Single.hpp"
 #include "nuclear_bits/dsl/word/Startup.hpp"
@@ -393,6 +431,7 @@ public:
 #include "nuclear_bits/dsl/word/TCP.hpp"
 #include "nuclear_bits/dsl/word/Trigger.hpp"
 #include "nuclear_bits/dsl/word/UDP.hpp"
+#include "nuclear_bits/dsl/word/UnixSocket.hpp"
 #include "nuclear_bits/dsl/word/Watchdog.hpp"
 #include "nuclear_bits/dsl/word/With.hpp"
 #include "nuclear_bits/dsl/word/emit/Delay.hpp"
@@ -400,6 +439,9 @@ public:
 #include "nuclear_bits/dsl/word/emit/Initialise.hpp"
 #include "nuclear_bits/dsl/word/emit/Local.hpp"
 #include "nuclear_bits/dsl/word/emit/Network.hpp"
+#include "nuclear_bits/dsl/word/emit/SharedMemory.hpp"
+#include "nuclear_bits/dsl/word/emit/TCP.hpp"
 #include "nuclear_bits/dsl/word/emit/UDP.hpp"
+#include "nuclear_bits/dsl/word/emit/UnixSocket.hpp"
 
 #endif  // NUCLEAR_REACTOR_HPP
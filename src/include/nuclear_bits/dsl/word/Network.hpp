@@ -19,6 +19,10 @@
 #ifndef NUCLEAR_DSL_WORD_NETWORK_HPP
 #define NUCLEAR_DSL_WORD_NETWORK_HPP
 
+#include <cstddef>
+#include <typeindex>
+
+#include "nuclear_bits/clock.hpp"
 #include "nuclear_bits/dsl/store/ThreadStore.hpp"
 #include "nuclear_bits/dsl/trait/is_transient.hpp"
 #include "nuclear_bits/util/network/sock_t.hpp"
@@ -36,12 +40,108 @@ namespace dsl {
             NetworkData(std::shared_ptr<T>&& ptr) : std::shared_ptr<T>(ptr) {}
         };
 
+        /**
+         * @brief The type a NetworkView<T> exposes, plain old data is viewed as itself and random access containers of
+         *        plain old data as an array of their elements
+         */
+        template <typename T, typename Check = T>
+        struct NetworkViewElement {};
+
+        template <typename T>
+        struct NetworkViewElement<T, std::enable_if_t<std::is_trivial<T>::value, T>> {
+            using type = T;
+        };
+
+        template <typename T>
+        struct NetworkViewElement<
+            T,
+            std::enable_if_t<!std::is_trivial<T>::value
+                                 && std::is_trivial<typename util::serialise::Serialise<T>::StoredType>::value,
+                             T>> {
+            using type = std::remove_const_t<typename util::serialise::Serialise<T>::StoredType>;
+        };
+
+        /**
+         * @brief Data of type T that was received over the network or through shared memory, used where it is in the
+         *        buffer it was received in
+         *
+         * @details
+         *  The view shares ownership of the buffer, which is released once every view of it is gone. Received buffers
+         *  are allocated (or mapped) for each message so they are aligned for any fundamental type.
+         *
+         * @tparam T the type that was emitted, which must be plain old data or a random access container of it
+         */
+        template <typename T>
+        struct NetworkView {
+            using element_type = typename NetworkViewElement<T>::type;
+
+            static_assert(alignof(element_type) <= alignof(std::max_align_t),
+                          "Received buffers are only aligned for fundamental types");
+
+            NetworkView() : buffer(), first(nullptr), count(0) {}
+            NetworkView(const std::shared_ptr<const std::vector<char>>& buffer)
+                : NetworkView(buffer, buffer->data(), buffer->size()) {}
+            NetworkView(std::shared_ptr<const void> buffer, const char* data, size_t size)
+                : buffer(std::move(buffer))
+                , first(reinterpret_cast<const element_type*>(data))
+                , count(size / sizeof(element_type)) {}
+
+            /// The elements that were received, or for plain old data the object itself
+            const element_type* data() const {
+                return first;
+            }
+            size_t size() const {
+                return count;
+            }
+            const element_type* begin() const {
+                return first;
+            }
+            const element_type* end() const {
+                return first + count;
+            }
+            const element_type& operator[](size_t i) const {
+                return first[i];
+            }
+            const element_type& operator*() const {
+                return *first;
+            }
+            const element_type* operator->() const {
+                return first;
+            }
+
+            /// If this view has data
+            explicit operator bool() const {
+                return buffer != nullptr;
+            }
+
+        private:
+            std::shared_ptr<const void> buffer;
+            const element_type* first;
+            size_t count;
+        };
+
         struct NetworkSource {
-            NetworkSource() : name(""), address() {}
+            NetworkSource() : name(""), address(), reliable(false), received(), round_trip(0) {}
 
             std::string name;
             util::network::sock_t address;
             bool reliable;
+            /// When the last packet of this message arrived, timestamped by the kernel where it is able to
+            NUClear::clock::time_point received;
+            /// Our current estimate of the round trip time to the source, half of this approximates the latency
+            NUClear::clock::duration round_trip;
+        };
+
+        /// A message received from the network that is being given to the reactions that want it
+        struct NetworkMessage {
+            NetworkMessage() : source(), payload(), deserialised() {}
+
+            /// Who sent the message, shared by every reaction
+            std::shared_ptr<NetworkSource> source;
+            /// The serialised data of the message
+            std::shared_ptr<const std::vector<char>> payload;
+            /// The message deserialised as each type a reaction has asked for, so no type is deserialised twice
+            std::vector<std::pair<std::type_index, std::shared_ptr<void>>> deserialised;
         };
 
         struct NetworkListen {
@@ -61,7 +161,7 @@ namespace dsl {
          *  running NUClear.  Note that the serialization and deserialization is handled by NUClear.
          *
          *  When the reaction is triggered, read-only access to T will be provided to the triggering unit via a
-         *  callback.
+         *  callback.  Each message is only deserialised once, and every reaction to it shares the same T.
          *
          * @attention
          *  When using an on<Network<T>> request, the associated reaction will only be triggered when T is emitted to
@@ -95,14 +195,21 @@ namespace dsl {
             template <typename DSL>
             static inline std::tuple<std::shared_ptr<NetworkSource>, NetworkData<T>> get(threading::Reaction&) {
 
-                auto data   = store::ThreadStore<std::vector<char>>::value;
-                auto source = store::ThreadStore<NetworkSource>::value;
+                auto message = store::ThreadStore<NetworkMessage>::value;
 
-                if (data && source) {
+                if (message) {
+
+                    // The first reaction to want T deserialises it and the rest share that object
+                    for (const auto& d : message->deserialised) {
+                        if (d.first == std::type_index(typeid(T))) {
+                            return std::make_tuple(message->source, std::static_pointer_cast<T>(d.second));
+                        }
+                    }
+                    auto data = std::make_shared<T>(util::serialise::Serialise<T>::deserialise(*message->payload));
+                    message->deserialised.emplace_back(std::type_index(typeid(T)), data);
 
                     // Return our deserialised data
-                    return std::make_tuple(std::make_shared<NetworkSource>(*source),
-                                           std::make_shared<T>(util::serialise::Serialise<T>::deserialise(*data)));
+                    return std::make_tuple(message->source, NetworkData<T>(data));
                 }
                 else {
 
@@ -112,6 +219,44 @@ namespace dsl {
             }
         };
 
+        /**
+         * @brief
+         *  Receives T from the network without copying it out of the buffer it was received in.
+         *
+         * @details
+         *  @code on<Network<NetworkView<T>>>() @endcode
+         *  This is triggered by the same messages as on<Network<T>>, but instead of deserialising T the reaction is
+         *  given a NetworkView<T> that points into the received data. Plain old data can also be taken as a const
+         *  reference to T, which is then a reference into the received data.
+         *
+         * @par Implements
+         *  Bind, Get
+         *
+         * @tparam T
+         *  the datatype that was emitted, which must be plain old data or a random access container of it.
+         */
+        template <typename T>
+        struct Network<NetworkView<T>> : public Network<T> {
+
+            template <typename DSL>
+            static inline std::tuple<std::shared_ptr<NetworkSource>, NetworkView<T>> get(threading::Reaction&) {
+
+                auto message = store::ThreadStore<NetworkMessage>::value;
+
+                // Plain old data must be exactly the size of T
+                if (message
+                    && (!std::is_trivial<T>::value
+                        || message->payload->size() == sizeof(typename NetworkView<T>::element_type))) {
+                    return std::make_tuple(message->source, NetworkView<T>(message->payload));
+                }
+                else {
+
+                    // Return invalid data
+                    return std::make_tuple(std::shared_ptr<NetworkSource>(nullptr), NetworkView<T>());
+                }
+            }
+        };
+
     }  // namespace word
 
     namespace trait {
@@ -119,6 +264,9 @@ namespace dsl {
         template <typename T>
         struct is_transient<typename word::NetworkData<T>> : public std::true_type {};
 
+        template <typename T>
+        struct is_transient<typename word::NetworkView<T>> : public std::true_type {};
+
         template <>
         struct is_transient<typename std::shared_ptr<word::NetworkSource>> : public std::true_type {};
 
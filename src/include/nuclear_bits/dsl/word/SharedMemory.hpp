@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_DSL_WORD_SHAREDMEMORY_HPP
+#define NUCLEAR_DSL_WORD_SHAREDMEMORY_HPP
+
+#include "nuclear_bits/util/platform.hpp"
+
+// Shared memory transport is built on unix domain sockets which are not available on windows
+#ifndef _WIN32
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "nuclear_bits/PowerPlant.hpp"
+#include "nuclear_bits/dsl/trait/is_transient.hpp"
+#include "nuclear_bits/dsl/word/IO.hpp"
+#include "nuclear_bits/dsl/word/Network.hpp"
+#include "nuclear_bits/dsl/word/UnixSocket.hpp"
+#include "nuclear_bits/util/serialise/Serialise.hpp"
+
+namespace NUClear {
+namespace dsl {
+    namespace word {
+
+        template <typename T>
+        struct SharedMemoryData : public std::shared_ptr<const T> {
+            SharedMemoryData() : std::shared_ptr<const T>() {}
+            SharedMemoryData(const std::shared_ptr<const T>& ptr) : std::shared_ptr<const T>(ptr) {}
+            SharedMemoryData(std::shared_ptr<const T>&& ptr) : std::shared_ptr<const T>(std::move(ptr)) {}
+        };
+
+        /// If T is plain old data or a random access container of it, and so can be used straight from shared memory
+        template <typename T, typename Check = void>
+        struct is_shared_memory_viewable : public std::false_type {};
+
+        template <typename T>
+        struct is_shared_memory_viewable<T, decltype(void(std::declval<typename NetworkViewElement<T>::type>()))>
+            : public std::true_type {};
+
+        /**
+         * @brief
+         *  Receives messages emitted by other processes on the same host through shared memory.
+         *
+         * @details
+         *  @code on<SharedMemory<T>>(channel) @endcode
+         *  This reaction will be triggered whenever a process on this host emits T using emit<Scope::SHM> on the same
+         *  channel.  Each message is written once into an anonymous shared memory region, and only a handle to that
+         *  region is passed to each of the receiving processes, which map it rather than reading the data out of a
+         *  socket.
+         *
+         *  @code on<SharedMemory<T>>() @endcode
+         *  Should the channel be omitted, then the default channel for T is used.
+         *
+         *  When T is a plain old data type the data given to the reaction points directly into the shared memory that
+         *  was written by the sender, and the memory is unmapped once all references to it are released.  Random
+         *  access containers of plain old data are built with a single copy out of the shared memory, and other types
+         *  are deserialised from it as they would be for on<Network<T>>.
+         *
+         *  @code on<SharedMemory<NetworkView<T>>>(channel) @endcode
+         *  For large messages such as images held in a container, a NetworkView<T> gives the reaction the data where
+         *  it is in the shared memory without copying it at all.
+         *
+         * @attention
+         *  Each receiving reaction registers itself as a socket in a per user directory in the temporary directory
+         *  (TMPDIR, or /tmp).  Senders find their receivers by listing this directory.  The directory must belong to
+         *  this user and be accessible only by them, otherwise binding or emitting throws.
+         *
+         * @par Implements
+         *  Bind, Get
+         *
+         * @tparam T
+         *  the datatype on which the reaction callback will be triggered.
+         */
+        template <typename T>
+        struct SharedMemory {
+
+            /**
+             * @brief Get the directory that the receivers of T on a channel register their sockets in
+             *
+             * @param channel   the channel to get the directory for
+             * @param create    if the directory should be created if it does not exist
+             */
+            static inline std::string directory(const std::string& channel, bool create = false) {
+
+                const char* tmp = std::getenv("TMPDIR");
+                std::stringstream path;
+                path << (tmp != nullptr && tmp[0] != '\0' ? tmp : "/tmp") << "/nuclear-shm-" << ::getuid();
+                std::string base = path.str();
+
+                path << "/" << std::hex << std::setw(16) << std::setfill('0') << util::serialise::Serialise<T>::hash();
+                if (!channel.empty()) {
+                    path << "-" << channel;
+                }
+
+                // Only this user should be able to send to our receivers
+                if (create) {
+                    for (const auto& dir : {base, path.str()}) {
+                        if (::mkdir(dir.c_str(), 0700) == 0) {
+                            // Our umask may have taken away some of the permissions we need
+                            ::chmod(dir.c_str(), 0700);
+                        }
+                        else if (errno != EEXIST) {
+                            throw std::system_error(errno,
+                                                    std::system_category(),
+                                                    "We were unable to create the shared memory directory " + dir);
+                        }
+                        check(dir);
+                    }
+                }
+
+                return path.str();
+            }
+
+            /**
+             * @brief Make sure a shared memory directory belongs to us and nobody else can use it
+             *
+             * @details Anyone who could create the directory before us would be able to see and replace the sockets
+             *          that messages are sent to, so it must be a real directory owned by this user with mode 0700.
+             *
+             * @param dir the directory to check
+             *
+             * @return false if the directory does not exist
+             */
+            static inline bool check(const std::string& dir) {
+
+                struct stat info;
+                if (::lstat(dir.c_str(), &info) < 0) {
+                    if (errno == ENOENT) {
+                        return false;
+                    }
+                    throw std::system_error(
+                        errno, std::system_category(), "We were unable to check the shared memory directory " + dir);
+                }
+
+                if (!S_ISDIR(info.st_mode) || info.st_uid != ::getuid() || (info.st_mode & 0777) != 0700) {
+                    throw std::system_error(EPERM,
+                                            std::system_category(),
+                                            "The shared memory directory " + dir
+                                                + " must be a directory that only this user can access");
+                }
+
+                return true;
+            }
+
+            /**
+             * @brief Map a shared memory region that was sent to us
+             *
+             * @param fd    the file descriptor of the shared memory region
+             * @param size  set to the size of the region
+             *
+             * @return the mapped memory, which is unmapped once it is released, or nullptr if it could not be mapped
+             */
+            static inline std::shared_ptr<const char> map(fd_t fd, size_t& size) {
+
+                struct stat info;
+                if (::fstat(fd, &info) < 0) {
+                    return nullptr;
+                }
+                size = size_t(info.st_size);
+
+                // An empty message has nothing to map but is still a message
+                if (size == 0) {
+                    return std::make_shared<const char>('\0');
+                }
+
+                void* address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                if (address == MAP_FAILED) {
+                    return nullptr;
+                }
+
+                // Unmap our memory once nothing is using it anymore
+                return std::shared_ptr<const char>(reinterpret_cast<const char*>(address), [size](const char* ptr) {
+                    ::munmap(const_cast<char*>(ptr), size);
+                });
+            }
+
+            /**
+             * @brief Receive the shared memory region that was sent to a reaction and map it
+             *
+             * @param fd    the socket the reaction receives on
+             * @param size  set to the size of the region
+             *
+             * @return the mapped memory, or nullptr if there was no message
+             */
+            static inline std::shared_ptr<const char> receive(fd_t fd, size_t& size) {
+
+                // Each message is the handle to the shared memory the data was written to
+                UnixSocket::Packet packet = UnixSocket::receive(fd);
+                if (!packet || packet.fds.empty()) {
+                    return nullptr;
+                }
+
+                return map(packet.fds.front()->fd, size);
+            }
+
+            template <typename DSL>
+            static inline std::tuple<std::string, fd_t> bind(const std::shared_ptr<threading::Reaction>& reaction,
+                                                             const std::string& channel = "") {
+
+                // Register ourselves as a receiver in our channel's directory
+                std::stringstream path;
+                path << directory(channel, true) << "/" << ::getpid() << "-" << reaction->id;
+
+                fd_t fd = UnixSocket::open(path.str(), SOCK_DGRAM);
+                UnixSocket::configure(reaction, fd, path.str());
+
+                // Return our handles and the path we are receiving on
+                return std::make_tuple(path.str(), fd);
+            }
+
+            template <typename DSL>
+            static inline SharedMemoryData<T> get(threading::Reaction& r) {
+
+                // Get our file descriptor from the magic cache
+                auto event = IO::get<DSL>(r);
+
+                // If our get is being run without an fd (something else triggered) then short circuit
+                if (event.fd == 0) {
+                    return SharedMemoryData<T>();
+                }
+
+                size_t size                        = 0;
+                std::shared_ptr<const char> memory = receive(event.fd, size);
+                if (!memory) {
+                    return SharedMemoryData<T>();
+                }
+
+                return SharedMemoryData<T>(read(memory, size, std::is_trivial<T>(), is_shared_memory_viewable<T>()));
+            }
+
+        private:
+            // Plain old data can be used directly from the shared memory
+            template <typename Viewable>
+            static inline std::shared_ptr<const T> read(const std::shared_ptr<const char>& memory,
+                                                        size_t size,
+                                                        std::true_type,
+                                                        Viewable) {
+                return size == sizeof(T) ? std::shared_ptr<const T>(memory, reinterpret_cast<const T*>(memory.get()))
+                                         : nullptr;
+            }
+
+            // Containers of plain old data are copied straight out of the shared memory
+            static inline std::shared_ptr<const T> read(const std::shared_ptr<const char>& memory,
+                                                        size_t size,
+                                                        std::false_type,
+                                                        std::true_type) {
+                NetworkView<T> view(memory, memory.get(), size);
+                auto out = std::make_shared<T>();
+                out->insert(out->end(), view.begin(), view.end());
+                return out;
+            }
+
+            // Anything else needs to be deserialised
+            static inline std::shared_ptr<const T> read(const std::shared_ptr<const char>& memory,
+                                                        size_t size,
+                                                        std::false_type,
+                                                        std::false_type) {
+                return std::make_shared<const T>(util::serialise::Serialise<T>::deserialise(
+                    std::vector<char>(memory.get(), memory.get() + size)));
+            }
+        };
+
+        /**
+         * @brief
+         *  Receives T from shared memory without copying it out of the memory it was written to.
+         *
+         * @details
+         *  @code on<SharedMemory<NetworkView<T>>>(channel) @endcode
+         *  This is triggered by the same messages as on<SharedMemory<T>>, but the reaction is given a NetworkView<T>
+         *  that points into the shared memory.  The memory stays mapped until every view of it has been released.
+         *
+         * @par Implements
+         *  Bind, Get
+         *
+         * @tparam T
+         *  the datatype that was emitted, which must be plain old data or a random access container of it.
+         */
+        template <typename T>
+        struct SharedMemory<NetworkView<T>> : public SharedMemory<T> {
+
+            template <typename DSL>
+            static inline NetworkView<T> get(threading::Reaction& r) {
+
+                // Get our file descriptor from the magic cache
+                auto event = IO::get<DSL>(r);
+
+                // If our get is being run without an fd (something else triggered) then short circuit
+                if (event.fd == 0) {
+                    return NetworkView<T>();
+                }
+
+                size_t size                        = 0;
+                std::shared_ptr<const char> memory = SharedMemory<T>::receive(event.fd, size);
+
+                // Plain old data must be exactly the size of T
+                if (!memory || (std::is_trivial<T>::value && size != sizeof(T))) {
+                    return NetworkView<T>();
+                }
+
+                return NetworkView<T>(memory, memory.get(), size);
+            }
+        };
+
+    }  // namespace word
+
+    namespace trait {
+
+        template <typename T>
+        struct is_transient<typename word::SharedMemoryData<T>> : public std::true_type {};
+
+    }  // namespace trait
+}  // namespace dsl
+}  // namespace NUClear
+
+#endif  // _WIN32
+
+#endif  // NUCLEAR_DSL_WORD_SHAREDMEMORY_HPP
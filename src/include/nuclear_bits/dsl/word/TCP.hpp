@@ -21,9 +21,17 @@
 
 #include "nuclear_bits/util/platform.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <functional>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
 
 #include "nuclear_bits/PowerPlant.hpp"
+#include "nuclear_bits/dsl/store/ThreadStore.hpp"
 #include "nuclear_bits/dsl/word/IO.hpp"
 #include "nuclear_bits/util/FileDescriptor.hpp"
 
@@ -48,6 +56,10 @@ namespace dsl {
          *  @code on<TCP, TCP>(port, port)  @endcode
          *  A reaction can also be triggered via connectivity on more than one port.
          *
+         *  @code on<TCP>(port, listeners) @endcode
+         *  To spread a large number of incoming connections over several accept queues, more than one listening
+         *  socket can be opened on the port.  See TCP::Batch for details.
+         *
          * @attention
          *  Because TCP communications are stream based, the on< TCP >() request will often require an on< IO >()
          *  request also be specified within its definition. It is the later request which will define the reaction to
@@ -56,6 +68,10 @@ namespace dsl {
          *    on<IO>(connection.fd, IO::READ | IO::CLOSE).then([this](IO::Event event)
          *  } @endcode
          *
+         *  @code on<TCP::Stream<Framer>>(port) @endcode
+         *  Alternatively NUClear can manage the connections itself and trigger the reaction once for each frame that
+         *  is received on any of them.  See TCP::Stream for details.
+         *
          * @par Implements
          *  Bind
          */
@@ -80,9 +96,181 @@ namespace dsl {
                 }
             };
 
-            template <typename DSL>
-            static inline std::tuple<int, int> bind(const std::shared_ptr<threading::Reaction>& reaction,
-                                                    int port = 0) {
+            /**
+             * @brief Describes where a single frame sits at the start of a block of stream data
+             */
+            struct Extent {
+                /// The offset from the start of the data to the first byte of the frame's payload
+                size_t offset;
+                /// The number of bytes in the frame's payload. For an incomplete frame this is its expected length if
+                /// that is already known, or 0 if it is not
+                size_t length;
+                /// The number of bytes the whole frame occupies in the stream, or 0 if the frame is incomplete
+                size_t consumed;
+            };
+
+            /**
+             * @brief A single frame that has been read from a TCP stream
+             */
+            struct Frame {
+                Frame() : connection{{0, 0}, {0, 0}, 0}, payload(), length(0) {}
+
+                /// The connection this frame was read from
+                Connection connection;
+                /// The bytes of this frame, this points into (and shares ownership of) the buffer it was read into
+                std::shared_ptr<const char> payload;
+                /// The number of bytes in this frame
+                size_t length;
+
+                operator bool() const {
+                    return payload != nullptr;
+                }
+            };
+
+            /**
+             * @brief A framer for streams where each frame is preceded by its length in network byte order
+             *
+             * @tparam LengthType the unsigned integer type that holds the length prefix
+             */
+            template <typename LengthType = uint32_t>
+            struct LengthPrefixed {
+                static inline Extent frame(const char* data, size_t length) {
+
+                    // We don't have the whole length prefix yet
+                    if (length < sizeof(LengthType)) {
+                        return Extent{0, 0, 0};
+                    }
+
+                    // Read our length prefix from its big endian representation
+                    uint64_t size = 0;
+                    for (size_t i = 0; i < sizeof(LengthType); ++i) {
+                        size = (size << 8) | uint8_t(data[i]);
+                    }
+
+                    // Only consume the frame if all of it has arrived, but always report how long it will be
+                    return Extent{sizeof(LengthType),
+                                  size_t(size),
+                                  length - sizeof(LengthType) < size ? 0 : sizeof(LengthType) + size_t(size)};
+                }
+            };
+
+            /**
+             * @brief A framer for streams where each frame is terminated by a delimiter character
+             *
+             * @details The delimiter itself is not included in the frame's payload.
+             *
+             * @tparam delimiter the character that terminates each frame
+             */
+            template <char delimiter = '\n'>
+            struct Delimited {
+                static inline Extent frame(const char* data, size_t length) {
+
+                    // Look for the end of our frame
+                    const char* end = static_cast<const char*>(std::memchr(data, delimiter, length));
+
+                    return end == nullptr ? Extent{0, 0, 0}
+                                          : Extent{0, size_t(end - data), size_t(end - data) + 1};
+                }
+            };
+
+            /**
+             * @brief The information the TCP controller needs to manage the connections of a TCP::Stream
+             */
+            struct StreamListen {
+                StreamListen() : fd(INVALID_SOCKET), framer(), max_frame(0), reaction() {}
+
+                /// The listening socket that new connections arrive on
+                fd_t fd;
+                /// The function that finds the next frame in a block of stream data
+                std::function<Extent(const char*, size_t)> framer;
+                /// The largest frame payload we will accept, a connection that sends a larger one is closed
+                size_t max_frame;
+                /// The reaction to trigger for each frame
+                std::shared_ptr<threading::Reaction> reaction;
+            };
+
+            /**
+             * @brief
+             *  This allows a reaction to be triggered once for each frame that is received on a TCP connection.
+             *
+             * @details
+             *  @code on<TCP::Stream<TCP::LengthPrefixed<uint32_t>>>(port) @endcode
+             *  Connections that are made to the port are accepted and managed by NUClear. Data is read from each
+             *  connection in large blocks into a per connection buffer, and the reaction is triggered once for every
+             *  complete frame the framer finds in that buffer. The provided TCP::Frame points directly into the
+             *  buffer the data was read into, so frames are not copied after they are read from the socket.
+             *
+             *  @code on<TCP::Stream<TCP::Delimited<'\n'>>>() @endcode
+             *  As with on<TCP>, should the port be omitted the system will bind to a currently unassigned port.
+             *
+             *  @code on<TCP::Stream<TCP::LengthPrefixed<uint32_t>>>(port, max_frame) @endcode
+             *  As the remote decides how large each frame is, frames are limited to max_frame bytes (16 MiB unless
+             *  given). A connection that sends a larger frame is closed. Where the framer can tell how long an
+             *  incomplete frame will be it is rejected as soon as its length is known, otherwise once more than
+             *  max_frame bytes of it have been buffered.
+             *
+             *  A framer is any type with a static function
+             *  @code static TCP::Extent frame(const char* data, size_t length) @endcode
+             *  that describes the first frame in the data, or returns an extent that consumes nothing if the frame is
+             *  not yet complete. An incomplete frame may still report its length so oversized frames fail early.
+             *
+             * @par Implements
+             *  Bind, Get
+             *
+             * @tparam Framer the framer that is used to split the stream into frames
+             */
+            template <typename Framer>
+            struct Stream {
+
+                template <typename DSL>
+                static inline std::tuple<int, fd_t> bind(const std::shared_ptr<threading::Reaction>& reaction,
+                                                         int port         = 0,
+                                                         size_t max_frame = 16 * 1024 * 1024) {
+
+                    auto task = std::make_unique<StreamListen>();
+
+                    // Open our listening socket
+                    task->fd        = TCP::listen(port);
+                    task->framer    = &Framer::frame;
+                    task->max_frame = max_frame;
+                    task->reaction  = reaction;
+
+                    // The TCP controller will clean up the connections and listening socket when we unbind
+                    fd_t fd = task->fd;
+                    reaction->unbinders.push_back([](const threading::Reaction& r) {
+                        r.reactor.emit<emit::Direct>(std::make_unique<operation::Unbind<StreamListen>>(r.id));
+                    });
+
+                    // Send our configuration out
+                    reaction->reactor.emit<emit::Direct>(task);
+
+                    // Return our handles
+                    return std::make_tuple(port, fd);
+                }
+
+                template <typename DSL>
+                static inline Frame get(threading::Reaction&) {
+
+                    // Get our frame from the thread store if we were triggered by the TCP controller
+                    auto frame = store::ThreadStore<Frame>::value;
+                    return frame ? *frame : Frame();
+                }
+            };
+
+            /**
+             * @brief Open a TCP socket that is listening for connections on the given port
+             *
+             * @details The socket is non blocking so that waiting connections can be drained from it without risking
+             *          blocking the thread that is accepting them.
+             *
+             * @param port          the port to listen on, or 0 to let the system choose one. Updated with the bound
+             *                      port.
+             * @param reuse_port    if the socket should share its port with other listeners (SO_REUSEPORT) so the
+             *                      kernel can distribute incoming connections between them
+             *
+             * @return the file descriptor of the listening socket
+             */
+            static inline fd_t listen(int& port, bool reuse_port = false) {
 
                 // Make our socket
                 util::FileDescriptor fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
@@ -92,6 +280,18 @@ namespace dsl {
                         network_errno, std::system_category(), "We were unable to open the TCP socket");
                 }
 
+// If SO_REUSEPORT is available let multiple listeners share the port
+#ifdef SO_REUSEPORT
+                int yes = 1;
+                if (reuse_port
+                    && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<char*>(&yes), sizeof(yes)) < 0) {
+                    throw std::system_error(
+                        network_errno, std::system_category(), "We were unable to set reuse port on the TCP socket");
+                }
+#else
+                (void) reuse_port;
+#endif
+
                 // The address we will be binding to
                 sockaddr_in address;
                 memset(&address, 0, sizeof(sockaddr_in));
@@ -119,20 +319,105 @@ namespace dsl {
                 }
                 port = ntohs(address.sin_port);
 
+                // Make the socket non blocking
+#ifdef _WIN32
+                u_long mode = 1;
+                ioctlsocket(fd, FIONBIO, &mode);
+#else
+                ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+                return fd.release();
+            }
+
+            /**
+             * @brief Accept a single waiting connection from a listening socket
+             *
+             * @details The new socket is close on exec, and if requested, non blocking. Where accept4 is available
+             *          these flags are applied as part of the accept rather than with additional system calls.
+             *
+             * @param fd            the listening socket to accept from
+             * @param nonblocking   if the accepted socket should be non blocking
+             *
+             * @return the accepted connection, or an invalid connection if there were none waiting
+             */
+            static inline Connection accept(fd_t fd, bool nonblocking = false) {
+
+                sockaddr_in local;
+                sockaddr_in remote;
+                socklen_t size = sizeof(sockaddr_in);
+
+                // Accept the remote connection
+#if defined(__linux__)
+                util::FileDescriptor cfd = ::accept4(
+                    fd, reinterpret_cast<sockaddr*>(&remote), &size, SOCK_CLOEXEC | (nonblocking ? SOCK_NONBLOCK : 0));
+#else
+                util::FileDescriptor cfd = ::accept(fd, reinterpret_cast<sockaddr*>(&remote), &size);
+#ifdef _WIN32
+                if (cfd != INVALID_SOCKET && nonblocking) {
+                    u_long mode = 1;
+                    ioctlsocket(cfd, FIONBIO, &mode);
+                }
+#else
+                if (cfd != INVALID_SOCKET) {
+                    ::fcntl(cfd, F_SETFD, FD_CLOEXEC);
+                    if (nonblocking) {
+                        ::fcntl(cfd, F_SETFL, ::fcntl(cfd, F_GETFL, 0) | O_NONBLOCK);
+                    }
+                }
+#endif
+#endif
+
+                if (cfd == INVALID_SOCKET) {
+                    return Connection{{0, 0}, {0, 0}, 0};
+                }
+
+                // Get our local address, as we listen on every interface this can differ between connections
+                size = sizeof(sockaddr_in);
+                ::getsockname(cfd, reinterpret_cast<sockaddr*>(&local), &size);
+
+                return Connection{{ntohl(remote.sin_addr.s_addr), ntohs(remote.sin_port)},
+                                  {ntohl(local.sin_addr.s_addr), ntohs(local.sin_port)},
+                                  cfd.release()};
+            }
+
+            template <typename DSL>
+            static inline std::tuple<int, int> bind(const std::shared_ptr<threading::Reaction>& reaction,
+                                                    int port      = 0,
+                                                    int listeners = 1) {
+
+                // Open our listening sockets, if there is more than one they all share the first one's port
+                std::vector<fd_t> fds;
+                try {
+                    for (int i = 0; i < std::max(listeners, 1); ++i) {
+                        fds.push_back(listen(port, listeners > 1));
+                    }
+                }
+                catch (...) {
+                    for (auto& fd : fds) {
+                        close(fd);
+                    }
+                    throw;
+                }
+
                 // Generate a reaction for the IO system that closes on death
-                int cfd = fd;
                 reaction->unbinders.push_back([](const threading::Reaction& r) {
                     r.reactor.emit<emit::Direct>(std::make_unique<operation::Unbind<IO>>(r.id));
                 });
-                reaction->unbinders.push_back([cfd](const threading::Reaction&) { close(cfd); });
-
-                auto io_config = std::make_unique<IOConfiguration>(IOConfiguration{fd.release(), IO::READ, reaction});
+                reaction->unbinders.push_back([fds](const threading::Reaction&) {
+                    for (auto& fd : fds) {
+                        close(fd);
+                    }
+                });
 
-                // Send our configuration out
-                reaction->reactor.emit<emit::Direct>(io_config);
+                // Send our configuration out for each listener (same reaction)
+                for (auto& fd : fds) {
+                    auto io_config = std::make_unique<IOConfiguration>(IOConfiguration{fd, IO::READ, reaction});
+                    reaction->reactor.emit<emit::Direct>(io_config);
+                }
 
                 // Return our handles
-                return std::make_tuple(port, cfd);
+                return std::make_tuple(port, fds.front());
             }
 
             template <typename DSL>
@@ -142,31 +427,68 @@ namespace dsl {
                 auto event = IO::get<DSL>(r);
 
                 // If our get is being run without an fd (something else triggered) then short circuit
-                if (event.fd == 0) {
+                if (event.fd == 0 || event.fd == INVALID_SOCKET) {
                     return Connection{{0, 0}, {0, 0}, 0};
                 }
                 else {
-                    // Accept our connection
-                    sockaddr_in local;
-                    sockaddr_in remote;
-                    socklen_t size = sizeof(sockaddr_in);
+                    return accept(event.fd);
+                }
+            }
+
+            /// A batch of connections that were accepted together
+            struct Connections : public std::vector<Connection> {
+                operator bool() const {
+                    return !empty();
+                }
+            };
 
-                    // Accept the remote connection
-                    util::FileDescriptor fd = ::accept(event.fd, reinterpret_cast<sockaddr*>(&remote), &size);
+            /**
+             * @brief
+             *  This allows a reaction to be triggered with every connection that is waiting on a TCP port.
+             *
+             * @details
+             *  @code on<TCP::Batch>(port, listeners) @endcode
+             *  Rather than accepting a single connection each time the port becomes ready, this drains every waiting
+             *  connection and provides them together as TCP::Connections.  This avoids a round trip through the IO
+             *  system for every connection when a large number of clients connect at once.  The accepted sockets are
+             *  non blocking.
+             *
+             *  For both on<TCP> and on<TCP::Batch>, passing a number of listeners greater than one will open that
+             *  many sockets sharing the port using SO_REUSEPORT (where the platform supports it), so the kernel will
+             *  spread incoming connections across separate accept queues.
+             *
+             * @par Implements
+             *  Bind, Get
+             */
+            struct Batch {
+
+                template <typename DSL>
+                static inline std::tuple<int, int> bind(const std::shared_ptr<threading::Reaction>& reaction,
+                                                        int port      = 0,
+                                                        int listeners = 1) {
+                    return TCP::bind<DSL>(reaction, port, listeners);
+                }
 
-                    // Get our local address
-                    ::getsockname(fd, reinterpret_cast<sockaddr*>(&local), &size);
+                template <typename DSL>
+                static inline Connections get(threading::Reaction& r) {
 
-                    if (fd == -1) {
-                        return Connection{{0, 0}, {0, 0}, 0};
-                    }
-                    else {
-                        return Connection{{ntohl(remote.sin_addr.s_addr), ntohs(remote.sin_port)},
-                                          {ntohl(local.sin_addr.s_addr), ntohs(local.sin_port)},
-                                          fd.release()};
+                    // Get our file descriptor from the magic cache
+                    auto event = IO::get<DSL>(r);
+
+                    Connections connections;
+
+                    // If our get is being run without an fd (something else triggered) then short circuit
+                    if (event.fd != 0 && event.fd != INVALID_SOCKET) {
+
+                        // Accept until there are no more connections waiting
+                        for (Connection c = accept(event.fd, true); c; c = accept(event.fd, true)) {
+                            connections.push_back(c);
+                        }
                     }
+
+                    return connections;
                 }
-            }
+            };
         };
 
     }  // namespace word
@@ -179,6 +501,13 @@ namespace dsl {
         template <>
         struct is_transient<word::TCP::Connection> : public std::false_type {};
 
+        template <>
+        struct is_transient<word::TCP::Connections> : public std::false_type {};
+
+        // Frames are the same, each one should only ever be delivered once
+        template <>
+        struct is_transient<word::TCP::Frame> : public std::false_type {};
+
     }  // namespace trait
 }  // namespace dsl
 }  // namespace NUClear
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_DSL_WORD_UNIXSOCKET_HPP
+#define NUCLEAR_DSL_WORD_UNIXSOCKET_HPP
+
+#include "nuclear_bits/util/platform.hpp"
+
+// Unix domain sockets are not available on windows
+#ifndef _WIN32
+
+#include <sys/un.h>
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "nuclear_bits/PowerPlant.hpp"
+#include "nuclear_bits/dsl/word/IO.hpp"
+#include "nuclear_bits/util/FileDescriptor.hpp"
+
+namespace NUClear {
+namespace dsl {
+    namespace word {
+
+        /**
+         * @brief
+         *  This allows a reaction to be triggered based on unix domain socket activity, for communicating with other
+         *  processes on the same host without going through the network stack.
+         *
+         * @details
+         *  @code on<UnixSocket>(path) @endcode
+         *  When a connection is made to the stream socket at the given path, the associated reaction will be triggered
+         *  with the new UnixSocket::Connection.  Like TCP, reading from the connection is done with an on< IO >()
+         *  request, and UnixSocket::receive can be used to read from it so that any file descriptors that were sent
+         *  along with the data are also received.
+         *
+         *  @code on<UnixSocket::Datagram>(path) @endcode
+         *  When a datagram is received on the socket at the given path, the associated reaction will be triggered
+         *  with a UnixSocket::Packet.  Datagrams can be sent to this socket using emit<Scope::UNIX>.
+         *
+         *  Paths that begin with an '@' are bound in the abstract namespace (linux only) and do not exist in the file
+         *  system.  Any other path has any existing socket at that location replaced, and is removed when the reaction
+         *  is unbound.
+         *
+         * @attention
+         *  File descriptors can be sent along with the data (using SCM_RIGHTS).  This allows large payloads to be
+         *  shared between processes without copying them through the socket, for example by sending a memfd or shared
+         *  memory handle and mapping it on the other side.
+         *
+         * @par Implements
+         *  Bind
+         */
+        struct UnixSocket {
+
+            struct Connection {
+                Connection() : path(), fd(INVALID_SOCKET) {}
+
+                /// The path of the socket that this connection was accepted from
+                std::string path;
+                /// The file descriptor of the connection
+                fd_t fd;
+
+                operator bool() const {
+                    return fd != INVALID_SOCKET;
+                }
+            };
+
+            struct Packet {
+                Packet() : valid(false), remote(), payload(), fds() {}
+
+                /// If the packet is valid (it contains data)
+                bool valid;
+                /// The path of the socket that sent this packet, empty if it was sent from an unbound socket
+                std::string remote;
+                /// The data that was received
+                std::vector<char> payload;
+                /// Any file descriptors that were sent with the data, they are closed when the last copy is destroyed
+                /// unless they are released
+                std::vector<std::shared_ptr<util::FileDescriptor>> fds;
+
+                /// Our validator when returned for if we are a real packet
+                operator bool() const {
+                    return valid;
+                }
+            };
+
+            /// The most file descriptors that can be sent or received with a single message
+            static constexpr size_t MAX_FDS = 16;
+
+            /**
+             * @brief Fill in a unix socket address for the given path
+             *
+             * @param path      the path of the socket, or a name prefixed with '@' for the abstract namespace
+             * @param address   the address to fill in
+             *
+             * @return the length of the address
+             */
+            static inline socklen_t address(const std::string& path, sockaddr_un& address) {
+
+                std::memset(&address, 0, sizeof(sockaddr_un));
+                address.sun_family = AF_UNIX;
+
+                if (path.size() >= sizeof(address.sun_path)) {
+                    throw std::invalid_argument("The unix socket path " + path + " is too long");
+                }
+                std::memcpy(address.sun_path, path.data(), path.size());
+
+                // Abstract sockets start with a null byte and their length includes only the name
+                if (!path.empty() && path.front() == '@') {
+                    address.sun_path[0] = '\0';
+                    return socklen_t(offsetof(sockaddr_un, sun_path) + path.size());
+                }
+
+                return socklen_t(sizeof(sockaddr_un));
+            }
+
+            /**
+             * @brief Open a unix socket and bind it to a path
+             *
+             * @param path the path to bind to
+             * @param type the type of socket to open, either SOCK_STREAM or SOCK_DGRAM
+             *
+             * @return the bound socket
+             */
+            static inline fd_t open(const std::string& path, int type) {
+
+                sockaddr_un addr;
+                socklen_t len = address(path, addr);
+
+#ifdef SOCK_CLOEXEC
+                util::FileDescriptor fd = ::socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+#else
+                util::FileDescriptor fd = ::socket(AF_UNIX, type, 0);
+#endif
+                if (fd < 0) {
+                    throw std::system_error(
+                        network_errno, std::system_category(), "We were unable to open the unix socket");
+                }
+
+                // Remove anything left behind by a previous owner of this path
+                if (!path.empty() && path.front() != '@') {
+                    ::unlink(path.c_str());
+                }
+
+                if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), len)) {
+                    throw std::system_error(
+                        network_errno, std::system_category(), "We were unable to bind the unix socket to " + path);
+                }
+
+                if (type == SOCK_STREAM && ::listen(fd, 1024) < 0) {
+                    throw std::system_error(
+                        network_errno, std::system_category(), "We were unable to listen on the unix socket");
+                }
+
+                return fd.release();
+            }
+
+            /**
+             * @brief Send data and file descriptors over a unix socket
+             *
+             * @param fd        the socket to send on
+             * @param data      the data to send, at least one byte must be sent to carry file descriptors
+             * @param length    the number of bytes to send
+             * @param fds       the file descriptors to send, these remain owned by the caller
+             * @param to        Optional.  The path to send the datagram to if the socket is not connected.
+             *
+             * @return the number of bytes that were sent
+             */
+            static inline ssize_t send(fd_t fd,
+                                       const char* data,
+                                       size_t length,
+                                       const std::vector<fd_t>& fds = {},
+                                       const std::string& to        = "") {
+
+                if (fds.size() > MAX_FDS) {
+                    throw std::invalid_argument("Too many file descriptors to send in a single message");
+                }
+
+                iovec payload;
+                payload.iov_base = const_cast<char*>(data);
+                payload.iov_len  = length;
+
+                msghdr mh;
+                std::memset(&mh, 0, sizeof(msghdr));
+                mh.msg_iov    = &payload;
+                mh.msg_iovlen = 1;
+
+                sockaddr_un target;
+                if (!to.empty()) {
+                    mh.msg_namelen = address(to, target);
+                    mh.msg_name    = &target;
+                }
+
+                // Attach our file descriptors as ancillary data
+                alignas(cmsghdr) char cmbuff[CMSG_SPACE(sizeof(int) * MAX_FDS)];
+                if (!fds.empty()) {
+                    std::memset(cmbuff, 0, sizeof(cmbuff));
+                    mh.msg_control    = cmbuff;
+                    mh.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+                    cmsghdr* cmsg   = CMSG_FIRSTHDR(&mh);
+                    cmsg->cmsg_level = SOL_SOCKET;
+                    cmsg->cmsg_type  = SCM_RIGHTS;
+                    cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * fds.size());
+                    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+                }
+
+#ifdef MSG_NOSIGNAL
+                ssize_t sent = ::sendmsg(fd, &mh, MSG_NOSIGNAL);
+#else
+                ssize_t sent = ::sendmsg(fd, &mh, 0);
+#endif
+                if (sent < 0) {
+                    throw std::system_error(
+                        network_errno, std::system_category(), "We were unable to send on the unix socket");
+                }
+                return sent;
+            }
+
+            /**
+             * @brief Receive a message and any file descriptors sent with it from a unix socket
+             *
+             * @details For a datagram socket this receives a single whole datagram.  For a stream socket this
+             *          receives whatever data is available up to 64k.
+             *
+             * @param fd the socket to receive from
+             *
+             * @return the packet that was received, this will be invalid if nothing could be read
+             */
+            static inline Packet receive(fd_t fd) {
+
+                Packet p;
+
+                // Find out how big the next message is so we can receive it in one go
+                int available = 0;
+                if (::ioctl(fd, FIONREAD, &available) < 0 || available <= 0) {
+                    available = 65536;
+                }
+                p.payload.resize(size_t(available));
+
+                iovec payload;
+                payload.iov_base = p.payload.data();
+                payload.iov_len  = p.payload.size();
+
+                sockaddr_un from;
+                std::memset(&from, 0, sizeof(sockaddr_un));
+
+                alignas(cmsghdr) char cmbuff[CMSG_SPACE(sizeof(int) * MAX_FDS)];
+                std::memset(cmbuff, 0, sizeof(cmbuff));
+
+                msghdr mh;
+                std::memset(&mh, 0, sizeof(msghdr));
+                mh.msg_name       = &from;
+                mh.msg_namelen    = sizeof(sockaddr_un);
+                mh.msg_control    = cmbuff;
+                mh.msg_controllen = sizeof(cmbuff);
+                mh.msg_iov        = &payload;
+                mh.msg_iovlen     = 1;
+
+#ifdef MSG_CMSG_CLOEXEC
+                ssize_t received = ::recvmsg(fd, &mh, MSG_CMSG_CLOEXEC);
+#else
+                ssize_t received = ::recvmsg(fd, &mh, 0);
+#endif
+
+                // Take ownership of any file descriptors we were sent, even if the data was bad so they don't leak
+                for (cmsghdr* cmsg = CMSG_FIRSTHDR(&mh); cmsg != nullptr; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                        for (size_t i = 0; i < count; ++i) {
+                            int received_fd;
+                            std::memcpy(&received_fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                            p.fds.push_back(std::make_shared<util::FileDescriptor>(received_fd));
+                        }
+                    }
+                }
+
+                if (received > 0) {
+                    p.valid = true;
+                    p.payload.resize(size_t(received));
+
+                    // Work out the path of the socket that sent this, abstract names are shown with an '@'
+                    size_t path_length = mh.msg_namelen > offsetof(sockaddr_un, sun_path)
+                                             ? mh.msg_namelen - offsetof(sockaddr_un, sun_path)
+                                             : 0;
+                    if (path_length > 0 && from.sun_path[0] == '\0') {
+                        p.remote = "@" + std::string(from.sun_path + 1, path_length - 1);
+                    }
+                    else if (path_length > 0) {
+                        p.remote = std::string(from.sun_path, strnlen(from.sun_path, path_length));
+                    }
+                }
+                else {
+                    p.payload.clear();
+                }
+
+                return p;
+            }
+
+            /**
+             * @brief Register a unix socket with the IO system and clean it up when the reaction is unbound
+             */
+            static inline void configure(const std::shared_ptr<threading::Reaction>& reaction,
+                                         fd_t fd,
+                                         const std::string& path) {
+
+                // Generate a reaction for the IO system that closes on death
+                reaction->unbinders.push_back([](const threading::Reaction& r) {
+                    r.reactor.emit<emit::Direct>(std::make_unique<operation::Unbind<IO>>(r.id));
+                });
+                reaction->unbinders.push_back([fd, path](const threading::Reaction&) {
+                    close(fd);
+                    if (!path.empty() && path.front() != '@') {
+                        ::unlink(path.c_str());
+                    }
+                });
+
+                auto io_config = std::make_unique<IOConfiguration>(IOConfiguration{fd, IO::READ, reaction});
+
+                // Send our configuration out
+                reaction->reactor.emit<emit::Direct>(io_config);
+            }
+
+            template <typename DSL>
+            static inline std::tuple<std::string, fd_t> bind(const std::shared_ptr<threading::Reaction>& reaction,
+                                                             const std::string& path) {
+
+                fd_t fd = open(path, SOCK_STREAM);
+                configure(reaction, fd, path);
+
+                // Return our handles and our bound path
+                return std::make_tuple(path, fd);
+            }
+
+            template <typename DSL>
+            static inline Connection get(threading::Reaction& r) {
+
+                // Get our file descriptor from the magic cache
+                auto event = IO::get<DSL>(r);
+
+                // If our get is being run without an fd (something else triggered) then short circuit
+                if (event.fd == 0) {
+                    return Connection();
+                }
+
+                Connection connection;
+#ifdef __linux__
+                connection.fd = ::accept4(event.fd, nullptr, nullptr, SOCK_CLOEXEC);
+#else
+                connection.fd = ::accept(event.fd, nullptr, nullptr);
+#endif
+
+                // Find out what path our listening socket is bound to
+                sockaddr_un local;
+                socklen_t len = sizeof(sockaddr_un);
+                if (connection && ::getsockname(event.fd, reinterpret_cast<sockaddr*>(&local), &len) == 0
+                    && len > offsetof(sockaddr_un, sun_path)) {
+                    size_t path_length = len - offsetof(sockaddr_un, sun_path);
+                    connection.path    = local.sun_path[0] == '\0'
+                                          ? "@" + std::string(local.sun_path + 1, path_length - 1)
+                                          : std::string(local.sun_path, strnlen(local.sun_path, path_length));
+                }
+
+                return connection;
+            }
+
+            struct Datagram {
+
+                template <typename DSL>
+                static inline std::tuple<std::string, fd_t> bind(const std::shared_ptr<threading::Reaction>& reaction,
+                                                                 const std::string& path) {
+
+                    fd_t fd = open(path, SOCK_DGRAM);
+                    configure(reaction, fd, path);
+
+                    // Return our handles and our bound path
+                    return std::make_tuple(path, fd);
+                }
+
+                template <typename DSL>
+                static inline Packet get(threading::Reaction& r) {
+
+                    // Get our file descriptor from the magic cache
+                    auto event = IO::get<DSL>(r);
+
+                    // If our get is being run without an fd (something else triggered) then short circuit
+                    if (event.fd == 0) {
+                        return Packet();
+                    }
+
+                    return receive(event.fd);
+                }
+            };
+        };
+
+    }  // namespace word
+
+    namespace trait {
+
+        template <>
+        struct is_transient<word::UnixSocket::Connection> : public std::false_type {};
+
+        // Packets may carry file descriptors so they must never be delivered more than once
+        template <>
+        struct is_transient<word::UnixSocket::Packet> : public std::false_type {};
+
+    }  // namespace trait
+}  // namespace dsl
+}  // namespace NUClear
+
+#endif  // _WIN32
+
+#endif  // NUCLEAR_DSL_WORD_UNIXSOCKET_HPP
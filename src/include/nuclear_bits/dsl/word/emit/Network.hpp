@@ -20,6 +20,8 @@
 #define NUCLEAR_DSL_WORD_EMIT_NETWORK_HPP
 
 #include <array>
+#include <memory>
+#include <vector>
 
 #include "nuclear_bits/util/serialise/Serialise.hpp"
 
@@ -28,16 +30,20 @@ namespace dsl {
     namespace word {
         namespace emit {
             struct NetworkEmit {
-                NetworkEmit() : target(""), hash(), payload(), reliable(false) {}
+                NetworkEmit() : target(""), hash(), payload(), reliable(false), compress(false), latest(false) {}
 
                 /// The target to send this serialised packet to
                 std::string target;
                 /// The hash identifying the type of object
                 uint64_t hash;
-                /// The serialised data
-                std::vector<char> payload;
+                /// The serialised data, shared so it can be queued for retransmission without being copied
+                std::shared_ptr<const std::vector<char>> payload;
                 /// If the message should be sent reliably
                 bool reliable;
+                /// If the message should be compressed even if it is smaller than the configured threshold
+                bool compress;
+                /// If only the newest message of this type matters, so older ones can be dropped
+                bool latest;
             };
 
             /**
@@ -45,7 +51,7 @@ namespace dsl {
              *  Emits data over the network to other NUClear environments.
              *
              * @details
-             *  @code emit<Scope::NETWORK>(data, target, reliable, dataType); @endcode
+             *  @code emit<Scope::NETWORK>(data, target, reliable, compress, latest, dataType); @endcode
              *  Data emitted under this scope can be sent by name to other NUClear systems or to all NUClear systems
              *  connected to the NUClear network.  When sent the data is serialized; the associated serialization
              *  and deserialization of the object is handled by NUClear.
@@ -53,6 +59,15 @@ namespace dsl {
              *  These messages can be sent using either an unreliable protocol that does not guarantee delivery, or
              *  using a reliable protocol that does.
              *
+             *  Messages at least as big as the compression threshold in the NetworkConfiguration are compressed before
+             *  they are sent. Types that compress well, such as occupancy grids, can instead ask to be compressed
+             *  whatever their size. Either way the data is only sent compressed if that makes it smaller.
+             *
+             *  State that is sent often, such as poses or joint angles, can ask for only the latest of it to be
+             *  delivered. Sending a reliable message stops the retransmission of older reliable messages of the same
+             *  type to the same systems, and receivers drop any message that is older than one they have already
+             *  delivered.
+             *
              * @attention
              *  Note that if the target system is not connected to the network, the emit will be ignored even if
              *  reliable is enabled.
@@ -67,6 +82,9 @@ namespace dsl {
              * @param target    Optional.  The name of the system to send to, or empty for all systems. Defaults to all.
              *                  (an empty string).
              * @param reliable  Optional.  True if the delivery of the message should be guaranteed. Defaults to false.
+             * @param compress  Optional.  True if the message should be compressed regardless of its size. Defaults to
+             *                  false.
+             * @param latest    Optional.  True if only the newest message of this type matters. Defaults to false.
              * @tparam DataType the type of the data to send
              */
             template <typename DataType>
@@ -75,14 +93,19 @@ namespace dsl {
                 static void emit(PowerPlant& powerplant,
                                  std::shared_ptr<DataType> data,
                                  std::string target = "",
-                                 bool reliable      = false) {
+                                 bool reliable      = false,
+                                 bool compress      = false,
+                                 bool latest        = false) {
 
                     auto e = std::make_unique<NetworkEmit>();
 
                     e->target   = target;
                     e->hash     = util::serialise::Serialise<DataType>::hash();
-                    e->payload  = util::serialise::Serialise<DataType>::serialise(*data);
+                    e->payload  = std::make_shared<const std::vector<char>>(
+                        util::serialise::Serialise<DataType>::serialise(*data));
                     e->reliable = reliable;
+                    e->compress = compress;
+                    e->latest   = latest;
 
                     powerplant.emit<Direct>(e);
                 }
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_DSL_WORD_EMIT_SHAREDMEMORY_HPP
+#define NUCLEAR_DSL_WORD_EMIT_SHAREDMEMORY_HPP
+
+#include "nuclear_bits/util/platform.hpp"
+
+// Shared memory transport is built on unix domain sockets which are not available on windows
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+
+#include "nuclear_bits/PowerPlant.hpp"
+#include "nuclear_bits/dsl/word/SharedMemory.hpp"
+#include "nuclear_bits/dsl/word/UnixSocket.hpp"
+#include "nuclear_bits/util/FileDescriptor.hpp"
+#include "nuclear_bits/util/serialise/Serialise.hpp"
+
+namespace NUClear {
+namespace dsl {
+    namespace word {
+        namespace emit {
+
+            /**
+             * @brief
+             *  Emits data through shared memory to other NUClear processes on the same host.
+             *
+             * @details
+             *  @code emit<Scope::SHM>(data, channel); @endcode
+             *  The data is written once into an anonymous shared memory region which is then sealed so it can no
+             *  longer be modified.  A handle to the region is sent to every reaction on this host that is listening
+             *  with on<SharedMemory<T>>(channel), which map it into their own address space rather than having the
+             *  data copied through a socket.
+             *
+             *  Plain old data and random access containers of it are copied straight into the mapped region, other
+             *  types are serialised first and then copied in.  The receivers on a channel are only looked up again
+             *  when the channel's directory changes.
+             *
+             * @attention
+             *  Like Scope::UDP delivery is not guaranteed.  If a receiver is not keeping up with the messages being
+             *  sent to it, messages to that receiver are dropped rather than blocking the sender.
+             *
+             * @param data      the data to emit
+             * @param channel   Optional.  The channel to send the data on.  Defaults to the default channel for the type.
+             * @tparam DataType the datatype of the object to emit
+             */
+            template <typename DataType>
+            struct SharedMemory {
+
+                static inline void emit(PowerPlant&, std::shared_ptr<DataType> data, const std::string& channel = "") {
+
+                    // Find everyone who is listening on this channel, nobody listening means nothing to do
+                    auto receivers = find(channel);
+                    if (receivers->empty()) {
+                        return;
+                    }
+
+                    // Write our data into a shared memory region
+                    util::FileDescriptor memory = create();
+                    write(memory,
+                          *data,
+                          std::is_trivial<DataType>(),
+                          word::is_shared_memory_viewable<std::remove_const_t<DataType>>());
+
+#ifdef F_SEAL_SEAL
+                    // Make sure nobody can change the data underneath the receivers that have mapped it
+                    ::fcntl(memory, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+
+                    fd_t fd      = sender();
+                    char message = 0;
+                    for (const auto& receiver : *receivers) {
+                        try {
+                            word::UnixSocket::send(fd, &message, sizeof(message), {memory.fd}, receiver);
+                        }
+                        catch (const std::system_error& e) {
+                            // Nobody is listening on this socket anymore so clean it up
+                            if (e.code().value() == ECONNREFUSED) {
+                                ::unlink(receiver.c_str());
+                            }
+                            // Otherwise the receiver was busy or went away while we were sending so we drop the message
+                        }
+                    }
+                }
+
+            private:
+                /// The receivers we found the last time we looked in a channel's directory
+                struct Listing {
+                    Listing() : modified(0), settled(false), receivers() {}
+
+                    /// When the directory was last changed as of our listing
+                    time_t modified;
+                    /// If the listing was made late enough after that change to be sure it saw all of it
+                    bool settled;
+                    /// The sockets of the receivers in the directory
+                    std::shared_ptr<const std::vector<std::string>> receivers;
+                };
+
+                /**
+                 * @brief Find the sockets of the receivers that are listening on a channel
+                 *
+                 * @details Receivers come and go by adding and removing sockets in the channel's directory, so the
+                 *          directory is only listed again when its modification time changes.  Modification times are
+                 *          only kept to the second, so a listing made in the same second as a change is not reused.
+                 *
+                 * @param channel the channel to find the receivers of
+                 */
+                static inline std::shared_ptr<const std::vector<std::string>> find(const std::string& channel) {
+
+                    static std::mutex mutex;
+                    static std::map<std::string, Listing> listings;
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    Listing& listing = listings[channel];
+
+                    std::string directory = word::SharedMemory<DataType>::directory(channel);
+                    struct stat info;
+                    if (::stat(directory.c_str(), &info) < 0) {
+                        listing = Listing();
+                        return std::make_shared<const std::vector<std::string>>();
+                    }
+
+                    if (listing.receivers && listing.settled && listing.modified == info.st_mtime) {
+                        return listing.receivers;
+                    }
+
+                    // Make sure nobody else could have put sockets in the directory before we trust them
+                    std::vector<std::string> receivers;
+                    if (word::SharedMemory<DataType>::check(directory.substr(0, directory.rfind('/')))
+                        && word::SharedMemory<DataType>::check(directory)) {
+                        if (DIR* dir = ::opendir(directory.c_str())) {
+                            while (dirent* entry = ::readdir(dir)) {
+                                if (entry->d_name[0] != '.') {
+                                    receivers.push_back(directory + "/" + entry->d_name);
+                                }
+                            }
+                            ::closedir(dir);
+                        }
+                    }
+
+                    listing.modified  = info.st_mtime;
+                    listing.settled   = ::time(nullptr) > info.st_mtime;
+                    listing.receivers = std::make_shared<const std::vector<std::string>>(std::move(receivers));
+                    return listing.receivers;
+                }
+
+                /// The socket we send handles from, sending on it never waits for a slow receiver
+                static inline fd_t sender() {
+                    static util::FileDescriptor fd = [] {
+                        fd_t fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+                        if (fd < 0) {
+                            throw std::system_error(
+                                network_errno, std::system_category(), "We were unable to open the unix socket");
+                        }
+                        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+                        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+                        return fd;
+                    }();
+                    return fd.fd;
+                }
+
+                /**
+                 * @brief Size a shared memory region and map it so it can be written to
+                 *
+                 * @param memory    the shared memory region
+                 * @param size      the number of bytes it needs to hold
+                 *
+                 * @return the mapped memory, which is unmapped once it is released
+                 */
+                static inline std::shared_ptr<char> allocate(fd_t memory, size_t size) {
+
+                    if (::ftruncate(memory, off_t(size)) < 0) {
+                        throw std::system_error(
+                            errno, std::system_category(), "We were unable to size the shared memory");
+                    }
+
+                    // There is nothing to map for an empty message
+                    if (size == 0) {
+                        return nullptr;
+                    }
+
+                    void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+                    if (address == MAP_FAILED) {
+                        throw std::system_error(
+                            errno, std::system_category(), "We were unable to map the shared memory");
+                    }
+
+                    return std::shared_ptr<char>(reinterpret_cast<char*>(address),
+                                                 [size](char* ptr) { ::munmap(ptr, size); });
+                }
+
+                // Plain old data is copied straight into the shared memory
+                template <typename Viewable>
+                static inline void write(fd_t memory, const DataType& data, std::true_type, Viewable) {
+                    std::memcpy(allocate(memory, sizeof(data)).get(), &data, sizeof(data));
+                }
+
+                // So are containers of plain old data
+                static inline void write(fd_t memory, const DataType& data, std::false_type, std::true_type) {
+                    using Element = typename word::NetworkViewElement<std::remove_const_t<DataType>>::type;
+
+                    size_t count = size_t(std::distance(data.begin(), data.end()));
+                    auto mapped  = allocate(memory, count * sizeof(Element));
+                    std::copy(data.begin(), data.end(), reinterpret_cast<Element*>(mapped.get()));
+                }
+
+                // Anything else has to be serialised before it can be copied in
+                static inline void write(fd_t memory, const DataType& data, std::false_type, std::false_type) {
+                    std::vector<char> payload =
+                        util::serialise::Serialise<std::remove_const_t<DataType>>::serialise(data);
+                    auto mapped = allocate(memory, payload.size());
+                    std::copy(payload.begin(), payload.end(), mapped.get());
+                }
+
+                /// Create an anonymous shared memory region
+                static inline fd_t create() {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+                    fd_t fd = ::memfd_create("nuclear-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+                    // Make a uniquely named shared memory object and remove its name so only its handle exists
+                    std::stringstream name;
+                    name << "/nuclear-shm-" << ::getpid() << "-" << std::random_device()();
+                    fd_t fd = ::shm_open(name.str().c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+                    if (fd >= 0) {
+                        ::shm_unlink(name.str().c_str());
+                    }
+#endif
+                    if (fd < 0) {
+                        throw std::system_error(
+                            errno, std::system_category(), "We were unable to create the shared memory");
+                    }
+                    return fd;
+                }
+            };
+
+        }  // namespace emit
+    }      // namespace word
+}  // namespace dsl
+}  // namespace NUClear
+
+#endif  // _WIN32
+
+#endif  // NUCLEAR_DSL_WORD_EMIT_SHAREDMEMORY_HPP
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_DSL_WORD_EMIT_TCP_HPP
+#define NUCLEAR_DSL_WORD_EMIT_TCP_HPP
+
+#include "nuclear_bits/util/platform.hpp"
+
+#include "nuclear_bits/PowerPlant.hpp"
+#include "nuclear_bits/util/serialise/Serialise.hpp"
+
+namespace NUClear {
+namespace dsl {
+    namespace word {
+        namespace emit {
+
+            struct TCPWrite {
+                TCPWrite() : fd(INVALID_SOCKET), payload(), high_water_mark(0) {}
+
+                /// The connection to write the data to
+                fd_t fd;
+                /// The serialised data
+                std::shared_ptr<const std::vector<char>> payload;
+                /// The number of queued bytes above which the connection is considered congested
+                size_t high_water_mark;
+            };
+
+            /**
+             * @brief
+             *  Writes data to a TCP connection without blocking the emitting thread.
+             *
+             * @details
+             *  @code emit<Scope::TCP>(data, fd, high_water_mark); @endcode
+             *  The data is serialised and queued for the connection. If the connection can't take all the data
+             *  immediately the remainder is written by the IO thread once the connection is writable again, with as
+             *  many queued buffers as possible being written in a single call. Data is always written to a
+             *  connection in the order it was emitted.
+             *
+             *  If the amount of data waiting for a connection goes over the high water mark a
+             *  message::TCPBackpressure is emitted so producers can slow down. Data is never dropped because of the
+             *  high water mark.
+             *
+             * @attention
+             *  Anything emitted over TCP must be serialisable. A std::vector<char> is written as is without being
+             *  copied.
+             *
+             * @param data              the data to emit
+             * @param fd                the file descriptor of the connected socket to write to
+             * @param high_water_mark   Optional.  The number of bytes that can be queued before backpressure is
+             *                          signalled. Defaults to 4MiB.
+             * @tparam DataType         the datatype of the object to emit
+             */
+            template <typename DataType>
+            struct TCP {
+
+                static void emit(PowerPlant& powerplant,
+                                 std::shared_ptr<DataType> data,
+                                 fd_t fd,
+                                 size_t high_water_mark = 4 * 1024 * 1024) {
+
+                    auto w = std::make_unique<TCPWrite>();
+
+                    w->fd              = fd;
+                    w->payload         = serialise(data);
+                    w->high_water_mark = high_water_mark;
+
+                    powerplant.emit<Direct>(w);
+                }
+
+            private:
+                template <typename T>
+                static inline std::shared_ptr<const std::vector<char>> serialise(const std::shared_ptr<T>& data) {
+                    return std::make_shared<const std::vector<char>>(util::serialise::Serialise<T>::serialise(*data));
+                }
+
+                static inline std::shared_ptr<const std::vector<char>> serialise(
+                    const std::shared_ptr<std::vector<char>>& data) {
+                    return data;
+                }
+            };
+
+        }  // namespace emit
+    }      // namespace word
+}  // namespace dsl
+}  // namespace NUClear
+
+#endif  // NUCLEAR_DSL_WORD_EMIT_TCP_HPP
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_DSL_WORD_EMIT_UNIXSOCKET_HPP
+#define NUCLEAR_DSL_WORD_EMIT_UNIXSOCKET_HPP
+
+#include "nuclear_bits/util/platform.hpp"
+
+// Unix domain sockets are not available on windows
+#ifndef _WIN32
+
+#include "nuclear_bits/PowerPlant.hpp"
+#include "nuclear_bits/dsl/word/UnixSocket.hpp"
+#include "nuclear_bits/util/FileDescriptor.hpp"
+#include "nuclear_bits/util/serialise/Serialise.hpp"
+
+namespace NUClear {
+namespace dsl {
+    namespace word {
+        namespace emit {
+
+            /**
+             * @brief
+             *  Emits data as a datagram to a unix domain socket on this host.
+             *
+             * @details
+             *  @code emit<Scope::UNIX>(data, path, fds); @endcode
+             *  Emissions under this scope are useful for communicating with other processes on the same machine, such
+             *  as those listening with on<UnixSocket::Datagram>(path).  File descriptors can optionally be sent along
+             *  with the data, which allows large payloads to be shared by sending a handle to them (such as a memfd)
+             *  rather than copying them through the socket.
+             *
+             * @attention
+             *  Anything emitted over a unix socket must be serialisable.
+             *
+             * @param data      the data to emit
+             * @param path      the path of the socket to send to, or a name prefixed with '@' for the abstract
+             *                  namespace
+             * @param fds       Optional.  The file descriptors to send along with the data.  These are duplicated
+             *                  into the receiving process and remain owned by the sender.
+             * @tparam DataType the datatype of the object to emit
+             */
+            template <typename DataType>
+            struct UnixSocket {
+
+                static inline void emit(PowerPlant&,
+                                        std::shared_ptr<DataType> data,
+                                        const std::string& path,
+                                        const std::vector<fd_t>& fds = {}) {
+
+                    // Open a socket to send the datagram from
+                    util::FileDescriptor fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+                    if (fd < 0) {
+                        throw std::system_error(
+                            network_errno, std::system_category(), "We were unable to open the unix socket");
+                    }
+
+                    // Serialise to our payload
+                    std::vector<char> payload = util::serialise::Serialise<DataType>::serialise(*data);
+
+                    // File descriptors can't be sent without at least one byte of data to carry them
+                    if (payload.empty() && !fds.empty()) {
+                        payload.push_back(0);
+                    }
+
+                    word::UnixSocket::send(fd, payload.data(), payload.size(), fds, path);
+                }
+            };
+
+        }  // namespace emit
+    }      // namespace word
+}  // namespace dsl
+}  // namespace NUClear
+
+#endif  // _WIN32
+
+#endif  // NUCLEAR_DSL_WORD_EMIT_UNIXSOCKET_HPP
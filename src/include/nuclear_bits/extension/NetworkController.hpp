@@ -19,6 +19,8 @@
 #ifndef NUCLEAR_EXTENSION_NETWORKCONTROLLER_HPP
 #define NUCLEAR_EXTENSION_NETWORKCONTROLLER_HPP
 
+#include <unordered_map>
+
 #include "nuclear"
 #include "nuclear_bits/extension/network/NUClearNetwork.hpp"
 
@@ -30,18 +32,37 @@ namespace extension {
         explicit NetworkController(std::unique_ptr<NUClear::Environment> environment);
 
     private:
+        /// The reactions that want a type hash
+        using ReactionList = std::vector<std::shared_ptr<threading::Reaction>>;
+        /// The reactions for each type hash, the lists are shared between tables for the hashes that didn't change
+        using ReactionTable = std::unordered_map<uint64_t, std::shared_ptr<const ReactionList>>;
+
+        /// Tell the network which type hashes we have reactions for so we are only sent those
+        void update_subscriptions();
+
         /// Our NUClearNetwork object that handles the networking
         network::NUClearNetwork network;
 
-        /// The reaction that handles timed events from the network
-        ReactionHandle process_handle;
+        /// The reaction that periodically announces us to the network
+        ReactionHandle announce_handle;
+        /// The reaction that periodically removes targets that have timed out
+        ReactionHandle timeout_handle;
+        /// The reaction that retransmits when the network asks for it
+        ReactionHandle retransmit_handle;
+        /// The id of our retransmit reaction, which is also the id of the chrono task that triggers it
+        std::atomic<uint64_t> retransmit_id{0};
         /// The reactions that listen for io
         std::vector<ReactionHandle> listen_handles;
 
-        /// Mutex to guard the list of reactions
+        /// Mutex to keep our subscription updates in order
+        std::mutex subscription_mutex;
+        /// Mutex to keep changes to our reactions in order, packets never need it
         std::mutex reaction_mutex;
-        /// Map of type hashes to reactions that are interested in them
-        std::multimap<uint64_t, std::shared_ptr<threading::Reaction>> reactions;
+        /// The type hash of each of our reactions by reaction id, guarded by reaction_mutex
+        std::map<uint64_t, uint64_t> reaction_hashes;
+        /// The reactions that are interested in each type hash. A table is never changed once it is stored, instead a
+        /// changed copy replaces it using atomic_store so packets can be given to reactions without locking
+        std::shared_ptr<const ReactionTable> reactions{std::make_shared<const ReactionTable>()};
     };
 
 }  // namespace extension
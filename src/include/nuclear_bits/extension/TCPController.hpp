@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_EXTENSION_TCPCONTROLLER_HPP
+#define NUCLEAR_EXTENSION_TCPCONTROLLER_HPP
+
+#include <deque>
+
+#include "nuclear"
+#include "nuclear_bits/dsl/word/TCP.hpp"
+#include "nuclear_bits/dsl/word/emit/TCP.hpp"
+
+namespace NUClear {
+namespace extension {
+
+    class TCPController : public Reactor {
+    private:
+        struct Connection {
+            Connection(const dsl::word::TCP::Connection& info) : info(info), buffer(), start(0), end(0), handle() {}
+
+            /// Mutex to protect the buffer and file descriptor while reading from or closing the connection
+            std::mutex mutex;
+            /// The addresses and file descriptor for this connection
+            dsl::word::TCP::Connection info;
+            /// The buffer we are currently reading into, frames we emit share ownership of it
+            std::shared_ptr<std::vector<char>> buffer;
+            /// The offset of the first byte in the buffer that is not yet part of an emitted frame
+            size_t start;
+            /// The offset of the end of the data that has been read into the buffer
+            size_t end;
+            /// The reaction that reads from this connection
+            ReactionHandle handle;
+        };
+
+        struct Listener {
+            Listener(const dsl::word::TCP::StreamListen& listen)
+                : fd(listen.fd)
+                , framer(listen.framer)
+                , max_frame(listen.max_frame)
+                , reaction(listen.reaction)
+                , handle()
+                , connections() {}
+
+            /// The socket that we accept new connections from
+            fd_t fd;
+            /// The function that splits the stream into frames
+            std::function<dsl::word::TCP::Extent(const char*, size_t)> framer;
+            /// The largest frame payload we will read from a connection
+            size_t max_frame;
+            /// The reaction to trigger with each frame
+            std::shared_ptr<threading::Reaction> reaction;
+            /// The reaction that accepts new connections
+            ReactionHandle handle;
+            /// The connections that have been accepted from this listener
+            std::map<fd_t, std::shared_ptr<Connection>> connections;
+        };
+
+        struct Writer {
+            Writer(const fd_t& fd)
+                : fd(fd), queue(), offset(0), pending(0), high_water_mark(0), congested(false), closed(false), handle() {}
+
+            /// Mutex to protect the queue while it is being added to or written out
+            std::mutex mutex;
+            /// The connection we are writing to
+            fd_t fd;
+            /// The buffers that are waiting to be written in the order they were emitted
+            std::deque<std::shared_ptr<const std::vector<char>>> queue;
+            /// How much of the buffer at the front of the queue has already been written
+            size_t offset;
+            /// The total number of bytes that are waiting to be written
+            size_t pending;
+            /// The number of pending bytes above which we tell producers to back off
+            size_t high_water_mark;
+            /// If we have told producers that this connection is congested
+            bool congested;
+            /// If this writer has been removed and should no longer be used
+            bool closed;
+            /// The reaction that waits for the connection to become writable while we have pending data
+            ReactionHandle handle;
+        };
+
+    public:
+        explicit TCPController(std::unique_ptr<NUClear::Environment> environment);
+
+    private:
+        /**
+         * @brief Accept all the connections that are waiting on a listener and start reading from them
+         *
+         * @param listener the listener to accept connections from
+         */
+        void accept(const std::shared_ptr<Listener>& listener);
+
+        /**
+         * @brief Read the available data from a connection and trigger the reaction for each complete frame
+         *
+         * @param listener      the listener the connection was accepted from
+         * @param connection    the connection to read from
+         *
+         * @return false if the connection has been closed by the remote, or it sent a frame larger than we accept
+         */
+        bool read(const Listener& listener, Connection& connection);
+
+        /**
+         * @brief Stop reading from a connection and close it
+         *
+         * @param connection the connection to close
+         */
+        void disconnect(Connection& connection);
+
+        /**
+         * @brief Write as much of the queued data as the connection will currently accept without blocking
+         *
+         * @param writer the writer to flush, its mutex must be held
+         *
+         * @return false if the connection is broken and can no longer be written to
+         */
+        bool flush(Writer& writer);
+
+        /**
+         * @brief Watch for the connection becoming writable while there is pending data and signal any change in
+         *        backpressure
+         *
+         * @param writer the writer to update, its mutex must be held
+         */
+        void update(const std::shared_ptr<Writer>& writer);
+
+        /**
+         * @brief Stop writing to a connection and discard anything that is still queued for it
+         *
+         * @param writer the writer to remove, its mutex must be held
+         */
+        void remove(Writer& writer);
+
+        /// Mutex to guard the list of listeners and their connections
+        std::mutex listener_mutex;
+        /// Map of reaction ids to the stream listeners they own
+        std::map<uint64_t, std::shared_ptr<Listener>> listeners;
+
+        /// Mutex to guard the list of writers
+        std::mutex writer_mutex;
+        /// Map of file descriptors to the writers that have data queued for them
+        std::map<fd_t, std::shared_ptr<Writer>> writers;
+    };
+
+}  // namespace extension
+}  // namespace NUClear
+
+#endif  // NUCLEAR_EXTENSION_TCPCONTROLLER_HPP
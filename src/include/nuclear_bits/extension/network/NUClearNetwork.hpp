@@ -19,6 +19,7 @@
 #ifndef NUCLEAR_EXTENSION_NETWORK_NUCLEARNETWORK_HPP
 #define NUCLEAR_EXTENSION_NETWORK_NUCLEARNETWORK_HPP
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <chrono>
@@ -26,13 +27,18 @@
 #include <limits>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <queue>
+#include <shared_mutex>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "nuclear_bits/util/network/sock_t.hpp"
 #include "nuclear_bits/util/platform.hpp"
+#include "PacketTable.hpp"
+#include "ReplayWindow.hpp"
 #include "wire_protocol.hpp"
 
 namespace NUClear {
@@ -48,37 +54,179 @@ namespace extension {
 
                 NetworkTarget(std::string name,
                               sock_t target,
+                              uint16_t duplicate_window                         = 4096,
+                              uint16_t mtu                                      = 1500,
                               std::chrono::steady_clock::time_point last_update = std::chrono::steady_clock::now())
                     : name(name)
                     , target(target)
-                    , last_update(last_update)
-                    , recent_packets()
-                    , recent_packets_index(0)
+                    , slot(0)
+                    , last_update(last_update.time_since_epoch().count())
+                    , recent_mutex()
+                    , recent_packets(duplicate_window)
                     , assemblers_mutex()
+                    , removed(false)
                     , assemblers()
                     , round_trip_kf()
-                    , round_trip_time(std::chrono::seconds(1)) {
-
-                    // Set our recent packets to an invalid value
-                    recent_packets.fill(-1);
-                }
+                    , round_trip_time(std::chrono::seconds(1))
+                    , congestion()
+                    , fragments_sent(0)
+                    , fragments_retransmitted(0)
+                    , assembler_bytes(0)
+                    , assemblers_evicted(0)
+                    , mtu(mtu)
+                    , probe()
+                    , queued_groups()
+                    , subscribed(false)
+                    , subscriptions()
+                    , latest_mutex()
+                    , latest_delivered() {}
 
                 /// The name of the remote target
                 std::string name;
                 /// The socket address for the remote target
                 sock_t target;
-                /// When we last received data from the remote target
-                std::chrono::steady_clock::time_point last_update;
-                /// A list of the last n packet groups to be received
-                std::array<int, std::numeric_limits<uint8_t>::max()> recent_packets;
-                /// An index for the recent_packets (circular buffer)
-                std::atomic<uint8_t> recent_packets_index;
+                /// A small index that is unique among the connected targets, used to find this target in the send queue
+                uint32_t slot;
+                /// When we last received data from the remote target, as a steady_clock count so every receiving
+                /// thread can update it
+                std::atomic<std::chrono::steady_clock::rep> last_update;
+                /// Mutex to guard the packet groups we have recently received
+                std::mutex recent_mutex;
+                /// The packet groups we have recently finished receiving, so repeats of them can be ignored
+                ReplayWindow recent_packets;
                 /// Mutex to protect the fragmented packet storage
                 std::mutex assemblers_mutex;
+                /// If this target has been removed so we must not store any more packet groups from it
+                bool removed;
+                /// A fragmented packet group that is being rebuilt
+                struct Assembler {
+                    Assembler()
+                        : last_update()
+                        , packet_count(0)
+                        , fragment_size(0)
+                        , received_count(0)
+                        , contiguous(0)
+                        , reported(0)
+                        , last_size(0)
+                        , reliable(false)
+                        , block_size(0)
+                        , bytes(0) {}
+
+                    /// How much memory a packet group of this shape needs to lay out its fragments and parity blocks
+                    static inline size_t layout(uint32_t packet_count, size_t fragment_size, size_t blocks) {
+                        return size_t(packet_count) / 8 + 1 + size_t(packet_count) * fragment_size
+                               + blocks * sizeof(std::vector<char>);
+                    }
+
+                    /// How much memory this assembler has allocated to lay out its fragments, which is everything
+                    /// but the parity it is holding
+                    inline size_t allocated() const {
+                        return received.capacity() + data.capacity() + tail.capacity()
+                               + parity.capacity() * sizeof(std::vector<char>);
+                    }
+
+                    /// How much memory this assembler is using for its data
+                    inline size_t memory() const {
+                        size_t total = allocated();
+                        for (const auto& p : parity) {
+                            total += p.capacity();
+                        }
+                        return total;
+                    }
+
+                    /// If we have received the given fragment
+                    inline bool has(uint32_t packet_no) const {
+                        return (received[packet_no / 8] & uint8_t(1 << (packet_no % 8))) != 0;
+                    }
+
+                    /**
+                     * @brief Mark a fragment as received and update what our acknowledgements will say
+                     *
+                     * @param packet_no the fragment we have received, which must not already have been received
+                     */
+                    inline void add(uint32_t packet_no) {
+                        received[packet_no / 8] |= uint8_t(1 << (packet_no % 8));
+                        ++received_count;
+
+                        // Move the cumulative point past everything we now have
+                        while (contiguous < packet_count && has(contiguous)) {
+                            ++contiguous;
+                        }
+
+                        // Ranges the cumulative point has caught up with don't need to be sent any more
+                        for (auto it = ranges.begin(); it != ranges.end();) {
+                            if (it->second < contiguous) {
+                                it = ranges.erase(it);
+                            }
+                            else {
+                                it->first = std::max(it->first, contiguous);
+                                ++it;
+                            }
+                        }
+                        if (packet_no < contiguous) {
+                            return;
+                        }
+
+                        // Extend the run this fragment is next to, or start a new one, and make it the newest
+                        auto it = std::find_if(ranges.begin(), ranges.end(), [&](const std::pair<uint32_t, uint32_t>& r) {
+                            return r.second + 1 == packet_no || r.first == packet_no + 1;
+                        });
+                        std::pair<uint32_t, uint32_t> range(packet_no, packet_no);
+                        if (it != ranges.end()) {
+                            range = std::make_pair(std::min(it->first, packet_no), std::max(it->second, packet_no));
+                            ranges.erase(it);
+
+                            // This fragment may have filled the gap between two runs
+                            it = std::find_if(ranges.begin(), ranges.end(), [&](const std::pair<uint32_t, uint32_t>& r) {
+                                return r.second + 1 == range.first || r.first == range.second + 1;
+                            });
+                            if (it != ranges.end()) {
+                                range = std::make_pair(std::min(it->first, range.first), std::max(it->second, range.second));
+                                ranges.erase(it);
+                            }
+                        }
+                        ranges.insert(ranges.begin(), range);
+                        if (ranges.size() > ACK_RANGES) {
+                            ranges.pop_back();
+                        }
+                    }
+
+                    /// The most runs of received fragments we tell the sender about in each acknowledgement
+                    static constexpr size_t ACK_RANGES = 4;
+
+                    /// When we last received a fragment for this packet group
+                    std::chrono::steady_clock::time_point last_update;
+                    /// How many fragments make up this packet group
+                    uint32_t packet_count;
+                    /// The size of every fragment but the last, 0 until we have seen one of them
+                    size_t fragment_size;
+                    /// How many distinct fragments we have received
+                    uint32_t received_count;
+                    /// Every fragment before this one has been received
+                    uint32_t contiguous;
+                    /// The most recently changed runs of fragments received after the cumulative point, newest first
+                    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+                    /// How far through the group we last reported our progress, in 64ths
+                    uint32_t reported;
+                    /// The size of the last fragment, which tells us the total size of the data
+                    size_t last_size;
+                    /// A bitset of the fragments we have received
+                    std::vector<uint8_t> received;
+                    /// The reassembled data, each fragment is copied straight to its final position
+                    std::vector<char> data;
+                    /// The last fragment if it arrived before we knew where to put it
+                    std::vector<char> tail;
+                    /// If the group is being sent reliably, so the sender must be told if we throw it away
+                    bool reliable;
+                    /// How many fragments each parity packet covers, 0 until we have seen a parity packet
+                    uint16_t block_size;
+                    /// The parity of each block of fragments that we have received and not yet needed
+                    std::vector<std::vector<char>> parity;
+                    /// How much memory we last counted this assembler as using
+                    size_t bytes;
+                };
                 /// Storage for fragmented packets while we build them
-                std::map<uint16_t,
-                         std::pair<std::chrono::steady_clock::time_point, std::map<uint16_t, std::vector<char>>>>
-                    assemblers;
+                PacketTable<Assembler> assemblers;
 
                 /// A little kalman filter for estimating round trip time
                 struct RoundTripKF {
@@ -113,6 +261,233 @@ namespace extension {
                     round_trip_time = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
                         std::chrono::duration<float, std::ratio<1>>(X));
                 }
+
+                /**
+                 * @brief How long to wait for a packet to be acked before we consider it lost
+                 *
+                 * @details
+                 *  Round trips that are a little slower than average are common when the network is busy, so we allow
+                 *  twice our round trip estimate and never less than a few milliseconds.
+                 *
+                 * @return the time after sending a packet that it should have been acked by
+                 */
+                inline std::chrono::steady_clock::duration retransmit_timeout() const {
+                    return std::max<std::chrono::steady_clock::duration>(round_trip_time * 2,
+                                                                         std::chrono::milliseconds(10));
+                }
+
+                /// Congestion control for the reliable data we send to this target, guarded by the send queue mutex
+                struct CongestionControl {
+                    /// How many fragments we allow to be sent but not yet acknowledged
+                    double window = 10.0;
+                    /// The window size after which we stop growing exponentially and start growing linearly
+                    double threshold = 8192.0;
+                    /// How many fragments are currently sent but not yet acknowledged
+                    size_t in_flight = 0;
+                    /// Tokens in our pacing bucket, each one allows a single fragment to be sent
+                    double tokens = 10.0;
+                    /// When we last refilled our pacing bucket
+                    std::chrono::steady_clock::time_point last_refill = std::chrono::steady_clock::now();
+                    /// When we last shrank our window so we only react to a single loss each round trip
+                    std::chrono::steady_clock::time_point last_loss;
+                    /// The sequence number to give the next fragment we send, so we know the order they were sent in
+                    uint64_t sequence = 0;
+                } congestion;
+
+                /// How many fragments of reliable data we have sent to this target including retransmissions
+                std::atomic<uint64_t> fragments_sent;
+                /// How many of the fragments we sent to this target were retransmissions
+                std::atomic<uint64_t> fragments_retransmitted;
+                /// How much memory the partially received packet groups from this target are using
+                std::atomic<size_t> assembler_bytes;
+                /// How many partially received packet groups from this target we have thrown away
+                std::atomic<uint64_t> assemblers_evicted;
+
+                /// The largest datagram, including its IP and UDP headers, that we split data for this target to fit
+                std::atomic<uint16_t> mtu;
+                /// Our search for the largest datagram that reaches this target unfragmented, guarded by the send queue
+                /// mutex
+                struct PathProbe {
+                    /// The largest size we know gets through, or the smallest every path must carry
+                    uint32_t low = 0;
+                    /// The smallest size we know doesn't get through, 0 if we aren't searching
+                    uint32_t high = 0;
+                    /// The size of the probe we are waiting to hear back about, 0 if there isn't one
+                    uint16_t size = 0;
+                    /// How many times we have sent the current probe
+                    uint8_t attempts = 0;
+                    /// If any probe of this search got through, otherwise we keep the mtu we were configured with
+                    bool confirmed = false;
+                    /// When we last sent the current probe
+                    std::chrono::steady_clock::time_point sent;
+                    /// When we should next start searching
+                    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+                } probe;
+                /// The ids of the reliable packet groups queued for this target in the order they were queued, guarded
+                /// by the send queue mutex
+                std::vector<uint16_t> queued_groups;
+
+                /// If the remote has told us which types it wants, guarded by the target mutex
+                bool subscribed;
+                /// The sorted hashes of the types the remote wants, guarded by the target mutex
+                std::vector<uint64_t> subscriptions;
+                /// Mutex to guard the latest only data we have delivered
+                std::mutex latest_mutex;
+                /// For each type of latest only data, the sequence of the newest we delivered and when we delivered it
+                std::map<uint64_t, std::pair<uint32_t, std::chrono::steady_clock::time_point>> latest_delivered;
+
+                /**
+                 * @brief Check if the remote wants data of this type
+                 *
+                 * @details
+                 *  Remotes that have not told us what they want, such as older versions, are sent everything.
+                 *
+                 * @param hash the type hash of the data
+                 *
+                 * @return true if we should send this data to the remote
+                 */
+                inline bool wants(uint64_t hash) const {
+                    return !subscribed || std::binary_search(subscriptions.begin(), subscriptions.end(), hash);
+                }
+
+                /**
+                 * @brief Check if we have recently finished receiving a packet group
+                 *
+                 * @details
+                 *  This must be called for every packet group id that arrives, as it moves our window up to the
+                 *  newest id so the ids the sender reuses once they wrap around aren't mistaken for repeats.
+                 *
+                 * @param packet_id the id of the packet group
+                 *
+                 * @return true if the packet group was finished recently enough to still be in our window
+                 */
+                inline bool recently_received(uint16_t packet_id) {
+                    std::lock_guard<std::mutex> lock(recent_mutex);
+                    recent_packets.advance(packet_id);
+                    return recent_packets.contains(packet_id);
+                }
+
+                /**
+                 * @brief Remember that we have finished receiving a packet group so repeats of it are ignored
+                 *
+                 * @param packet_id the id of the packet group
+                 */
+                inline void set_recently_received(uint16_t packet_id) {
+                    std::lock_guard<std::mutex> lock(recent_mutex);
+                    recent_packets.insert(packet_id);
+                }
+
+                /**
+                 * @brief Check if latest only data is no newer than data of the same type we have already delivered
+                 *
+                 * @details
+                 *  If we haven't delivered the type for a while we take anything, so a remote that restarts its
+                 *  sequences isn't ignored forever.
+                 *
+                 * @param hash      the type hash of the data
+                 * @param sequence  the latest only sequence of the data
+                 * @param now       the current time
+                 *
+                 * @return true if the data is stale and should be dropped
+                 */
+                inline bool stale(uint64_t hash, uint32_t sequence, std::chrono::steady_clock::time_point now) {
+                    std::lock_guard<std::mutex> lock(latest_mutex);
+                    auto it = latest_delivered.find(hash);
+                    return it != latest_delivered.end() && int32_t(sequence - it->second.first) <= 0
+                           && now - it->second.second < std::chrono::seconds(1);
+                }
+
+                /**
+                 * @brief Record the delivery of latest only data if it is newer than what we have already delivered
+                 *
+                 * @param hash      the type hash of the data
+                 * @param sequence  the latest only sequence of the data
+                 *
+                 * @return true if the data is not stale and should be delivered
+                 */
+                inline bool deliver_latest(uint64_t hash, uint32_t sequence) {
+                    auto now = std::chrono::steady_clock::now();
+                    if (stale(hash, sequence, now)) {
+                        return false;
+                    }
+                    std::lock_guard<std::mutex> lock(latest_mutex);
+                    latest_delivered[hash] = std::make_pair(sequence, now);
+                    return true;
+                }
+
+                /**
+                 * @brief Grow the congestion window as fragments are acknowledged
+                 *
+                 * @details
+                 *  While we are below the threshold we grow by one fragment for every fragment acknowledged (doubling
+                 *  every round trip), after that we grow by about one fragment every round trip.
+                 *
+                 * @param acked the number of newly acknowledged fragments
+                 */
+                inline void congestion_acked(size_t acked) {
+                    auto& cc = congestion;
+                    if (cc.window < cc.threshold) {
+                        cc.window = std::min(cc.window + double(acked), cc.threshold);
+                    }
+                    else {
+                        cc.window += double(acked) / cc.window;
+                    }
+                    cc.window = std::min(cc.window, 8192.0);
+                }
+
+                /**
+                 * @brief Halve the congestion window in response to lost fragments, at most once a round trip
+                 *
+                 * @param now the current time
+                 */
+                inline void congestion_lost(std::chrono::steady_clock::time_point now) {
+                    auto& cc = congestion;
+                    if (now - cc.last_loss > round_trip_time) {
+                        cc.last_loss = now;
+                        cc.threshold = std::max(cc.window / 2.0, 2.0);
+                        cc.window    = cc.threshold;
+                    }
+                }
+
+                /**
+                 * @brief Refill our pacing bucket and work out how many fragments we may send right now
+                 *
+                 * @details
+                 *  Tokens are added so that a full window is spread over a round trip (a little faster so the window
+                 *  can still grow) and the bucket holds at most a quarter of a window so we never burst far ahead
+                 *  of the pace.
+                 *
+                 * @param now the current time
+                 *
+                 * @return the number of fragments the window and pacing allow us to send
+                 */
+                inline size_t congestion_budget(std::chrono::steady_clock::time_point now) {
+                    auto& cc = congestion;
+
+                    double rtt  = std::max(std::chrono::duration<double>(round_trip_time).count(), 1e-4);
+                    double rate = (cc.window < cc.threshold ? 2.0 : 1.25) * cc.window / rtt;
+                    double capacity = std::max(cc.window / 4.0, 4.0);
+
+                    cc.tokens = std::min(
+                        cc.tokens + std::chrono::duration<double>(now - cc.last_refill).count() * rate, capacity);
+                    cc.last_refill = now;
+
+                    double space = cc.window - double(cc.in_flight);
+                    return space < 1.0 ? 0 : size_t(std::min(space, cc.tokens));
+                }
+
+                /**
+                 * @brief Work out when the pacing bucket will next allow a fragment to be sent
+                 *
+                 * @return how long until the next token is available
+                 */
+                inline std::chrono::steady_clock::duration congestion_delay() const {
+                    auto& cc    = congestion;
+                    double rtt  = std::max(std::chrono::duration<double>(round_trip_time).count(), 1e-4);
+                    double rate = (cc.window < cc.threshold ? 2.0 : 1.25) * cc.window / rtt;
+                    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(std::max(1.0 - cc.tokens, 0.0) / rate));
+                }
             };
 
             explicit NUClearNetwork();
@@ -122,19 +497,88 @@ namespace extension {
              * @brief Send data using the NUClear network
              *
              * @param hash          the identifying hash for the data
-             * @param data          the bytes that are to be sent
-             * @param target        who we are sending to (blank means everyone)
+             * @param payload       the bytes that are to be sent, reliable data keeps a reference to these rather than
+             *                      copying them while it waits to be acknowledged
+             * @param target        who we are sending to (blank means everyone), only targets that want this type of data
+             *                      are sent it
              * @param reliable      if the delivery of the data should be ensured
+             * @param compress      if the data should be compressed even if it is smaller than our compression
+             *                      threshold, it is only sent compressed if that makes it smaller
+             * @param latest        if only the newest data of this type matters, so older reliable data to the same
+             *                      targets stops being sent and receivers drop data older than what they have delivered
+             */
+            void send(const uint64_t& hash,
+                      const std::shared_ptr<const std::vector<char>>& payload,
+                      const std::string& target,
+                      bool reliable,
+                      bool compress = false,
+                      bool latest   = false);
+
+            /**
+             * @brief Set the type hashes that we want to receive and tell the other nodes about them
+             *
+             * @details
+             *  Other nodes will only send us data with these hashes. Until this is called we don't tell anyone what we
+             *  want, and so are sent everything.
+             *
+             * @param hashes the type hashes we want to receive
+             */
+            void set_subscriptions(std::vector<uint64_t> hashes);
+
+            /**
+             * @brief Limit how much memory partially received packet groups can use
+             *
+             * @details
+             *  When a limit is exceeded the groups that have gone longest without a new fragment are thrown away,
+             *  starting with the other groups from the target that sent the fragment. If a thrown away group was
+             *  reliable, the sender is told to send it again.
+             *
+             * @param per_target    the most bytes the groups from a single target can use
+             * @param total         the most bytes the groups from all targets can use together
+             */
+            void set_assembler_limits(size_t per_target, size_t total);
+
+            /**
+             * @brief Get how many partially received packet groups we have thrown away
+             *
+             * @details
+             *  Groups are thrown away when they go too long without a new fragment or use too much memory.
+             *
+             * @return the number of groups that have been thrown away
+             */
+            uint64_t assembler_evictions() const;
+
+            /**
+             * @brief Set the callback to use to report how far through a bulk transfer we are
+             *
+             * @details
+             *  Packet groups of at least BULK_BYTES are reported each time another 64th of their
+             *  fragments has been acknowledged by the target they are being sent to, or received from the target that
+             *  is sending them. The callback is given the target, the type hash, if we are the one sending, and how
+             *  many of the group's fragments are done out of its total.
+             *
+             * @param f the callback function
              */
-            void send(const uint64_t& hash, const std::vector<char>& payload, const std::string& target, bool reliable);
+            void set_progress_callback(
+                std::function<void(const NetworkTarget&, const uint64_t&, const bool&, const uint32_t&, const uint32_t&)>
+                    f);
 
             /**
              * @brief Set the callback to use when a data packet is completed
              *
+             * @details
+             *  The callback is given who sent the data, its type hash, if it was sent reliably, when the last packet
+             *  of it arrived and the data itself. The data is always its own allocation starting at the start of the
+             *  vector, so it is aligned for any fundamental type and can be moved somewhere that shares it without a
+             *  copy.
+             *
              * @param f the callback function
              */
-            void set_packet_callback(
-                std::function<void(const NetworkTarget&, const uint64_t&, const bool&, std::vector<char>&&)> f);
+            void set_packet_callback(std::function<void(const NetworkTarget&,
+                                                        const uint64_t&,
+                                                        const bool&,
+                                                        const std::chrono::steady_clock::time_point&,
+                                                        std::vector<char>&&)> f);
 
             /**
              * @brief Set the callback to use when a node joins the network
@@ -174,18 +618,73 @@ namespace extension {
              * @param name          the name of this node in the network
              * @param address       the address to announce on
              * @param port          the port to use for announcement
-             * @param network_mtu   the mtu of the network we operate on
+             * @param network_mtu       the mtu of the network we operate on
+             * @param receive_sockets   how many sockets share our data port so packets can be received in parallel
+             * @param compression_threshold data this many bytes or bigger is compressed before sending, 0 to only
+             *                              compress when send is asked to
+             * @param fec_block_size    send a parity packet for every this many fragments of unreliable data so any one
+             *                          of them can be lost, 0 to send no parity
+             * @param duplicate_window  how many of the most recent packet ids from each target we remember finishing,
+             *                          so that repeats of them are not delivered twice
+             * @param max_mtu           the largest path mtu to search for with each target, which is then used to
+             *                          decide how big the fragments sent to them are, 0 to always use network_mtu
              */
             void reset(const std::string& name,
                        const std::string& address,
                        in_port_t port,
-                       uint16_t network_mtu = 1500);
+                       uint16_t network_mtu           = 1500,
+                       uint16_t receive_sockets       = 1,
+                       uint32_t compression_threshold = 0,
+                       uint16_t fec_block_size        = 0,
+                       uint16_t duplicate_window      = 4096,
+                       uint16_t max_mtu               = 9000);
 
             /**
-             * @brief Process waiting data in the UDP sockets and send them to the callback if they are relevant.
+             * @brief Do our timed work and then process waiting data in all of the UDP sockets
              */
             void process();
 
+            /**
+             * @brief Announce ourselves if it is time, drop targets that have timed out and retransmit lost packets
+             *
+             * @details
+             *  This runs all of the timed work at once for users that drive the network by calling process. Users with
+             *  their own timers should instead call announce and check_timeouts periodically, and retransmit when the
+             *  next event callback asks for it.
+             */
+            void housekeeping();
+
+            /**
+             * @brief Send an announce packet to our announce address
+             *
+             * @details
+             *  This should be called about every 500ms so that other nodes know we are still here.
+             */
+            void announce();
+
+            /**
+             * @brief Remove any targets we have not heard from in the last two seconds and tell the leave callback
+             */
+            void check_timeouts();
+
+            /**
+             * @brief Retransmit packets whose retransmit timers have expired without them being acked
+             *
+             * @details
+             *  Once it is done the next event callback is told when the next retransmit timer will expire.
+             */
+            void retransmit();
+
+            /**
+             * @brief Process waiting data in one of our UDP sockets and send them to the callback if they are relevant
+             *
+             * @details
+             *  Each of the file descriptors from listen_fds can be processed on a different thread at the same time.
+             *
+             * @param fd the file descriptor to read from
+             */
+            void process(fd_t fd);
+
             /**
              * @brief Get the file descriptors that the network listens on
              *
@@ -194,40 +693,192 @@ namespace extension {
             std::vector<fd_t> listen_fds();
 
         private:
+            /// The most datagrams we will read from a socket in a single call
+            static constexpr size_t RECEIVE_BATCH = 32;
+            /// The most datagrams we will give to the kernel to send in a single call
+            static constexpr size_t SEND_BATCH = 64;
+            /// The largest datagram we can receive
+            static constexpr size_t MAX_DATAGRAM = 65536;
+            /// How many later packets must be acked before we consider an unacked packet lost
+            static constexpr uint64_t REORDER_THRESHOLD = 3;
+            /// Space for the ancillary data the kernel gives us with each datagram, such as its receive timestamp
+            static constexpr size_t CONTROL_SIZE = 64;
+            /// How long a partially received unreliable packet group can go without a new fragment before we throw it
+            /// away, as nothing will be sent again to finish it
+            static constexpr std::chrono::seconds ASSEMBLER_TIMEOUT = std::chrono::seconds(1);
+            /// How many of its sender's retransmit timeouts a partially received reliable packet group can go without a
+            /// new fragment before we throw it away, as the sender keeps resending whatever we haven't acked
+            static constexpr int ASSEMBLER_RETRANSMITS = 4;
+            /// The least time a partially received reliable packet group can go without a new fragment before we throw
+            /// it away, which allows for the retransmit timeout of a sender that hasn't measured its round trip yet
+            static constexpr std::chrono::seconds RELIABLE_ASSEMBLER_TIMEOUT = std::chrono::seconds(8);
+            /// Packet groups of at least this many bytes are bulk transfers, which report their progress and only get
+            /// the congestion window that smaller groups leave
+            static constexpr size_t BULK_BYTES = 1024 * 1024;
+            /// The IP and UDP headers of an IPv4 datagram, IPv4 options are rare enough that we don't allow for them
+            static constexpr uint16_t IPV4_DATAGRAM_OVERHEAD = 20 + 8;
+            /// The IP and UDP headers of an IPv6 datagram
+            static constexpr uint16_t IPV6_DATAGRAM_OVERHEAD = 40 + 8;
+            /// How many times we send a path mtu probe before deciding it is too big to get through
+            static constexpr uint8_t PROBE_ATTEMPTS = 3;
+            /// We stop searching for a target's path mtu once we know it to within this many bytes
+            static constexpr uint32_t PROBE_RESOLUTION = 16;
+            /// How long we wait after finding a target's path mtu before checking if it has changed
+            static constexpr std::chrono::minutes PROBE_INTERVAL = std::chrono::minutes(10);
+
+            /// Memory that a batch of datagrams is read into, reused between reads
+            struct ReceiveBuffer {
+                ReceiveBuffer();
+
+                /// Who sent each datagram
+                std::array<sock_t, RECEIVE_BATCH> from;
+                /// The length of each datagram
+                std::array<size_t, RECEIVE_BATCH> length;
+                /// When each datagram arrived, from the kernel if it can tell us or when we read it otherwise
+                std::array<std::chrono::steady_clock::time_point, RECEIVE_BATCH> received;
+                /// Storage for the ancillary data of each datagram, each gets CONTROL_SIZE bytes
+                std::vector<char> control;
+                /// Storage for the datagrams, each gets MAX_DATAGRAM bytes
+                std::vector<char> data;
+            };
+
             struct PacketQueue {
 
                 struct PacketTarget {
 
                     /// Constructor a new PacketTarget
-                    PacketTarget(std::weak_ptr<NetworkTarget> target, std::vector<uint8_t> acked);
+                    PacketTarget(const std::shared_ptr<NetworkTarget>& target,
+                                 uint16_t fragment_size,
+                                 uint32_t packet_count);
 
                     /// The target we are sending this packet to
                     std::weak_ptr<NetworkTarget> target;
 
+                    /// The address of the target so we can identify it without locking the weak_ptr
+                    const NetworkTarget* identity;
+
+                    /// The slot the target had when this packet was queued
+                    uint32_t slot;
+
+                    /// How much data goes in each packet, fixed when queued so retransmissions match the originals
+                    uint16_t fragment_size;
+
+                    /// How many packets the data is split into for this target
+                    uint32_t packet_count;
+
                     /// The bitset of the packets that have been acked
                     std::vector<uint8_t> acked;
 
+                    /// Every packet before this one has been acked
+                    uint32_t acked_below;
+
+                    /// How many packets have been acked
+                    uint32_t acked_count;
+
+                    /// How far through the group we last reported our progress, in 64ths
+                    uint32_t reported;
+
                     /// When we last sent data to this client
                     std::chrono::steady_clock::time_point last_send;
+
+                    /// The bitset of the packets that have been sent and are waiting to be acked
+                    std::vector<uint8_t> sent;
+
+                    /// Every packet before this one has been sent at least once
+                    uint32_t next;
+
+                    /// The sequence number each packet was last sent with
+                    std::vector<uint64_t> sequence;
+
+                    /// The highest sequence number that has been acked
+                    uint64_t highest_acked;
                 };
 
                 /// Default constructor for the PacketQueue
                 PacketQueue();
 
+                /**
+                 * @brief Add a target that wants this packet
+                 *
+                 * @param target        the target to send to
+                 * @param fragment_size how much data to put in each packet sent to this target
+                 * @param packet_count  how many packets the packet group is split into for this target
+                 */
+                void add(const std::shared_ptr<NetworkTarget>& target, uint16_t fragment_size, uint32_t packet_count);
+
+                /**
+                 * @brief Find the entry for a target using its slot
+                 *
+                 * @param target the target to look for
+                 *
+                 * @return the entry for this target, or nullptr if it does not want this packet
+                 */
+                PacketTarget* find(const NetworkTarget& target);
+
+                /**
+                 * @brief Remove a target, the last target is moved into its place
+                 *
+                 * @param index the index of the target in targets
+                 */
+                void erase(size_t index);
+
                 /// The remote targets that want this packet
-                std::list<PacketTarget> targets;
+                std::vector<PacketTarget> targets;
+
+                /// For each target slot the index into targets plus one, or zero if that slot does not want this packet
+                std::vector<uint32_t> slots;
 
                 /// The header of the packet to send
                 DataPacket header;
 
-                /// The data to send
-                std::vector<char> payload;
+                /// The data to send, shared with the emit that created it
+                std::shared_ptr<const std::vector<char>> payload;
             };
 
+            /// A range of packets sent to a target that we expect to have been acked by a deadline
+            struct RetransmitTimer {
+
+                /// When the packets should have been acked by
+                std::chrono::steady_clock::time_point deadline;
+
+                /// The packet group the packets are from
+                uint16_t packet_id;
+
+                /// The target the packets were sent to
+                std::weak_ptr<NetworkTarget> target;
+
+                /// The first and last sequence numbers the packets were sent with
+                uint64_t first;
+                uint64_t last;
+
+                /// Order timers so the earliest deadline is at the top of the heap
+                bool operator>(const RetransmitTimer& other) const {
+                    return deadline > other.deadline;
+                }
+            };
+
+            /**
+             * @brief Mark the given packets of a packet group as lost so they will be resent
+             *
+             * @param target    the target we sent the packets to
+             * @param queue     the target's entry in the send queue
+             * @param first     the first sequence number that is lost
+             * @param last      the last sequence number that is lost
+             *
+             * @return the number of packets that were in flight and are now lost
+             */
+            static size_t mark_lost(NetworkTarget& target,
+                                    PacketQueue::PacketTarget& queue,
+                                    uint64_t first,
+                                    uint64_t last);
+
             /**
-             * @brief Open our data udp socket
+             * @brief Open our data udp sockets, all bound to the same port
+             *
+             * @param announce_target   the address we announce to, which decides the address family
+             * @param receive_sockets   how many sockets to open
              */
-            void open_data(const sock_t& announce_target);
+            void open_data(const sock_t& announce_target, uint16_t receive_sockets);
 
             /**
              * @brief Open our announce udp socket
@@ -235,47 +886,303 @@ namespace extension {
             void open_announce(const sock_t& announce_target);
 
             /**
-             * @brief Read a single packet from the given udp file descriptor
+             * @brief Open the udp socket we send path mtu probes from, which never lets its datagrams be fragmented
              *
-             * @param fd the file descriptor to read from
+             * @details
+             *  If the platform can't stop datagrams being fragmented no socket is opened and we don't probe.
+             *
+             * @param announce_target   the address we announce to, which decides the address family
+             */
+            void open_probe(const sock_t& announce_target);
+
+            /**
+             * @brief Work out how much of a datagram sent to an address is taken up by its IP and UDP headers
+             *
+             * @param address the address the datagram is sent to
+             *
+             * @return how many bytes the headers take up
+             */
+            static uint16_t datagram_overhead(const sock_t& address);
+
+            /**
+             * @brief Work out how much data fits in each fragment of a packet group
+             *
+             * @param mtu     the largest datagram we can send, including its IP and UDP headers
+             * @param address the address we are sending to, which decides how big the IP header is
+             *
+             * @return how many bytes of data can go in each data packet
+             */
+            static uint16_t data_mtu(uint16_t mtu, const sock_t& address);
+
+            /**
+             * @brief Resend path mtu probes that have not been answered and start searches that are due
+             *
+             * @details
+             *  The target mutex and the send queue mutex must be held when calling this.
+             *
+             * @param now the current time
+             */
+            void probe_paths(std::chrono::steady_clock::time_point now);
+
+            /**
+             * @brief Send the next probe of a path mtu search, or finish the search if we have narrowed it enough
+             *
+             * @details
+             *  The send queue mutex must be held when calling this.
+             *
+             * @param target    the target whose path we are probing
+             * @param now       the current time
+             */
+            void next_probe(NetworkTarget& target, std::chrono::steady_clock::time_point now);
+
+            /**
+             * @brief Send a path mtu probe to a target
+             *
+             * @param target    the target whose path we are probing
+             * @param size      how big the probe datagram should be, including its IP and UDP headers
+             *
+             * @return false if the probe was too big for our own network interface to send
+             */
+            bool send_probe(const NetworkTarget& target, uint16_t size);
+
+            /**
+             * @brief Read the packets that are waiting on the given udp file descriptor without blocking
+             *
+             * @param fd        the file descriptor to read from
+             * @param buffer    the buffer to read up to RECEIVE_BATCH packets into
+             *
+             * @return the number of packets that were read
+             */
+            size_t read_socket(fd_t fd, ReceiveBuffer& buffer);
+
+            /**
+             * @brief Make the parity packets for an unreliable packet group
+             *
+             * @param header        the header of the data packets in the group
+             * @param fragment_size how much data is in each of the data packets
+             * @param payload       the data of the whole group
+             *
+             * @return a parity packet for each block of fec_block_size fragments
+             */
+            std::vector<std::vector<char>> make_parity(const DataPacket& header,
+                                                       uint16_t fragment_size,
+                                                       const std::vector<char>& payload);
+
+            /**
+             * @brief Rebuild the one missing fragment of a block using its parity if we are able to
+             *
+             * @param assembler the packet group we are rebuilding
+             * @param block     the block of fragments to try to complete
+             */
+            static void recover_fragment(NetworkTarget::Assembler& assembler, uint32_t block);
+
+            /**
+             * @brief Update how much memory we count a packet group as using after it has changed
+             *
+             * @details
+             *  The target's assemblers mutex must be held when calling this.
+             *
+             * @param target    the target that is sending the packet group
+             * @param assembler the packet group that has changed
+             */
+            void account_assembler(NetworkTarget& target, NetworkTarget::Assembler& assembler);
+
+            /**
+             * @brief Throw away a packet group and stop counting its memory
+             *
+             * @details
+             *  The target's assemblers mutex must be held when calling this, and any references to the target's
+             *  assemblers are no longer valid afterwards.
+             *
+             * @param target    the target that is sending the packet group
+             * @param packet_id the id of the packet group
+             */
+            void erase_assembler(NetworkTarget& target, uint16_t packet_id);
+
+            /**
+             * @brief Throw away a packet group before it was completed, asking for it to be resent if it was reliable
+             *
+             * @details
+             *  The target's assemblers mutex must be held when calling this, and any references to the target's
+             *  assemblers are no longer valid afterwards.
+             *
+             * @param target    the target that is sending the packet group
+             * @param packet_id the id of the packet group
+             */
+            void evict_assembler(NetworkTarget& target, uint16_t packet_id);
+
+            /**
+             * @brief Throw away a target's oldest packet groups until we are within our memory limits
+             *
+             * @details
+             *  The current packet group is only thrown away if throwing away all the others wasn't enough. The
+             *  target's assemblers mutex must be held when calling this, and any references to the target's
+             *  assemblers are no longer valid afterwards.
+             *
+             * @param target    the target that is sending the packet groups
+             * @param current   the id of the packet group that was just added to
+             * @param growth    how much more memory the current packet group is about to allocate
+             *
+             * @return false if the current packet group had to be thrown away
+             */
+            bool limit_assemblers(NetworkTarget& target, uint16_t current, size_t growth = 0);
+
+            /**
+             * @brief Make room for a packet group to grow before allocating its memory
+             *
+             * @details
+             *  The size of a packet group comes from the remote, so we check it fits within our memory limits before
+             *  allocating it rather than after. The target's assemblers mutex must be held when calling this, and
+             *  any references to the target's assemblers are no longer valid afterwards.
+             *
+             * @param target    the target that is sending the packet group
+             * @param packet_id the id of the packet group
+             * @param bytes     how much memory the packet group's layout will need, see Assembler::layout
+             *
+             * @return false if the packet group can't fit, in which case it has been thrown away
+             */
+            bool reserve_assembler(NetworkTarget& target, uint16_t packet_id, size_t bytes);
+
+            /**
+             * @brief Undo the compression of a completed data packet
+             *
+             * @details
+             *  The uncompressed size is read from the data, so it is only trusted if LZ4 could have compressed that
+             *  much into the data we received and it is within the limits we put on packet groups.
+             *
+             * @param packet    the header of the data packet, which says how it was compressed
+             * @param data      the data of the whole packet group, replaced with the uncompressed data
+             *
+             * @return true if the data could be decompressed and should be given to the packet callback
+             */
+            bool decompress(const DataPacket& packet, std::vector<char>& data) const;
+
+            /**
+             * @brief Send the types we want to receive to a target if we have been given them
+             *
+             * @param to the address to send our subscriptions to
+             */
+            void send_subscriptions(const sock_t& to);
+
+            /**
+             * @brief Acknowledge every fragment of a packet group we don't need any more of
              *
-             * @return the data and who it was sent from
+             * @param to        the address to send the acknowledgement to
+             * @param packet    the header of the data packet we got from the group
              */
-            std::pair<sock_t, std::vector<char>> read_socket(fd_t fd);
+            void send_complete_ack(const sock_t& to, const DataPacket& packet);
+
+            /**
+             * @brief Acknowledge a fragment of a packet group along with what else we have received of it
+             *
+             * @param to        the address to send the acknowledgement to
+             * @param packet    the header of the data packet we are acknowledging
+             * @param assembler the packet group the fragment was added to
+             */
+            void send_ack(const sock_t& to, const DataPacket& packet, const NetworkTarget::Assembler& assembler);
+
+            /**
+             * @brief Ask for a packet group to be sent again as we have thrown away what we had of it
+             *
+             * @details
+             *  The nack says which packets we still hold, so the sender keeps those acked whatever order it gets our
+             *  acks and nacks in, and only sends the rest again.
+             *
+             * @param to        the address of the target sending the packet group
+             * @param packet_id the id of the packet group
+             * @param count     how many packets there are in the group
+             * @param held      what we have of the group since throwing the rest away, nullptr if we have none of it
+             */
+            void send_nack(const sock_t& to,
+                           uint16_t packet_id,
+                           uint32_t count,
+                           const NetworkTarget::Assembler* held = nullptr);
+
+            /**
+             * @brief Tell the progress callback how far through a bulk transfer we are if it has moved far enough
+             *
+             * @param target    the target we are sending to or receiving from
+             * @param hash      the type hash of the data being transferred
+             * @param sending   if we are the one sending the data
+             * @param done      how many fragments have been acked or received
+             * @param total     how many fragments there are in the packet group
+             * @param fragment_size how much data is in each fragment
+             * @param reported  how far through the group we last reported, in 64ths, updated if we report
+             */
+            void report_progress(const NetworkTarget& target,
+                                 const uint64_t& hash,
+                                 bool sending,
+                                 uint32_t done,
+                                 uint32_t total,
+                                 uint16_t fragment_size,
+                                 uint32_t& reported);
 
             /**
              * @brief Processes the given packet and calls the callback if a packet was completed
              *
              * @param address   who the packet came from
-             * @param data      the data that was sent in this packet
+             * @param payload   the data that was sent in this packet, only valid for the duration of the call
+             * @param length    the number of bytes in the packet
+             * @param received  when the packet arrived at this machine
              */
-            void process_packet(const sock_t& address, std::vector<char>&& payload);
+            void process_packet(const sock_t& address,
+                                const char* payload,
+                                size_t length,
+                                std::chrono::steady_clock::time_point received);
 
             /**
-             * @brief Send an announce packet to our announce address
+             * @brief Send as much of our queued reliable data as the congestion window and pacing of each target allow
+             *
+             * @details
+             *  Packets that were sent before and are no longer in flight are resent before any new packets.
+             *  Every batch that is sent gets a retransmit timer, and targets that have disconnected are removed.
+             *  When given a target only the packet groups queued for it are looked at, stopping at the first that
+             *  doesn't fit its window, so this is cheap enough to call for every ack.
+             *  The send queue mutex must be held when calling this.
+             *
+             * @param target    only send to this target, or to every target if it is null
              */
-            void announce();
+            void transmit(const std::shared_ptr<NetworkTarget>& target = nullptr);
 
             /**
-             * @brief Retransmit waiting packets that failed to send
+             * @brief Ask to be processed again at the given time if it is before we would otherwise be processed
+             *
+             * @param time  when we next need attention
              */
-            void retransmit();
+            void schedule_event(std::chrono::steady_clock::time_point time);
 
             /**
              * @brief Send an individual packet to an individual target
              *
-             * @param target    the target to send the packet to
-             * @param header    the header for this packet
-             * @param packet_no the packet number we are sending
-             * @param payload   the data bytes for the entire packet
-             * @param reliable  if the packet is reliable (don't drop)
+             * @param target        the target to send the packet to
+             * @param header        the header for this packet
+             * @param fragment_size how much data is in each packet of the group
+             * @param packet_no     the packet number we are sending
+             * @param payload       the data bytes for the entire packet
+             * @param reliable      if the packet is reliable (don't drop)
              */
             void send_packet(const sock_t& target,
                              DataPacket header,
-                             uint16_t packet_no,
+                             uint16_t fragment_size,
+                             uint32_t packet_no,
                              const std::vector<char>& payload,
                              const bool& reliable);
 
+            /**
+             * @brief Send a number of packets from a packet group to an individual target in as few calls as possible
+             *
+             * @param target        the target to send the packets to
+             * @param header        the header for the packet group
+             * @param fragment_size how much data is in each packet of the group
+             * @param packet_nos    the packet numbers we are sending
+             * @param payload       the data bytes for the entire packet group
+             */
+            void send_packets(const sock_t& target,
+                              const DataPacket& header,
+                              uint16_t fragment_size,
+                              const std::vector<uint32_t>& packet_nos,
+                              const std::vector<char>& payload);
+
             /**
              * @brief Get the map key for this socket address
              *
@@ -294,21 +1201,65 @@ namespace extension {
 
             /// The file descriptor for the socket we use to send data and receive regular data
             fd_t data_fd;
+            /// All the file descriptors that share our data port for receiving, starting with data_fd
+            std::vector<fd_t> data_fds;
             /// The file descriptor for the socket we use to receive announce data
             fd_t announce_fd;
+            /// The file descriptor for the socket we send path mtu probes from, -1 if we aren't probing
+            fd_t probe_fd;
 
+            /// The mtu of the network we operate on, used for each target until we find its path mtu
+            uint16_t network_mtu;
             /// The largest packet of data we will transmit, based on our IP version and MTU
             uint16_t packet_data_mtu;
+            /// The mtu that every path of our IP version must carry, the lowest a path mtu search will go
+            uint16_t min_mtu;
+            /// The data that fits in each packet on a path that only carries min_mtu
+            uint16_t min_data_mtu;
+            /// The highest a path mtu search will go, 0 if we don't search
+            uint16_t max_mtu;
 
             // Our announce packet
             std::vector<char> announce_packet;
 
+            /// Mutex to guard our subscribe packet
+            std::mutex subscribe_mutex;
+            /// The packet telling others which types we want, empty until we have been given our subscriptions
+            std::vector<char> subscribe_packet;
+
             /// An atomic source for packet IDs to make sure they are semi unique
             std::atomic<uint16_t> packet_id_source;
+            /// The last sequence we gave latest only data of each type, guarded by the send queue mutex
+            std::map<uint64_t, uint32_t> latest_sequence;
+
+            /// Data this many bytes or bigger is compressed before it is sent, 0 if we only compress when asked
+            uint32_t compression_threshold;
+
+            /// How many fragments of unreliable data each parity packet covers, 0 if we don't send parity
+            uint16_t fec_block_size;
+
+            /// How many recently finished packet ids we remember for each target
+            uint16_t duplicate_window;
+
+            /// The most memory the partially received packet groups from a single target can use
+            std::atomic<size_t> target_assembler_limit;
+            /// The most memory the partially received packet groups from all targets can use
+            std::atomic<size_t> total_assembler_limit;
+            /// How much memory the partially received packet groups from all targets are using
+            std::atomic<size_t> total_assembler_bytes;
+            /// How many partially received packet groups we have thrown away
+            std::atomic<uint64_t> total_assemblers_evicted;
 
             /// The callback to execute when a data packet is completed
-            std::function<void(const NetworkTarget&, const uint64_t&, const bool&, std::vector<char>&&)>
+            std::function<void(const NetworkTarget&,
+                               const uint64_t&,
+                               const bool&,
+                               const std::chrono::steady_clock::time_point&,
+                               std::vector<char>&&)>
                 packet_callback;
+            /// The callback to execute when a bulk transfer has made progress
+            std::function<void(const NetworkTarget&, const uint64_t&, const bool&, const uint32_t&, const uint32_t&)>
+                progress_callback;
             /// The callback to execute when a node joins the network
             std::function<void(const NetworkTarget&)> join_callback;
             /// The callback to execute when a node leaves the network
@@ -316,23 +1267,41 @@ namespace extension {
             /// The callback to execute when a node leaves the network
             std::function<void(std::chrono::steady_clock::time_point)> next_event_callback;
 
-            /// When we are next due to send an announce packet
-            std::chrono::steady_clock::time_point last_announce;
+            /// When we last sent an announce packet, as a steady_clock count as the timer and packets can both announce
+            std::atomic<std::chrono::steady_clock::rep> last_announce;
             /// When the next timed event is due
             std::chrono::steady_clock::time_point next_event;
+            /// A mutex to guard next_event as it can be updated from every receiving thread
+            std::mutex event_mutex;
 
-            /// A mutex to guard modifications to the target lists
+            /// A mutex to guard modifications to the target lists, packets only need to share it to find their target
             /// NOTE: mutex lock order must always be this order to avoid deadlocks
-            std::mutex target_mutex;
+            std::shared_timed_mutex target_mutex;
             /// A mutex to guard modifications to the send queue
             std::mutex send_queue_mutex;
 
-            /// A map from packet_id to allow resending reliable data
-            std::map<uint16_t, PacketQueue> send_queue;
+            /// A mutex to guard the pool of receive buffers
+            std::mutex receive_pool_mutex;
+            /// Receive buffers that are not currently in use
+            std::vector<std::unique_ptr<ReceiveBuffer>> receive_pool;
+
+            /// A table from packet_id to allow resending reliable data
+            PacketTable<PacketQueue> send_queue;
+
+            /// A heap of when packets we sent should have been acked by, guarded by the send queue mutex
+            std::priority_queue<RetransmitTimer, std::vector<RetransmitTimer>, std::greater<RetransmitTimer>>
+                retransmit_timers;
+            /// When a target that ran out of pacing tokens can next be sent to, guarded by the send queue mutex
+            std::chrono::steady_clock::time_point transmit_due;
 
             /// A list of targets that we are connected to on the network
             std::list<std::shared_ptr<NetworkTarget>> targets;
 
+            /// Slots that were used by targets that have left and can be given to new targets
+            std::vector<uint32_t> free_slots;
+            /// The next slot to give out when there are no free slots
+            uint32_t next_slot;
+
             /// A map of string names to targets with that name
             std::multimap<std::string, std::shared_ptr<NetworkTarget>> name_target;
 
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_EXTENSION_NETWORK_PACKETTABLE_HPP
+#define NUCLEAR_EXTENSION_NETWORK_PACKETTABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace NUClear {
+namespace extension {
+    namespace network {
+
+        /**
+         * @brief A flat hash table from packet ids to values using open addressing
+         *
+         * @details
+         *  Packet ids are handed out sequentially, so the low bits of the id are used directly as the hash. This keeps
+         *  ids that are in flight together in neighbouring slots, and means iterating the table visits them roughly
+         *  in the order they were sent. Collisions are resolved with linear probing and removal shifts the following
+         *  entries back so no tombstones are needed.
+         *
+         * @tparam T the type of value to store, it must be default constructible and movable
+         */
+        template <typename T>
+        class PacketTable {
+        public:
+            PacketTable() : slots(16), count(0) {}
+
+            /**
+             * @brief Find the value for a packet id
+             *
+             * @param id the packet id to look for
+             *
+             * @return a pointer to the value, or nullptr if there is no value for this id
+             */
+            T* find(uint16_t id) {
+                for (size_t i = id & mask();; i = (i + 1) & mask()) {
+                    if (!slots[i].used) {
+                        return nullptr;
+                    }
+                    if (slots[i].id == id) {
+                        return &slots[i].value;
+                    }
+                }
+            }
+
+            /**
+             * @brief Check if there is a value for a packet id
+             *
+             * @param id the packet id to look for
+             *
+             * @return true if there is a value for this id
+             */
+            bool contains(uint16_t id) {
+                return find(id) != nullptr;
+            }
+
+            /**
+             * @brief Get the value for a packet id, default constructing it if it does not exist
+             *
+             * @param id the packet id to get the value for
+             *
+             * @return the value for this packet id
+             */
+            T& operator[](uint16_t id) {
+
+                // Keep the table at most half full so probe sequences stay short
+                if ((count + 1) * 2 > slots.size()) {
+                    resize(slots.size() * 2);
+                }
+
+                size_t i = id & mask();
+                for (; slots[i].used; i = (i + 1) & mask()) {
+                    if (slots[i].id == id) {
+                        return slots[i].value;
+                    }
+                }
+
+                slots[i].used  = true;
+                slots[i].id    = id;
+                slots[i].value = T();
+                ++count;
+                return slots[i].value;
+            }
+
+            /**
+             * @brief Remove the value for a packet id if there is one
+             *
+             * @param id the packet id to remove
+             */
+            void erase(uint16_t id) {
+
+                // Find the slot we are removing
+                size_t i = id & mask();
+                for (; slots[i].used && slots[i].id != id; i = (i + 1) & mask()) {
+                }
+                if (!slots[i].used) {
+                    return;
+                }
+
+                // Shift back any following entries that would no longer be reachable past the hole
+                for (size_t j = (i + 1) & mask(); slots[j].used; j = (j + 1) & mask()) {
+                    size_t home = slots[j].id & mask();
+
+                    // If the entry's home is cyclically outside (i, j] it was probing past our hole
+                    if (((j - home) & mask()) >= ((j - i) & mask())) {
+                        slots[i].id    = slots[j].id;
+                        slots[i].value = std::move(slots[j].value);
+                        i              = j;
+                    }
+                }
+
+                slots[i].used  = false;
+                slots[i].value = T();
+                --count;
+
+                // Shrink again once a burst of packets is over so iterating stays cheap
+                if (slots.size() > 16 && count * 8 < slots.size()) {
+                    resize(slots.size() / 2);
+                }
+            }
+
+            /**
+             * @brief Call a function for every packet id and value in the table
+             *
+             * @details
+             *  The function must not add or remove values from the table.
+             *
+             * @param f the function to call with the packet id and a reference to the value
+             */
+            template <typename F>
+            void for_each(F&& f) {
+                for (auto& slot : slots) {
+                    if (slot.used) {
+                        f(slot.id, slot.value);
+                    }
+                }
+            }
+
+            /// Remove every value from the table
+            void clear() {
+                slots = std::vector<Slot>(16);
+                count = 0;
+            }
+
+            /// Returns true if there are no values in the table
+            bool empty() const {
+                return count == 0;
+            }
+
+            /// Returns the number of values in the table
+            size_t size() const {
+                return count;
+            }
+
+        private:
+            struct Slot {
+                Slot() : used(false), id(0), value() {}
+
+                /// If this slot holds a value
+                bool used;
+                /// The packet id of the value
+                uint16_t id;
+                /// The value stored for this packet id
+                T value;
+            };
+
+            size_t mask() const {
+                return slots.size() - 1;
+            }
+
+            /// Change the number of slots in the table and reinsert everything
+            void resize(size_t size) {
+                std::vector<Slot> old(size);
+                std::swap(old, slots);
+                count = 0;
+                for (auto& slot : old) {
+                    if (slot.used) {
+                        (*this)[slot.id] = std::move(slot.value);
+                    }
+                }
+            }
+
+            /// The slots of the table, always a power of two in size
+            std::vector<Slot> slots;
+            /// How many slots are in use
+            size_t count;
+        };
+
+    }  // namespace network
+}  // namespace extension
+}  // namespace NUClear
+
+#endif  // NUCLEAR_EXTENSION_NETWORK_PACKETTABLE_HPP
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_EXTENSION_NETWORK_REPLAYWINDOW_HPP
+#define NUCLEAR_EXTENSION_NETWORK_REPLAYWINDOW_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NUClear {
+namespace extension {
+    namespace network {
+
+        /**
+         * @brief Remembers which of the most recent packet ids have been seen using a sliding window of bits
+         *
+         * @details
+         *  Packet ids from a sender count up and wrap around, so the window ends at the newest id that has been seen
+         *  and covers the ids before it. Each id in the window has a bit at the position given by its low bits, so
+         *  checking and adding an id is constant time. Moving the window forward clears the bits of the ids it moves
+         *  over. Ids that are older than the window are too old to say, and are reported as not seen.
+         */
+        class ReplayWindow {
+        public:
+            /**
+             * @brief Make a window that remembers at least the given number of packet ids
+             *
+             * @param size the number of ids to remember, rounded up to a power of two between 64 and 32768
+             */
+            explicit ReplayWindow(uint16_t size = 4096) : bits(words(size), 0), newest(0), started(false) {}
+
+            /**
+             * @brief Check if a packet id has been seen
+             *
+             * @param id the packet id to look for
+             *
+             * @return true if the id is in the window and has been seen
+             */
+            bool contains(uint16_t id) const {
+                if (!started) {
+                    return false;
+                }
+
+                // Ids newer than the window haven't been seen, and ids older than it could have been anything
+                uint16_t age = uint16_t(newest - id);
+                if (age >= capacity() || int16_t(age) < 0) {
+                    return false;
+                }
+                return (bits[index(id) / 64] & (uint64_t(1) << (index(id) % 64))) != 0;
+            }
+
+            /**
+             * @brief Move the window forward to a packet id if it is newer than any before it, without recording it
+             *
+             * @details
+             *  The ids the window moves over are forgotten, so once the sender's ids wrap around the ids they reuse
+             *  don't still look seen from the last time around.
+             *
+             * @param id the packet id that arrived
+             */
+            void advance(uint16_t id) {
+
+                if (!started) {
+                    started = true;
+                    newest  = id;
+                    return;
+                }
+
+                // Move the window forward, forgetting the ids that it moves over
+                int16_t ahead = int16_t(uint16_t(id - newest));
+                if (ahead > 0) {
+                    if (size_t(ahead) >= capacity()) {
+                        std::fill(bits.begin(), bits.end(), 0);
+                    }
+                    else {
+                        for (uint16_t i = uint16_t(newest + 1); i != uint16_t(id + 1); ++i) {
+                            bits[index(i) / 64] &= ~(uint64_t(1) << (index(i) % 64));
+                        }
+                    }
+                    newest = id;
+                }
+            }
+
+            /**
+             * @brief Record that a packet id has been seen, moving the window forward if it is newer than any before it
+             *
+             * @param id the packet id that was seen
+             */
+            void insert(uint16_t id) {
+
+                advance(id);
+
+                // Ids older than the window can't be recorded
+                if (size_t(uint16_t(newest - id)) >= capacity()) {
+                    return;
+                }
+
+                bits[index(id) / 64] |= uint64_t(1) << (index(id) % 64);
+            }
+
+            /**
+             * @brief Get how many packet ids the window remembers
+             *
+             * @return the size of the window
+             */
+            size_t capacity() const {
+                return bits.size() * 64;
+            }
+
+        private:
+            /// The number of 64 bit words needed to hold a window of at least this many ids
+            static size_t words(uint16_t size) {
+                size_t n = 64;
+                while (n < size && n < 32768) {
+                    n *= 2;
+                }
+                return n / 64;
+            }
+
+            /// The position of an id's bit in the window
+            size_t index(uint16_t id) const {
+                return id & (capacity() - 1);
+            }
+
+            /// A bit for every id in the window, set if it has been seen
+            std::vector<uint64_t> bits;
+            /// The newest id that has been seen
+            uint16_t newest;
+            /// If any id has been seen yet
+            bool started;
+        };
+
+    }  // namespace network
+}  // namespace extension
+}  // namespace NUClear
+
+#endif  // NUCLEAR_EXTENSION_NETWORK_REPLAYWINDOW_HPP
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_EXTENSION_NETWORK_LZ4_HPP
+#define NUCLEAR_EXTENSION_NETWORK_LZ4_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace NUClear {
+namespace extension {
+    namespace network {
+        namespace lz4 {
+
+            /// An LZ4 block can't decompress to more than this many times its own size, as each byte added to a
+            /// length adds at most 255 to it
+            constexpr size_t MAX_EXPANSION = 255;
+
+            /**
+             * @brief Compress data into the LZ4 block format
+             *
+             * @details
+             *  This is a simple greedy compressor, it favours speed over ratio so it can keep up with the network. The
+             *  output can be read by any LZ4 block decompressor.
+             *
+             * @param data      the data to compress
+             * @param length    the number of bytes to compress
+             *
+             * @return the compressed block
+             */
+            std::vector<char> compress(const char* data, size_t length);
+
+            /**
+             * @brief Decompress an LZ4 block into a buffer that is exactly the size of the original data
+             *
+             * @param data          the compressed block
+             * @param length        the number of bytes in the compressed block
+             * @param output        where to write the decompressed data
+             * @param output_length the size of the original data
+             *
+             * @return true if the block was valid and decompressed to exactly output_length bytes
+             */
+            bool decompress(const char* data, size_t length, char* output, size_t output_length);
+
+        }  // namespace lz4
+    }      // namespace network
+}  // namespace extension
+}  // namespace NUClear
+
+#endif  // NUCLEAR_EXTENSION_NETWORK_LZ4_HPP
@@ -24,13 +24,29 @@ namespace extension {
     namespace network {
 
 #pragma pack(push, 1)
-        enum Type : uint8_t { ANNOUNCE = 1, LEAVE = 2, DATA = 3, DATA_RETRANSMISSION = 4, ACK = 5, NACK = 6 };
+        enum Type : uint8_t {
+            ANNOUNCE            = 1,
+            LEAVE               = 2,
+            DATA                = 3,
+            DATA_RETRANSMISSION = 4,
+            ACK                 = 5,
+            NACK                = 6,
+            SUBSCRIBE           = 7,
+            PARITY              = 8,
+            PROBE               = 9,
+            PROBE_ACK           = 10
+        };
+
+        enum Compression : uint8_t {
+            NONE = 0,  // The data is sent as is
+            LZ4  = 1   // The data is a 32 bit little endian uncompressed size followed by an LZ4 block
+        };
 
         struct PacketHeader {
             PacketHeader(const Type& t) : type(t) {}
 
             uint8_t header[3] = {0xE2, 0x98, 0xA2};  // Radioactive symbol in UTF8
-            uint8_t version   = 0x02;                // The NUClear networking version
+            uint8_t version   = 0x06;                // The NUClear networking version
             Type type;                               // The type of packet
         };
 
@@ -46,32 +62,92 @@ namespace extension {
 
         struct DataPacket : public PacketHeader {
             DataPacket()
-                : PacketHeader(DATA), packet_id(0), packet_no(0), packet_count(1), reliable(false), hash(), data(0) {}
-
-            uint16_t packet_id;     // A semiunique identifier for this packet group
-            uint16_t packet_no;     // What packet number this is within the group
-            uint16_t packet_count;  // How many packets there are in the group
-            bool reliable;          // If this packet is reliable and should be acked
-            uint64_t hash;          // The 64 bit hash to identify the data type
-            char data;              // The data (&data)
+                : PacketHeader(DATA)
+                , packet_id(0)
+                , packet_no(0)
+                , packet_count(1)
+                , reliable(false)
+                , compression(NONE)
+                , latest(0)
+                , hash()
+                , data(0) {}
+
+            uint16_t packet_id;       // A semiunique identifier for this packet group
+            uint32_t packet_no;       // What packet number this is within the group
+            uint32_t packet_count;    // How many packets there are in the group
+            bool reliable;            // If this packet is reliable and should be acked
+            Compression compression;  // How the data of the whole group is compressed
+            uint32_t latest;          // If not 0, only the newest data of this type matters and this is its sequence
+            uint64_t hash;            // The 64 bit hash to identify the data type
+            char data;                // The data (&data)
+        };
+
+        struct AckRange {
+            uint32_t first;  // The first packet in a run of packets that have been received
+            uint32_t last;   // The last packet in the run
         };
 
         struct ACKPacket : public PacketHeader {
-            ACKPacket() : PacketHeader(ACK), packet_id(0), packet_no(0), packet_count(1), packets(0) {}
+            ACKPacket()
+                : PacketHeader(ACK), packet_id(0), packet_no(0), packet_count(1), cumulative(0), range_count(0), ranges() {}
 
             uint16_t packet_id;     // The packet group identifier we are acknowledging
-            uint16_t packet_no;     // The index of the packet we are acknowledging
-            uint16_t packet_count;  // How many packets there are in the group
-            uint8_t packets;        // A bitset of which packets we have received (&packets)
+            uint32_t packet_no;     // The index of the packet we are acknowledging
+            uint32_t packet_count;  // How many packets there are in the group
+            uint32_t cumulative;    // Every packet before this one has been received
+            uint8_t range_count;    // How many ranges of received packets follow
+            AckRange ranges;        // Runs of packets received after the cumulative point, newest first (&ranges)
         };
 
         struct NACKPacket : public PacketHeader {
 
-            NACKPacket() : PacketHeader(NACK), packet_id(0), packet_count(1), packets(0) {}
+            NACKPacket() : PacketHeader(NACK), packet_id(0), packet_count(1), cumulative(0), range_count(0), ranges() {}
 
-            uint16_t packet_id;     // The packet group identifier we are acknowledging
-            uint16_t packet_count;  // How many packets there are in the group
-            uint8_t packets;        // A bitset of which packets we have received (&packets)
+            uint16_t packet_id;     // The packet group whose acknowledged packets have been lost and must be resent
+            uint32_t packet_count;  // How many packets there are in the group
+            uint32_t cumulative;    // Every packet before this one is still held, the rest must be resent
+            uint8_t range_count;    // How many ranges of packets after the cumulative point are still held
+            AckRange ranges;        // Runs of packets still held after the cumulative point, newest first (&ranges)
+        };
+
+        struct SubscribePacket : public PacketHeader {
+            SubscribePacket() : PacketHeader(SUBSCRIBE), hash_count(0), hashes(0) {}
+
+            uint32_t hash_count;  // How many type hashes this node wants to receive
+            uint64_t hashes;      // The sorted hashes of the types this node wants to receive (&hashes)
+        };
+
+        struct ProbePacket : public PacketHeader {
+            ProbePacket(const Type& t = PROBE) : PacketHeader(t), mtu(0), padding(0) {}
+
+            uint16_t mtu;  // The path MTU this probe tests, or for an ack the size of the probe that arrived
+            char padding;  // Zeros to make the probe as big as the MTU it tests, not sent in acks (&padding)
+        };
+
+        struct ParityPacket : public PacketHeader {
+            ParityPacket()
+                : PacketHeader(PARITY)
+                , packet_id(0)
+                , block_no(0)
+                , block_size(0)
+                , packet_count(1)
+                , fragment_size(0)
+                , last_size(0)
+                , compression(NONE)
+                , latest(0)
+                , hash()
+                , data(0) {}
+
+            uint16_t packet_id;       // The packet group this parity is for
+            uint32_t block_no;        // Which block of fragments in the group this is the parity of
+            uint16_t block_size;      // How many fragments are in each block
+            uint32_t packet_count;    // How many data packets there are in the group
+            uint16_t fragment_size;   // The size of every fragment but the last
+            uint16_t last_size;       // The size of the last fragment
+            Compression compression;  // How the data of the whole group is compressed
+            uint32_t latest;          // The latest only sequence of the group, 0 if it isn't latest only
+            uint64_t hash;            // The 64 bit hash to identify the data type
+            char data;  // The XOR of the fragments in the block, each padded with zeros to fragment_size (&data)
         };
 
 #pragma pack(pop)
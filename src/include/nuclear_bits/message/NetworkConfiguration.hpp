@@ -24,15 +24,63 @@ namespace message {
 
     struct NetworkConfiguration {
 
-        NetworkConfiguration() : name(""), announce_address(""), announce_port(0), mtu(1500) {}
+        NetworkConfiguration()
+            : name("")
+            , announce_address("")
+            , announce_port(0)
+            , mtu(1500)
+            , receive_sockets(1)
+            , compression_threshold(0)
+            , fec_block_size(0)
+            , assembler_memory_per_target(128 * 1024 * 1024)
+            , assembler_memory_total(512 * 1024 * 1024)
+            , duplicate_window(4096)
+            , max_mtu(9000) {}
 
-        NetworkConfiguration(const std::string& name, const std::string& address, uint16_t port, uint16_t mtu = 1500)
-            : name(name), announce_address(address), announce_port(port), mtu(mtu) {}
+        NetworkConfiguration(const std::string& name,
+                             const std::string& address,
+                             uint16_t port,
+                             uint16_t mtu                       = 1500,
+                             uint16_t receive_sockets           = 1,
+                             uint32_t compression_threshold     = 0,
+                             uint16_t fec_block_size            = 0,
+                             size_t assembler_memory_per_target = 128 * 1024 * 1024,
+                             size_t assembler_memory_total      = 512 * 1024 * 1024,
+                             uint16_t duplicate_window          = 4096,
+                             uint16_t max_mtu                   = 9000)
+            : name(name)
+            , announce_address(address)
+            , announce_port(port)
+            , mtu(mtu)
+            , receive_sockets(receive_sockets)
+            , compression_threshold(compression_threshold)
+            , fec_block_size(fec_block_size)
+            , assembler_memory_per_target(assembler_memory_per_target)
+            , assembler_memory_total(assembler_memory_total)
+            , duplicate_window(duplicate_window)
+            , max_mtu(max_mtu) {}
 
         std::string name;
         std::string announce_address;
         uint16_t announce_port;
         uint16_t mtu;
+        /// How many sockets share our data port, each is read by its own reaction so packets are handled in parallel
+        uint16_t receive_sockets;
+        /// Messages this many bytes or bigger are compressed before they are sent, 0 to only compress when asked
+        uint32_t compression_threshold;
+        /// Unreliable messages get a parity packet for every this many fragments so any one of them can be lost, 0 to
+        /// disable. Smaller blocks survive more loss but use more bandwidth
+        uint16_t fec_block_size;
+        /// The most memory that partly received messages from a single node can use before the oldest are dropped
+        size_t assembler_memory_per_target;
+        /// The most memory that partly received messages from all nodes can use before the oldest are dropped
+        size_t assembler_memory_total;
+        /// How many of the most recent messages from each node we remember receiving so repeats of them are ignored.
+        /// Rounded up to a power of two up to 32768, it should be bigger than the number of reliable messages in flight
+        uint16_t duplicate_window;
+        /// The largest path mtu to look for with each node, which then decides how big the fragments sent to that
+        /// node are so it doesn't have to be split by the network. 0 to always use mtu
+        uint16_t max_mtu;
     };
 
 }  // namespace message
@@ -38,6 +38,25 @@ namespace message {
         util::network::sock_t address;
     };
 
+    /**
+     * @brief Emitted as a large message sent over the network makes progress
+     *
+     * @details
+     *  Messages that need at least 1024 packets are reported each time another 64th of them has been acknowledged by
+     *  the node they are being sent to, or received from the node that is sending them. The hash is the
+     *  Serialise<T>::hash() of the message's type and the counts are in packets.
+     */
+    struct NetworkProgress {
+        NetworkProgress() : name(""), address(), hash(0), sending(false), done(0), total(0) {}
+
+        std::string name;
+        util::network::sock_t address;
+        uint64_t hash;
+        bool sending;
+        uint32_t done;
+        uint32_t total;
+    };
+
 }  // namespace message
 }  // namespace NUClear
 
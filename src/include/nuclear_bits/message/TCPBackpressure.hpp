@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NUCLEAR_MESSAGE_TCPBACKPRESSURE_HPP
+#define NUCLEAR_MESSAGE_TCPBACKPRESSURE_HPP
+
+#include "nuclear_bits/util/platform.hpp"
+
+namespace NUClear {
+namespace message {
+
+    /**
+     * @brief Emitted when the data queued for a TCP connection crosses its high water mark.
+     *
+     * @details
+     *  When congested is true more than the high water mark is waiting to be written to the connection and producers
+     *  should hold off sending to it. Once the queue has drained to half of the high water mark another message is
+     *  emitted with congested set to false.
+     */
+    struct TCPBackpressure {
+        TCPBackpressure() : fd(INVALID_SOCKET), pending(0), congested(false) {}
+        TCPBackpressure(fd_t fd, size_t pending, bool congested) : fd(fd), pending(pending), congested(congested) {}
+
+        /// The file descriptor of the connection
+        fd_t fd;
+        /// The number of bytes that are waiting to be written
+        size_t pending;
+        /// If the connection is over its high water mark
+        bool congested;
+    };
+
+}  // namespace message
+}  // namespace NUClear
+
+#endif  // NUCLEAR_MESSAGE_TCPBACKPRESSURE_HPP
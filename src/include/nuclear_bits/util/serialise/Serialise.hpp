@@ -55,7 +55,7 @@ namespace util {
             static inline T deserialise(const std::vector<char>& in) {
 
                 // Copy the data into an object of the correct type
-                T ret = *reinterpret_cast<T*>(in.data());
+                T ret = *reinterpret_cast<const T*>(in.data());
                 return ret;
             }
 
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <map>
+
+#include "nuclear"
+
+namespace {
+
+constexpr in_port_t PORT = 40020;
+
+const std::vector<std::string> TEST_STRINGS = {
+    "Short unreliable message",
+    "Short reliable message",
+    std::string(std::numeric_limits<uint16_t>::max(), 'u'),
+    std::string(std::numeric_limits<uint16_t>::max(), 'r'),
+    std::string(std::numeric_limits<uint16_t>::max(), 'c'),
+    std::string(2 << 20, 'b'),
+};
+
+// State where only the newest matters
+struct Pose {
+    uint32_t sequence;
+};
+constexpr uint32_t POSE_COUNT = 10;
+
+std::vector<std::string> received;
+std::vector<std::string> viewed;
+std::map<std::pair<size_t, char>, const std::string*> deserialised;
+size_t shared = 0;
+std::vector<uint32_t> poses;
+std::vector<uint32_t> viewed_poses;
+std::vector<std::string> joined;
+std::vector<NUClear::message::NetworkProgress> progress;
+
+class TestReactor : public NUClear::Reactor {
+public:
+    TestReactor(std::unique_ptr<NUClear::Environment> environment) : Reactor(std::move(environment)) {
+
+        // When we find ourself on the network send ourself some messages
+        on<Trigger<NUClear::message::NetworkJoin>>().then([this](const NUClear::message::NetworkJoin& join) {
+            joined.push_back(join.name);
+
+            emit<Scope::NETWORK>(std::make_unique<std::string>(TEST_STRINGS[0]), join.name, false);
+            emit<Scope::NETWORK>(std::make_unique<std::string>(TEST_STRINGS[1]), join.name, true);
+            emit<Scope::NETWORK>(std::make_unique<std::string>(TEST_STRINGS[2]), join.name, false);
+            emit<Scope::NETWORK>(std::make_unique<std::string>(TEST_STRINGS[3]), join.name, true);
+            emit<Scope::NETWORK>(std::make_unique<std::string>(TEST_STRINGS[4]), join.name, true, true);
+            emit<Scope::NETWORK>(std::make_unique<std::string>(TEST_STRINGS[5]), join.name, true);
+
+            for (uint32_t i = 1; i <= POSE_COUNT; ++i) {
+                emit<Scope::NETWORK>(std::make_unique<Pose>(Pose{i}), join.name, true, false, true);
+            }
+        });
+
+        on<Network<std::string>, Sync<TestReactor>>().then(
+            [this](const NetworkSource& source, const std::string& s) {
+                REQUIRE(source.name == "nuclear_network_test");
+
+                // It must have arrived before we ran, but not so long ago that it is clearly wrong
+                auto age = NUClear::clock::now() - source.received;
+                REQUIRE(age >= NUClear::clock::duration(0));
+                REQUIRE(age < std::chrono::seconds(5));
+                received.push_back(s);
+                check_shared(s);
+                check_finished();
+            });
+
+        on<Network<std::string>, Sync<TestReactor>>().then([this](const std::string& s) {
+            check_shared(s);
+            check_finished();
+        });
+
+        on<Network<Pose>, Sync<TestReactor>>().then([this](const Pose& pose) {
+            poses.push_back(pose.sequence);
+            check_finished();
+        });
+
+        // The same messages used where they were received
+        on<Network<NetworkView<std::string>>, Sync<TestReactor>>().then(
+            [this](const NetworkSource& source, const NetworkView<std::string>& view) {
+                REQUIRE(source.name == "nuclear_network_test");
+                REQUIRE(reinterpret_cast<uintptr_t>(view.data()) % alignof(std::max_align_t) == 0);
+                viewed.emplace_back(view.begin(), view.end());
+                check_finished();
+            });
+
+        on<Network<NetworkView<Pose>>, Sync<TestReactor>>().then([this](const Pose& pose) {
+            viewed_poses.push_back(pose.sequence);
+            check_finished();
+        });
+
+        on<Trigger<NUClear::message::NetworkProgress>, Sync<TestReactor>>().then(
+            [this](const NUClear::message::NetworkProgress& p) {
+                progress.push_back(p);
+                check_finished();
+            });
+
+        on<Startup>().then([this] {
+
+            // Announce to ourself over loopback so we connect to ourself
+            auto net_config              = std::make_unique<NUClear::message::NetworkConfiguration>();
+            net_config->name             = "nuclear_network_test";
+            net_config->announce_address = "127.0.0.1";
+            net_config->announce_port    = PORT;
+            net_config->fec_block_size   = 8;
+            emit<Scope::DIRECT>(net_config);
+        });
+    }
+
+private:
+    static bool transferred(bool sending) {
+        return std::any_of(progress.begin(), progress.end(), [&](const NUClear::message::NetworkProgress& p) {
+            return p.sending == sending && p.done == p.total;
+        });
+    }
+
+    // Every reaction to a message must be given the one object it was deserialised into
+    static void check_shared(const std::string& s) {
+        auto key = std::make_pair(s.size(), s.front());
+        auto it  = deserialised.find(key);
+        if (it == deserialised.end()) {
+            deserialised.emplace(key, &s);
+        }
+        else {
+            REQUIRE(it->second == &s);
+            ++shared;
+        }
+    }
+
+    void check_finished() {
+        if (received.size() == TEST_STRINGS.size() && viewed.size() == TEST_STRINGS.size()
+            && shared == TEST_STRINGS.size() && !poses.empty()
+            && poses.back() == POSE_COUNT && !viewed_poses.empty() && viewed_poses.back() == POSE_COUNT
+            && transferred(true) && transferred(false)) {
+            powerplant.shutdown();
+        }
+    }
+};
+}  // namespace
+
+TEST_CASE("Testing sending and receiving messages over the NUClear network", "[api][network][nuclearnet]") {
+
+    NUClear::PowerPlant::Configuration config;
+    config.thread_count = 1;
+    NUClear::PowerPlant plant(config);
+    plant.install<TestReactor>();
+
+    plant.start();
+
+    // Messages may be run out of order so compare them sorted
+    std::vector<std::string> expected = TEST_STRINGS;
+    std::sort(expected.begin(), expected.end());
+    std::sort(received.begin(), received.end());
+    std::sort(viewed.begin(), viewed.end());
+
+    REQUIRE(joined == std::vector<std::string>({"nuclear_network_test"}));
+    REQUIRE(received == expected);
+    REQUIRE(viewed == expected);
+    REQUIRE(shared == TEST_STRINGS.size());
+
+    // Some poses may have been skipped, but never delivered late or twice, and the newest must arrive
+    REQUIRE(!poses.empty());
+    REQUIRE(std::is_sorted(poses.begin(), poses.end()));
+    REQUIRE(std::adjacent_find(poses.begin(), poses.end()) == poses.end());
+    REQUIRE(poses.back() == POSE_COUNT);
+    REQUIRE(viewed_poses == poses);
+
+    // Only the big message is a bulk transfer, and its progress only moves forward
+    for (bool sending : {true, false}) {
+        uint32_t done = 0;
+        for (const auto& p : progress) {
+            if (p.sending == sending) {
+                REQUIRE(p.name == "nuclear_network_test");
+                REQUIRE(p.hash == NUClear::util::serialise::Serialise<std::string>::hash());
+                REQUIRE(p.done > done);
+                REQUIRE(p.done <= p.total);
+                done = p.done;
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include "nuclear"
+
+namespace {
+
+constexpr in_port_t PORT = 40060;
+
+std::vector<std::string> first_received;
+std::vector<std::string> second_received;
+
+class TestReactor : public NUClear::Reactor {
+public:
+    TestReactor(std::unique_ptr<NUClear::Environment> environment) : Reactor(std::move(environment)) {
+
+        // When we find ourself on the network send ourself a message
+        on<Trigger<NUClear::message::NetworkJoin>>().then([this](const NUClear::message::NetworkJoin& join) {
+            emit<Scope::NETWORK>(std::make_unique<std::string>("first"), join.name, true);
+        });
+
+        first = on<Network<std::string>, Sync<TestReactor>>().then([this](const std::string& s) {
+            first_received.push_back(s);
+
+            // Replace ourself with a new reaction, binding it first so we never stop wanting strings
+            on<Network<std::string>, Sync<TestReactor>>().then([this](const std::string& s) {
+                second_received.push_back(s);
+                powerplant.shutdown();
+            });
+            first.unbind();
+
+            // Only the new reaction should get this
+            emit<Scope::NETWORK>(std::make_unique<std::string>("second"), "nuclear_rebind_test", true);
+        });
+
+        on<Startup>().then([this] {
+
+            // Announce to ourself over loopback so we connect to ourself
+            auto net_config              = std::make_unique<NUClear::message::NetworkConfiguration>();
+            net_config->name             = "nuclear_rebind_test";
+            net_config->announce_address = "127.0.0.1";
+            net_config->announce_port    = PORT;
+            emit<Scope::DIRECT>(net_config);
+        });
+    }
+
+private:
+    ReactionHandle first;
+};
+}  // namespace
+
+TEST_CASE("Testing changing which reactions receive network messages", "[api][network][nuclearnet][rebind]") {
+
+    NUClear::PowerPlant::Configuration config;
+    config.thread_count = 1;
+    NUClear::PowerPlant plant(config);
+    plant.install<TestReactor>();
+
+    plant.start();
+
+    REQUIRE(first_received == std::vector<std::string>({"first"}));
+    REQUIRE(second_received == std::vector<std::string>({"second"}));
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include "nuclear"
+
+// Shared memory transport is built on unix domain sockets which are not available on windows
+#ifndef _WIN32
+
+namespace {
+
+struct Image {
+    uint32_t width;
+    uint32_t height;
+    uint8_t data[64 * 64];
+};
+
+std::shared_ptr<const Image> image_received;
+std::string text_received;
+std::string other_channel_received;
+std::vector<uint16_t> samples_received;
+std::vector<uint16_t> samples_viewed;
+bool samples_in_place = false;
+uint32_t image_viewed_width = 0;
+
+struct Message {};
+
+class TestReactor : public NUClear::Reactor {
+public:
+    TestReactor(std::unique_ptr<NUClear::Environment> environment) : Reactor(std::move(environment)) {
+
+        on<SharedMemory<Image>>().then([this](std::shared_ptr<const Image> image) {
+            image_received = image;
+            check_finished();
+        });
+
+        on<SharedMemory<std::string>>("text").then([this](const std::string& text) {
+            text_received = text;
+            check_finished();
+        });
+
+        on<SharedMemory<std::string>>("other").then([this](const std::string& text) {
+            other_channel_received = text;
+            check_finished();
+        });
+
+        on<SharedMemory<std::vector<uint16_t>>>("samples").then([this](const std::vector<uint16_t>& samples) {
+            samples_received = samples;
+            check_finished();
+        });
+
+        // Views are given the data where the sender wrote it rather than a copy of it
+        on<SharedMemory<NetworkView<std::vector<uint16_t>>>>("samples")
+            .then([this](const NetworkView<std::vector<uint16_t>>& samples) {
+                samples_viewed.assign(samples.begin(), samples.end());
+                samples_in_place = samples.data() != nullptr && uintptr_t(samples.data()) % 4096 == 0;
+                check_finished();
+            });
+
+        on<SharedMemory<NetworkView<Image>>>().then([this](const NetworkView<Image>& image) {
+            image_viewed_width = image->width;
+            check_finished();
+        });
+
+        on<Trigger<Message>>().then([this] {
+
+            auto image    = std::make_unique<Image>();
+            image->width  = 64;
+            image->height = 64;
+            for (size_t i = 0; i < sizeof(image->data); ++i) {
+                image->data[i] = uint8_t(i);
+            }
+            emit<Scope::SHM>(image);
+
+            emit<Scope::SHM>(std::make_unique<std::string>("Hello Shared Memory"), "text");
+
+            auto samples = std::make_unique<std::vector<uint16_t>>();
+            for (uint16_t i = 0; i < 1000; ++i) {
+                samples->push_back(uint16_t(i * 3));
+            }
+            emit<Scope::SHM>(samples, "samples");
+        });
+
+        on<Startup>().then([this] {
+
+            // Emit a message just so it will be when everything is running
+            emit(std::make_unique<Message>());
+        });
+    }
+
+    void check_finished() {
+        if (image_received && !text_received.empty() && !samples_received.empty() && !samples_viewed.empty()
+            && image_viewed_width != 0) {
+            powerplant.shutdown();
+        }
+    }
+};
+}  // namespace
+
+TEST_CASE("Testing emitting data through shared memory", "[api][shm]") {
+
+    NUClear::PowerPlant::Configuration config;
+    config.thread_count = 1;
+    NUClear::PowerPlant plant(config);
+    plant.install<TestReactor>();
+
+    plant.start();
+
+    REQUIRE(image_received);
+    REQUIRE(image_received->width == 64);
+    REQUIRE(image_received->height == 64);
+    bool matches = true;
+    for (size_t i = 0; i < sizeof(image_received->data); ++i) {
+        matches &= image_received->data[i] == uint8_t(i);
+    }
+    REQUIRE(matches);
+
+    REQUIRE(text_received == "Hello Shared Memory");
+    REQUIRE(other_channel_received.empty());
+
+    std::vector<uint16_t> expected;
+    for (uint16_t i = 0; i < 1000; ++i) {
+        expected.push_back(uint16_t(i * 3));
+    }
+    REQUIRE(samples_received == expected);
+    REQUIRE(samples_viewed == expected);
+
+    // A view points at the start of the mapped shared memory
+    REQUIRE(samples_in_place);
+    REQUIRE(image_viewed_width == 64);
+}
+
+#endif  // _WIN32
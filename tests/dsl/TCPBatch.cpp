@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <memory>
+
+#include "nuclear"
+
+namespace {
+
+constexpr int CLIENT_COUNT = 32;
+
+int connections_accepted = 0;
+size_t largest_batch     = 0;
+
+std::vector<std::unique_ptr<NUClear::util::FileDescriptor>> clients;
+
+struct Message {};
+
+class TestReactor : public NUClear::Reactor {
+public:
+    TestReactor(std::unique_ptr<NUClear::Environment> environment) : Reactor(std::move(environment)) {
+
+        // Bind to an unknown port with several listeners sharing it
+        int bound_port;
+        std::tie(std::ignore, bound_port, std::ignore) =
+            on<TCP::Batch>(0, 4).then([this](const TCP::Connections& connections) {
+
+                largest_batch = std::max(largest_batch, connections.size());
+
+                for (const auto& connection : connections) {
+
+                    // The connection must be valid and non blocking
+                    REQUIRE(connection.fd > 0);
+                    REQUIRE((::fcntl(connection.fd, F_GETFL, 0) & O_NONBLOCK) != 0);
+                    REQUIRE(connection.remote.address == INADDR_LOOPBACK);
+
+                    close(connection.fd);
+                    ++connections_accepted;
+                }
+
+                if (connections_accepted == CLIENT_COUNT) {
+                    powerplant.shutdown();
+                }
+            });
+
+        // Connect a burst of clients all at once
+        on<Trigger<Message>>().then([this, bound_port] {
+
+            // Our address to our local connection
+            sockaddr_in address{};
+            address.sin_family      = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port        = htons(bound_port);
+
+            for (int i = 0; i < CLIENT_COUNT; ++i) {
+                clients.push_back(
+                    std::make_unique<NUClear::util::FileDescriptor>(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)));
+                REQUIRE(::connect(clients.back()->fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+            }
+        });
+
+        on<Startup>().then([this] {
+
+            // Emit a message just so it will be when everything is running
+            emit(std::make_unique<Message>());
+        });
+    }
+};
+}  // namespace
+
+TEST_CASE("Testing accepting batches of TCP connections from shared listeners", "[api][network][tcp][batch]") {
+
+    NUClear::PowerPlant::Configuration config;
+    config.thread_count = 1;
+    NUClear::PowerPlant plant(config);
+    plant.install<TestReactor>();
+
+    plant.start();
+
+    // Close our clients
+    clients.clear();
+
+    // Our only thread was busy connecting every client, so they must have been waiting to be accepted together
+    REQUIRE(connections_accepted == CLIENT_COUNT);
+    REQUIRE(largest_batch > 1);
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "nuclear"
+
+namespace {
+
+constexpr unsigned short PORT = 40010;
+
+const std::vector<std::string> TEST_STRINGS = {"Hello", "TCP", "Stream", "World!", ""};
+
+std::vector<std::string> length_frames;
+std::vector<std::string> delimited_frames;
+bool oversized_delivered = false;
+bool oversized_closed    = false;
+
+struct Message {};
+
+NUClear::fd_t open_connection(in_port_t port) {
+
+    // Open a random socket
+    NUClear::util::FileDescriptor fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+    // Our address to our local connection
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port        = htons(port);
+
+    // Connect to ourself
+    ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+    return fd.release();
+}
+
+void send_split(in_port_t port, const std::string& data) {
+
+    NUClear::util::FileDescriptor fd = open_connection(port);
+
+    // Set linger so we ensure sending all data
+    linger l{1, 2};
+    REQUIRE(setsockopt(fd, SOL_SOCKET, SO_LINGER, reinterpret_cast<char*>(&l), sizeof(linger)) == 0);
+
+    // Send the first few bytes on their own so the first frame arrives in pieces
+    ssize_t sent = ::send(fd, data.data(), 3, 0);
+    REQUIRE(sent == 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // Send the rest of the frames in one go so they arrive together
+    sent = ::send(fd, data.data() + 3, data.size() - 3, 0);
+    REQUIRE(sent == ssize_t(data.size() - 3));
+}
+
+class TestReactor : public NUClear::Reactor {
+public:
+    TestReactor(std::unique_ptr<NUClear::Environment> environment) : Reactor(std::move(environment)) {
+
+        // Bind to a known port using length prefixed frames
+        on<TCP::Stream<TCP::LengthPrefixed<uint32_t>>>(PORT).then([this](const TCP::Frame& frame) {
+            length_frames.emplace_back(frame.payload.get(), frame.length);
+            check_finished();
+        });
+
+        // Bind to an unknown port using newline delimited frames
+        int bound_port;
+        std::tie(std::ignore, bound_port, std::ignore) =
+            on<TCP::Stream<TCP::Delimited<'\n'>>>().then([this](const TCP::Frame& frame) {
+                delimited_frames.emplace_back(frame.payload.get(), frame.length);
+                check_finished();
+            });
+
+        // Bind to an unknown port that only accepts small frames
+        int small_port;
+        std::tie(std::ignore, small_port, std::ignore) =
+            on<TCP::Stream<TCP::LengthPrefixed<uint32_t>>>(0, 64).then([](const TCP::Frame&) {
+                oversized_delivered = true;
+            });
+
+        // Send our frames to both ports
+        on<Trigger<Message>>().then([this, bound_port, small_port] {
+
+            std::string length_data;
+            std::string delimited_data;
+            for (const auto& s : TEST_STRINGS) {
+                uint32_t length = htonl(uint32_t(s.size()));
+                length_data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                length_data.append(s);
+
+                delimited_data.append(s);
+                delimited_data.push_back('\n');
+            }
+
+            send_split(PORT, length_data);
+            send_split(bound_port, delimited_data);
+
+            // Claim a frame far larger than the small port allows, it should hang up on us without waiting for it
+            oversized       = std::make_unique<NUClear::util::FileDescriptor>(open_connection(small_port));
+            uint32_t length = htonl(uint32_t(1) << 30);
+            REQUIRE(::send(oversized->fd, reinterpret_cast<const char*>(&length), sizeof(length), 0)
+                    == sizeof(length));
+
+            oversized_handle = on<IO>(oversized->fd, IO::READ | IO::CLOSE).then([this] {
+                char c;
+                if (::recv(oversized->fd, &c, 1, MSG_DONTWAIT) <= 0) {
+                    oversized_closed = true;
+                    oversized_handle.unbind();
+                    check_finished();
+                }
+            });
+        });
+
+        on<Startup>().then([this] {
+
+            // Emit a message just so it will be when everything is running
+            emit(std::make_unique<Message>());
+        });
+    }
+
+    void check_finished() {
+        if (length_frames.size() == TEST_STRINGS.size() && delimited_frames.size() == TEST_STRINGS.size()
+            && oversized_closed) {
+            powerplant.shutdown();
+        }
+    }
+
+    std::unique_ptr<NUClear::util::FileDescriptor> oversized;
+    ReactionHandle oversized_handle;
+};
+}  // namespace
+
+TEST_CASE("Testing reading framed data from TCP streams", "[api][network][tcp][stream]") {
+
+    NUClear::PowerPlant::Configuration config;
+    config.thread_count = 1;
+    NUClear::PowerPlant plant(config);
+    plant.install<TestReactor>();
+
+    plant.start();
+
+    // Frames may be run out of order so compare them sorted
+    std::vector<std::string> expected = TEST_STRINGS;
+    std::sort(expected.begin(), expected.end());
+    std::sort(length_frames.begin(), length_frames.end());
+    std::sort(delimited_frames.begin(), delimited_frames.end());
+
+    REQUIRE(length_frames == expected);
+    REQUIRE(delimited_frames == expected);
+    REQUIRE(oversized_closed);
+    REQUIRE_FALSE(oversized_delivered);
+}
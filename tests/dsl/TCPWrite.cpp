@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "nuclear"
+
+namespace {
+
+constexpr size_t CHUNK_SIZE      = 2 * 1024 * 1024;
+constexpr size_t CHUNK_COUNT     = 4;
+constexpr size_t HIGH_WATER_MARK = 1024 * 1024;
+
+std::vector<char> received;
+std::vector<bool> backpressure;
+std::thread reader;
+
+struct Message {};
+
+class TestReactor : public NUClear::Reactor {
+public:
+    TestReactor(std::unique_ptr<NUClear::Environment> environment) : Reactor(std::move(environment)) {
+
+        // Bind to an unknown port and write a lot more data than the socket can hold to whoever connects
+        int bound_port;
+        std::tie(std::ignore, bound_port, std::ignore) = on<TCP>().then([this](const TCP::Connection& connection) {
+            for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+                emit<Scope::TCP>(std::make_unique<std::vector<char>>(CHUNK_SIZE, char('a' + i)),
+                                 connection.fd,
+                                 HIGH_WATER_MARK);
+            }
+        });
+
+        on<Trigger<NUClear::message::TCPBackpressure>>().then(
+            [](const NUClear::message::TCPBackpressure& state) { backpressure.push_back(state.congested); });
+
+        // Connect to ourself and read everything slowly from another thread
+        on<Trigger<Message>>().then([this, bound_port] {
+
+            reader = std::thread([this, bound_port] {
+
+                NUClear::util::FileDescriptor fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+                // Our address to our local connection
+                sockaddr_in address{};
+                address.sin_family      = AF_INET;
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                address.sin_port        = htons(bound_port);
+
+                ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+                // Give the writer time to fill the socket up
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+                std::vector<char> buffer(65536);
+                while (received.size() < CHUNK_SIZE * CHUNK_COUNT) {
+                    ssize_t r = ::recv(fd, buffer.data(), buffer.size(), 0);
+                    if (r <= 0) {
+                        break;
+                    }
+                    received.insert(received.end(), buffer.begin(), buffer.begin() + r);
+                }
+
+                powerplant.shutdown();
+            });
+        });
+
+        on<Startup>().then([this] {
+
+            // Emit a message just so it will be when everything is running
+            emit(std::make_unique<Message>());
+        });
+    }
+};
+}  // namespace
+
+TEST_CASE("Testing writing to TCP connections without blocking", "[api][network][tcp][write]") {
+
+    NUClear::PowerPlant::Configuration config;
+    config.thread_count = 1;
+    NUClear::PowerPlant plant(config);
+    plant.install<TestReactor>();
+
+    plant.start();
+    reader.join();
+
+    // All the data should have arrived in the order it was emitted
+    REQUIRE(received.size() == CHUNK_SIZE * CHUNK_COUNT);
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        REQUIRE(std::all_of(received.begin() + i * CHUNK_SIZE,
+                            received.begin() + (i + 1) * CHUNK_SIZE,
+                            [i](const char& c) { return c == char('a' + i); }));
+    }
+
+    // We should have been told about the backpressure and then told it was released
+    REQUIRE(backpressure == std::vector<bool>({true, false}));
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include "nuclear"
+
+// Unix domain sockets are not available on windows
+#ifndef _WIN32
+
+namespace {
+
+const std::string DATAGRAM_PATH = "/tmp/nuclear_test_unix_datagram.sock";
+const std::string STREAM_PATH   = "@nuclear_test_unix_stream";
+
+const std::string DATAGRAM_MESSAGE = "Hello Datagram";
+const std::string PIPE_MESSAGE     = "Hello through a passed file descriptor";
+const std::string STREAM_MESSAGE   = "Hello Stream";
+
+std::string datagram_received;
+std::string pipe_received;
+std::string stream_received;
+std::string stream_path;
+
+int client = -1;
+
+struct Message {};
+
+class TestReactor : public NUClear::Reactor {
+public:
+    TestReactor(std::unique_ptr<NUClear::Environment> environment) : Reactor(std::move(environment)) {
+
+        on<UnixSocket::Datagram>(DATAGRAM_PATH).then([this](const UnixSocket::Packet& packet) {
+            datagram_received = std::string(packet.payload.begin(), packet.payload.end());
+
+            // Read the data that was put in the pipe we were sent
+            REQUIRE(packet.fds.size() == 1);
+            char buffer[256];
+            ssize_t len = ::read(packet.fds.front()->fd, buffer, sizeof(buffer));
+            REQUIRE(len == ssize_t(PIPE_MESSAGE.size()));
+            pipe_received = std::string(buffer, len);
+
+            check_finished();
+        });
+
+        on<UnixSocket>(STREAM_PATH).then([this](const UnixSocket::Connection& connection) {
+            stream_path = connection.path;
+
+            NUClear::fd_t fd = connection.fd;
+            on<IO>(fd, IO::READ).then([this, fd] {
+                UnixSocket::Packet packet = UnixSocket::receive(fd);
+                if (packet) {
+                    stream_received = std::string(packet.payload.begin(), packet.payload.end());
+                }
+                check_finished();
+            });
+        });
+
+        on<Trigger<Message>>().then([this] {
+
+            // Send a pipe to the datagram socket along with our message
+            int pipe_fds[2];
+            REQUIRE(::pipe(pipe_fds) == 0);
+            NUClear::util::FileDescriptor read_end  = pipe_fds[0];
+            NUClear::util::FileDescriptor write_end = pipe_fds[1];
+            REQUIRE(::write(write_end, PIPE_MESSAGE.data(), PIPE_MESSAGE.size()) == ssize_t(PIPE_MESSAGE.size()));
+
+            emit<Scope::UNIX>(std::make_unique<std::string>(DATAGRAM_MESSAGE),
+                              DATAGRAM_PATH,
+                              std::vector<NUClear::fd_t>({read_end}));
+
+            // Connect to our stream socket and send a message down it
+            client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un address;
+            socklen_t len = UnixSocket::address(STREAM_PATH, address);
+            REQUIRE(::connect(client, reinterpret_cast<sockaddr*>(&address), len) == 0);
+            UnixSocket::send(client, STREAM_MESSAGE.data(), STREAM_MESSAGE.size());
+        });
+
+        on<Startup>().then([this] {
+
+            // Emit a message just so it will be when everything is running
+            emit(std::make_unique<Message>());
+        });
+    }
+
+    void check_finished() {
+        if (!datagram_received.empty() && !stream_received.empty()) {
+            powerplant.shutdown();
+        }
+    }
+};
+}  // namespace
+
+TEST_CASE("Testing sending and receiving on unix domain sockets", "[api][unix]") {
+
+    NUClear::PowerPlant::Configuration config;
+    config.thread_count = 1;
+    NUClear::PowerPlant plant(config);
+    plant.install<TestReactor>();
+
+    plant.start();
+
+    ::close(client);
+
+    REQUIRE(datagram_received == DATAGRAM_MESSAGE);
+    REQUIRE(pipe_received == PIPE_MESSAGE);
+    REQUIRE(stream_received == STREAM_MESSAGE);
+    REQUIRE(stream_path == STREAM_PATH);
+}
+
+#endif  // _WIN32
@@ -0,0 +1,842 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "nuclear"
+#include "nuclear_bits/extension/network/NUClearNetwork.hpp"
+
+namespace {
+
+using NUClear::extension::network::NUClearNetwork;
+using NUClear::extension::network::PacketHeader;
+using NUClear::extension::network::AnnouncePacket;
+using NUClear::extension::network::DataPacket;
+using NUClear::extension::network::ACKPacket;
+using NUClear::extension::network::NACKPacket;
+using NUClear::extension::network::ParityPacket;
+using NUClear::extension::network::SubscribePacket;
+using NUClear::extension::network::Type;
+
+constexpr uint64_t HASH = 0x4E55436C656172;
+
+/// A NUClearNetwork on loopback that processes each of its sockets on its own thread like NetworkController does
+class Node {
+public:
+    Node(const std::string& name,
+         in_port_t port,
+         uint16_t receive_sockets = 1,
+         uint16_t max_mtu         = 0,
+         bool housekeeping        = true) {
+
+        network.set_packet_callback([this](const NUClearNetwork::NetworkTarget&,
+                                           const uint64_t& hash,
+                                           const bool&,
+                                           const std::chrono::steady_clock::time_point&,
+                                           std::vector<char>&& data) {
+            std::lock_guard<std::mutex> lock(mutex);
+            received.emplace_back(hash, std::string(data.begin(), data.end()));
+            changed.notify_all();
+        });
+        network.set_join_callback([this](const NUClearNetwork::NetworkTarget& target) {
+            std::lock_guard<std::mutex> lock(mutex);
+            joined[target.name] = &target;
+            changed.notify_all();
+        });
+        network.set_leave_callback([this](const NUClearNetwork::NetworkTarget& target) {
+            std::lock_guard<std::mutex> lock(mutex);
+            joined.erase(target.name);
+            left.push_back(target.name);
+            changed.notify_all();
+        });
+        network.set_next_event_callback([this](std::chrono::steady_clock::time_point time) {
+            std::lock_guard<std::mutex> lock(mutex);
+            events.push_back(time);
+        });
+        network.reset(name, "127.0.0.1", port, 1500, receive_sockets, 0, 0, 4096, max_mtu);
+
+        for (auto fd : network.listen_fds()) {
+            threads.emplace_back([this, fd] {
+                while (running) {
+                    pollfd event{fd, POLLIN, 0};
+                    if (::poll(&event, 1, 10) > 0) {
+                        network.process(fd);
+                    }
+                }
+            });
+        }
+
+        // Otherwise the timed work is left for the test to do
+        if (housekeeping) {
+            threads.emplace_back([this] {
+                while (running) {
+                    network.housekeeping();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                }
+            });
+        }
+    }
+
+    ~Node() {
+        running = false;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        network.shutdown();
+    }
+
+    // Wait until the predicate is true, it is checked with the node's mutex held
+    template <typename Predicate>
+    bool wait(Predicate&& predicate, std::chrono::milliseconds timeout = std::chrono::seconds(2)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, timeout, std::forward<Predicate>(predicate));
+    }
+
+    // Get everything that has been delivered so far
+    std::vector<std::pair<uint64_t, std::string>> messages() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received;
+    }
+
+    NUClearNetwork network;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::pair<uint64_t, std::string>> received;
+    std::map<std::string, const NUClearNetwork::NetworkTarget*> joined;
+    std::vector<std::string> left;
+    std::vector<std::chrono::steady_clock::time_point> events;
+
+private:
+    std::atomic<bool> running{true};
+    std::vector<std::thread> threads;
+};
+
+/// A UDP socket that speaks the NUClear protocol by hand so it can send packets a real node never would
+class RawPeer {
+public:
+    RawPeer() : fd(::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) {
+        sockaddr_in address{};
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port        = 0;
+        ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+        // Wake up often so we notice when we have waited long enough
+        timeval timeout{0, 10000};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<char*>(&timeout), sizeof(timeout));
+    }
+
+    // Announce ourself to a node and learn where to send it data from the announce it sends back
+    bool join(in_port_t port, const std::string& name) {
+        announce_packet.assign(sizeof(PacketHeader) + name.size() + 1, 0);
+        AnnouncePacket announce;
+        std::memcpy(announce_packet.data(), &announce, sizeof(PacketHeader));
+        std::memcpy(announce_packet.data() + sizeof(PacketHeader), name.data(), name.size());
+
+        announce_address.sin_family      = AF_INET;
+        announce_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        announce_address.sin_port        = htons(port);
+
+        return !receive({NUClear::extension::network::ANNOUNCE}, std::chrono::seconds(2), &node).empty();
+    }
+
+    // Send a packet to the node we joined
+    void send(const std::vector<char>& packet) {
+        ::sendto(fd, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr*>(&node), sizeof(node));
+    }
+
+    // Wait for the next packet of one of the given types, throwing away any others, empty if none arrive in time
+    std::vector<char> receive(std::initializer_list<Type> types,
+                              std::chrono::milliseconds timeout = std::chrono::seconds(2),
+                              sockaddr_in* from                 = nullptr) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::vector<char> buffer(65536);
+        while (std::chrono::steady_clock::now() < deadline) {
+
+            // Keep announcing like a real node does so we aren't timed out
+            if (announcing && std::chrono::steady_clock::now() - last_announce > std::chrono::milliseconds(500)) {
+                last_announce = std::chrono::steady_clock::now();
+                ::sendto(fd,
+                         announce_packet.data(),
+                         announce_packet.size(),
+                         0,
+                         reinterpret_cast<sockaddr*>(&announce_address),
+                         sizeof(announce_address));
+            }
+
+            sockaddr_in address{};
+            socklen_t length = sizeof(address);
+            ssize_t bytes =
+                ::recvfrom(fd, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&address), &length);
+            if (bytes >= ssize_t(sizeof(PacketHeader))) {
+                Type type = reinterpret_cast<const PacketHeader*>(buffer.data())->type;
+                if (std::find(types.begin(), types.end(), type) != types.end()) {
+                    buffer.resize(size_t(bytes));
+                    if (from != nullptr) {
+                        *from = address;
+                    }
+                    return buffer;
+                }
+            }
+        }
+        return std::vector<char>();
+    }
+
+    /// If we announce ourself while we wait for packets
+    bool announcing = true;
+
+private:
+    NUClear::util::FileDescriptor fd;
+    sockaddr_in node{};
+    std::vector<char> announce_packet;
+    sockaddr_in announce_address{};
+    std::chrono::steady_clock::time_point last_announce;
+};
+
+std::vector<char> data_packet(uint16_t id,
+                              uint32_t no,
+                              uint32_t count,
+                              bool reliable,
+                              const std::string& fragment,
+                              Type type = NUClear::extension::network::DATA) {
+    DataPacket header;
+    header.type         = type;
+    header.packet_id    = id;
+    header.packet_no    = no;
+    header.packet_count = count;
+    header.reliable     = reliable;
+    header.hash         = HASH;
+
+    std::vector<char> packet(sizeof(DataPacket) - 1 + fragment.size());
+    std::memcpy(packet.data(), &header, sizeof(DataPacket) - 1);
+    std::memcpy(packet.data() + sizeof(DataPacket) - 1, fragment.data(), fragment.size());
+    return packet;
+}
+
+// The parity of one block of an unreliable packet group, each fragment padded with zeros to the size of the first
+std::vector<char> parity_packet(uint16_t id,
+                                uint32_t block_no,
+                                uint16_t block_size,
+                                const std::vector<std::string>& fragments) {
+    ParityPacket header;
+    header.packet_id     = id;
+    header.block_no      = block_no;
+    header.block_size    = block_size;
+    header.packet_count  = uint32_t(fragments.size());
+    header.fragment_size = uint16_t(fragments.front().size());
+    header.last_size     = uint16_t(fragments.back().size());
+    header.hash          = HASH;
+
+    std::vector<char> packet(sizeof(ParityPacket) - 1 + header.fragment_size, 0);
+    std::memcpy(packet.data(), &header, sizeof(ParityPacket) - 1);
+    for (size_t i = size_t(block_no) * block_size; i < std::min(fragments.size(), size_t(block_no + 1) * block_size);
+         ++i) {
+        for (size_t j = 0; j < fragments[i].size(); ++j) {
+            packet[sizeof(ParityPacket) - 1 + j] ^= fragments[i][j];
+        }
+    }
+    return packet;
+}
+
+std::vector<char> ack_packet(uint16_t id, uint32_t no, uint32_t count) {
+    ACKPacket header;
+    header.packet_id    = id;
+    header.packet_no    = no;
+    header.packet_count = count;
+
+    // Acks are sent without their spare range
+    std::vector<char> packet(sizeof(ACKPacket) - sizeof(header.ranges));
+    std::memcpy(packet.data(), &header, packet.size());
+    return packet;
+}
+
+std::vector<char> subscribe_packet(const std::vector<uint64_t>& hashes) {
+    SubscribePacket header;
+    header.hash_count = uint32_t(hashes.size());
+
+    std::vector<char> packet(sizeof(SubscribePacket) - sizeof(uint64_t) + hashes.size() * sizeof(uint64_t));
+    std::memcpy(packet.data(), &header, sizeof(SubscribePacket) - sizeof(uint64_t));
+    std::memcpy(packet.data() + sizeof(SubscribePacket) - sizeof(uint64_t),
+                hashes.data(),
+                hashes.size() * sizeof(uint64_t));
+    return packet;
+}
+
+template <typename T>
+const T& as(const std::vector<char>& packet) {
+    return *reinterpret_cast<const T*>(packet.data());
+}
+
+}  // namespace
+
+TEST_CASE("Testing NUClearNetwork reassembles fragments in any order", "[api][network][nuclearnet][reassembly]") {
+
+    Node node("node", 40040);
+    RawPeer peer;
+    REQUIRE(peer.join(40040, "peer"));
+
+    // The short last fragment arrives first and the rest out of order, one of them twice
+    const std::vector<std::string> fragments = {"aaaaaaaa", "bbbbbbbb", "cccccccc", "dd"};
+    for (uint32_t no : {3, 1, 1, 0, 3, 2}) {
+        peer.send(data_packet(1, no, 4, false, fragments[no]));
+    }
+    REQUIRE(node.wait([&] { return node.received.size() == 1; }));
+
+    // Reliable fragments are acked with how many fragments from the start have all been received
+    const std::vector<std::pair<uint32_t, uint32_t>> acks = {{2, 0}, {0, 1}, {3, 1}, {1, 4}};
+    for (const auto& expected : acks) {
+        peer.send(data_packet(2, expected.first, 4, true, fragments[expected.first]));
+        auto ack = peer.receive({NUClear::extension::network::ACK});
+        REQUIRE(!ack.empty());
+        REQUIRE(as<ACKPacket>(ack).packet_id == 2);
+        REQUIRE(as<ACKPacket>(ack).packet_no == expected.first);
+        REQUIRE(as<ACKPacket>(ack).cumulative == expected.second);
+    }
+    REQUIRE(node.wait([&] { return node.received.size() == 2; }));
+
+    // Each group is delivered once, put back together in order
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto messages = node.messages();
+    REQUIRE(messages.size() == 2);
+    for (const auto& message : messages) {
+        REQUIRE(message.first == HASH);
+        REQUIRE(message.second == "aaaaaaaabbbbbbbbccccccccdd");
+    }
+}
+
+TEST_CASE("Testing NUClearNetwork only sends a window of reliable fragments before they are acked",
+          "[api][network][nuclearnet][congestion]") {
+
+    Node node("node", 40041);
+    RawPeer peer;
+    REQUIRE(peer.join(40041, "peer"));
+    REQUIRE(node.wait([&] { return node.joined.count("peer") == 1; }));
+
+    // Far more fragments than the first window
+    node.network.send(HASH, std::make_shared<std::vector<char>>(100000, 'c'), "peer", true);
+
+    // Until we ack something only the first window is sent
+    std::vector<char> packet;
+    std::set<uint32_t> fragments;
+    uint16_t id     = 0;
+    uint32_t count  = 0;
+    auto unacked_by = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < unacked_by) {
+        packet = peer.receive({NUClear::extension::network::DATA, NUClear::extension::network::DATA_RETRANSMISSION},
+                              std::chrono::milliseconds(20));
+        if (!packet.empty()) {
+            id    = as<DataPacket>(packet).packet_id;
+            count = as<DataPacket>(packet).packet_count;
+            fragments.insert(as<DataPacket>(packet).packet_no);
+        }
+    }
+    REQUIRE(count > 10);
+    REQUIRE(!fragments.empty());
+    REQUIRE(fragments.size() <= 10);
+
+    // Acking what arrives opens the window until all of it has been sent
+    for (uint32_t no : fragments) {
+        peer.send(ack_packet(id, no, count));
+    }
+    while (fragments.size() < count
+           && !(packet = peer.receive({NUClear::extension::network::DATA,
+                                       NUClear::extension::network::DATA_RETRANSMISSION}))
+                   .empty()) {
+        fragments.insert(as<DataPacket>(packet).packet_no);
+        peer.send(ack_packet(id, as<DataPacket>(packet).packet_no, count));
+    }
+    REQUIRE(fragments.size() == count);
+}
+
+TEST_CASE("Testing NUClearNetwork only retransmits the fragments that were not acked",
+          "[api][network][nuclearnet][retransmit]") {
+
+    Node node("node", 40042);
+    RawPeer peer;
+    REQUIRE(peer.join(40042, "peer"));
+    REQUIRE(node.wait([&] { return node.joined.count("peer") == 1; }));
+
+    // A few fragments that all fit in the first window
+    node.network.send(HASH, std::make_shared<std::vector<char>>(5000, 'r'), "peer", true);
+    std::vector<char> packet;
+    std::set<uint32_t> fragments;
+    uint16_t id    = 0;
+    uint32_t count = 0;
+    do {
+        packet = peer.receive({NUClear::extension::network::DATA});
+        REQUIRE(!packet.empty());
+        id    = as<DataPacket>(packet).packet_id;
+        count = as<DataPacket>(packet).packet_count;
+        fragments.insert(as<DataPacket>(packet).packet_no);
+    } while (fragments.size() < count);
+    REQUIRE(count == 4);
+
+    // Acking the fragments sent after the first means it was lost and it alone is sent again
+    for (uint32_t no = 1; no < count; ++no) {
+        peer.send(ack_packet(id, no, count));
+    }
+    packet = peer.receive({NUClear::extension::network::DATA_RETRANSMISSION}, std::chrono::seconds(3));
+    REQUIRE(!packet.empty());
+    REQUIRE(as<DataPacket>(packet).packet_id == id);
+    REQUIRE(as<DataPacket>(packet).packet_no == 0);
+    auto watch_until = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < watch_until) {
+        packet = peer.receive({NUClear::extension::network::DATA_RETRANSMISSION}, std::chrono::milliseconds(20));
+        if (!packet.empty()) {
+            REQUIRE(as<DataPacket>(packet).packet_no == 0);
+        }
+    }
+
+    // Once it is acked nothing more is sent
+    peer.send(ack_packet(id, 0, count));
+    while (!peer.receive({NUClear::extension::network::DATA_RETRANSMISSION}, std::chrono::milliseconds(50)).empty()) {
+    }
+    REQUIRE(peer.receive({NUClear::extension::network::DATA, NUClear::extension::network::DATA_RETRANSMISSION},
+                         std::chrono::milliseconds(300))
+                .empty());
+}
+
+TEST_CASE("Testing NUClearNetwork acks only finish the packet group they are for",
+          "[api][network][nuclearnet][sendqueue]") {
+
+    Node node("node", 40043);
+    RawPeer peer;
+    REQUIRE(peer.join(40043, "peer"));
+    REQUIRE(node.wait([&] { return node.joined.count("peer") == 1; }));
+
+    // Several reliable groups in flight at once
+    for (char c = '0'; c < '6'; ++c) {
+        node.network.send(HASH, std::make_shared<std::vector<char>>(1, c), "peer", true);
+    }
+    std::map<char, uint16_t> ids;
+    while (ids.size() < 6) {
+        auto packet = peer.receive({NUClear::extension::network::DATA});
+        REQUIRE(!packet.empty());
+        ids[as<DataPacket>(packet).data] = as<DataPacket>(packet).packet_id;
+    }
+
+    // Ack every other one
+    for (char c : {'0', '2', '4'}) {
+        peer.send(ack_packet(ids[c], 0, 1));
+    }
+
+    // The rest are sent again, and the ones we acked never are
+    std::set<char> resent;
+    while (resent.size() < 3) {
+        auto packet = peer.receive({NUClear::extension::network::DATA_RETRANSMISSION}, std::chrono::seconds(5));
+        REQUIRE(!packet.empty());
+        char c = as<DataPacket>(packet).data;
+        REQUIRE(ids[c] == as<DataPacket>(packet).packet_id);
+        REQUIRE((c == '1' || c == '3' || c == '5'));
+        resent.insert(c);
+    }
+}
+
+TEST_CASE("Testing NUClearNetwork delivers everything when receiving on several sockets",
+          "[api][network][nuclearnet][receive_sockets]") {
+
+    Node node("node", 40044, 4);
+#ifdef SO_REUSEPORT
+    // Four data sockets and the announce socket
+    REQUIRE(node.network.listen_fds().size() == 5);
+#endif
+
+    // Enough peers that the kernel spreads them across the sockets
+    std::vector<std::unique_ptr<RawPeer>> peers;
+    for (int p = 0; p < 8; ++p) {
+        peers.push_back(std::make_unique<RawPeer>());
+        REQUIRE(peers.back()->join(40044, "peer" + std::to_string(p)));
+    }
+
+    // Each of them sends single packets and a group of fragments
+    std::vector<std::string> expected;
+    for (int p = 0; p < 8; ++p) {
+        for (uint16_t id = 1; id <= 10; ++id) {
+            std::string message = "peer " + std::to_string(p) + " message " + std::to_string(id);
+            peers[p]->send(data_packet(id, 0, 1, true, message));
+            expected.push_back(message);
+        }
+        std::string message = "peer " + std::to_string(p) + " fragments";
+        for (uint32_t no = 0; no < 3; ++no) {
+            peers[p]->send(data_packet(11, no, 3, true, message.substr(no * 6, 6)));
+        }
+        expected.push_back(message);
+    }
+    REQUIRE(node.wait([&] { return node.received.size() >= expected.size(); }));
+
+    // Every message arrived once
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::vector<std::string> received;
+    for (const auto& message : node.messages()) {
+        received.push_back(message.second);
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(received.begin(), received.end());
+    REQUIRE(received == expected);
+}
+
+TEST_CASE("Testing NUClearNetwork only does its timed work when asked to",
+          "[api][network][nuclearnet][housekeeping]") {
+
+    // Nothing calls housekeeping so the only timed work is what we do
+    Node node("node", 40045, 1, 0, false);
+    RawPeer peer;
+    REQUIRE(peer.join(40045, "peer"));
+    REQUIRE(node.wait([&] { return node.joined.count("peer") == 1; }));
+    peer.announcing = false;
+
+    // Sending reliable data asks to be woken when it should be retransmitted
+    auto sent = std::chrono::steady_clock::now();
+    node.network.send(HASH, std::make_shared<std::vector<char>>(1, 'h'), "peer", true);
+    REQUIRE(!peer.receive({NUClear::extension::network::DATA}).empty());
+    std::chrono::steady_clock::time_point deadline;
+    /* Mutex scope */ {
+        std::lock_guard<std::mutex> lock(node.mutex);
+        REQUIRE(!node.events.empty());
+        deadline = node.events.back();
+    }
+    REQUIRE(deadline > sent);
+
+    // Receiving doesn't retransmit, but retransmitting once the deadline has passed does
+    REQUIRE(peer.receive({NUClear::extension::network::DATA_RETRANSMISSION}, std::chrono::milliseconds(200)).empty());
+    std::this_thread::sleep_until(deadline);
+    node.network.retransmit();
+    REQUIRE(!peer.receive({NUClear::extension::network::DATA_RETRANSMISSION}).empty());
+
+    // We have been silent long enough to time out, but are only removed when the node checks
+    std::this_thread::sleep_until(sent + std::chrono::milliseconds(2500));
+    REQUIRE(!node.wait([&] { return !node.left.empty(); }, std::chrono::milliseconds(100)));
+    node.network.check_timeouts();
+    REQUIRE(node.wait([&] { return node.left == std::vector<std::string>({"peer"}); }));
+}
+
+TEST_CASE("Testing NUClearNetwork only sends data to peers that subscribe to it",
+          "[api][network][nuclearnet][subscriptions]") {
+
+    constexpr uint64_t OTHER_HASH = HASH + 1;
+
+    // Joining a node that has subscribed tells us what it wants
+    Node node("node", 40046);
+    node.network.set_subscriptions({HASH});
+    RawPeer peer;
+    REQUIRE(peer.join(40046, "peer"));
+    REQUIRE(node.wait([&] { return node.joined.count("peer") == 1; }));
+    auto subscriptions = peer.receive({NUClear::extension::network::SUBSCRIBE});
+    REQUIRE(subscriptions.size() == sizeof(SubscribePacket));
+    REQUIRE(as<SubscribePacket>(subscriptions).hash_count == 1);
+    REQUIRE(as<SubscribePacket>(subscriptions).hashes == HASH);
+
+    // We only want the other type, once our reliable packet is acked the node has read our subscription before it
+    peer.send(subscribe_packet({OTHER_HASH}));
+    peer.send(data_packet(1, 0, 1, true, "barrier"));
+    REQUIRE(!peer.receive({NUClear::extension::network::ACK}).empty());
+
+    // Send both types directly to us and to everyone
+    for (uint64_t hash : {HASH, OTHER_HASH}) {
+        node.network.send(hash, std::make_shared<std::vector<char>>(1, 's'), "peer", false);
+        node.network.send(hash, std::make_shared<std::vector<char>>(1, 's'), "", true);
+    }
+
+    // Only the type we want arrives
+    std::vector<char> packet;
+    size_t received = 0;
+    while (!(packet = peer.receive({NUClear::extension::network::DATA}, std::chrono::milliseconds(300))).empty()) {
+        REQUIRE(as<DataPacket>(packet).hash == OTHER_HASH);
+        if (as<DataPacket>(packet).reliable) {
+            peer.send(ack_packet(as<DataPacket>(packet).packet_id, 0, 1));
+        }
+        ++received;
+    }
+    REQUIRE(received == 2);
+}
+
+TEST_CASE("Testing NUClearNetwork rebuilds a lost fragment from its parity", "[api][network][nuclearnet][parity]") {
+
+    Node node("node", 40052);
+    RawPeer peer;
+    REQUIRE(peer.join(40052, "peer"));
+
+    // Send every fragment of an unreliable group except one, then the parity of each of its blocks
+    auto send_without = [&](uint16_t id,
+                            uint16_t block_size,
+                            const std::vector<std::string>& fragments,
+                            uint32_t lost) {
+        for (uint32_t no = 0; no < fragments.size(); ++no) {
+            if (no != lost) {
+                peer.send(data_packet(id, no, uint32_t(fragments.size()), false, fragments[no]));
+            }
+        }
+        for (uint32_t block = 0; block * block_size < fragments.size(); ++block) {
+            peer.send(parity_packet(id, block, block_size, fragments));
+        }
+    };
+
+    // A fragment from the middle
+    send_without(1, 4, {"abcd", "efgh", "ij"}, 1);
+    // The short last fragment
+    send_without(2, 4, {"abcd", "efgh", "ij"}, 2);
+    // A group whose data exactly fills its fragments so the last fragment is empty
+    send_without(3, 4, {"abcd", "efgh", ""}, 0);
+    // The second of several blocks, padded with the empty last fragment
+    send_without(4, 2, {"abcd", "efgh", "ijkl", ""}, 2);
+    // Fragments of every byte value so nothing is lost when they are XORed together
+    std::vector<std::string> binary;
+    for (int i = 0; i < 4; ++i) {
+        std::string fragment;
+        for (int j = 0; j < 256; ++j) {
+            fragment.push_back(char((i * 77 + j * 13) % 256));
+        }
+        binary.push_back(fragment);
+    }
+    binary.push_back(std::string(binary.front().begin(), binary.front().begin() + 100));
+    send_without(5, 5, binary, 1);
+
+    REQUIRE(node.wait([&] { return node.received.size() == 5; }));
+    auto messages = node.messages();
+    REQUIRE(messages[0].second == "abcdefghij");
+    REQUIRE(messages[1].second == "abcdefghij");
+    REQUIRE(messages[2].second == "abcdefgh");
+    REQUIRE(messages[3].second == "abcdefghijkl");
+    std::string whole;
+    for (const auto& fragment : binary) {
+        whole += fragment;
+    }
+    REQUIRE(messages[4].second == whole);
+    for (const auto& message : messages) {
+        REQUIRE(message.first == HASH);
+    }
+}
+
+TEST_CASE("Testing NUClearNetwork throws away packet groups that need too much memory",
+          "[api][network][nuclearnet][assembler_limits]") {
+
+    Node node("node", 40047);
+    node.network.set_assembler_limits(64 * 1024, 64 * 1024);
+    RawPeer peer;
+    REQUIRE(peer.join(40047, "peer"));
+
+    // A reliable packet that is acked once the node has read everything we sent before it
+    uint16_t barrier = 100;
+    auto sync        = [&] {
+        peer.send(data_packet(++barrier, 0, 1, true, "barrier"));
+        std::vector<char> ack;
+        while (!(ack = peer.receive({NUClear::extension::network::ACK})).empty()) {
+            if (as<ACKPacket>(ack).packet_id == barrier) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // A fragment claiming to be from a group far bigger than our limits is dropped without being allocated
+    peer.send(data_packet(1, 0, std::numeric_limits<uint32_t>::max(), false, std::string(100, 'x')));
+    REQUIRE(sync());
+    REQUIRE(node.network.assembler_evictions() == 1);
+
+    // Two groups that each fit but don't fit together
+    const std::string fragment(1000, 'f');
+    peer.send(data_packet(2, 0, 40, true, fragment));
+    auto ack = peer.receive({NUClear::extension::network::ACK});
+    REQUIRE(!ack.empty());
+    REQUIRE(as<ACKPacket>(ack).packet_id == 2);
+
+    // The older group is thrown away to make room and its sender told to send it again
+    peer.send(data_packet(3, 0, 40, true, fragment));
+    auto nack = peer.receive({NUClear::extension::network::NACK});
+    REQUIRE(!nack.empty());
+    REQUIRE(as<NACKPacket>(nack).packet_id == 2);
+    REQUIRE(as<NACKPacket>(nack).packet_count == 40);
+    REQUIRE(as<NACKPacket>(nack).cumulative == 0);
+    REQUIRE(as<NACKPacket>(nack).range_count == 0);
+    REQUIRE(sync());
+    REQUIRE(node.network.assembler_evictions() == 2);
+
+    // And the newer group can still be finished
+    for (uint32_t no = 1; no < 40; ++no) {
+        peer.send(data_packet(3, no, 40, true, fragment));
+    }
+    REQUIRE(node.wait([&] {
+        return std::any_of(node.received.begin(),
+                           node.received.end(),
+                           [](const std::pair<uint64_t, std::string>& m) { return m.second.size() == 40000; });
+    }));
+    REQUIRE(node.network.assembler_evictions() == 2);
+}
+
+TEST_CASE("Testing NUClearNetwork tells the sender which fragments it still holds and waits for the rest",
+          "[api][network][nuclearnet][assembler_limits]") {
+
+    Node node("node", 40051);
+    RawPeer peer;
+    REQUIRE(peer.join(40051, "peer"));
+
+    peer.send(data_packet(7, 0, 4, true, "aaaa"));
+    REQUIRE(!peer.receive({NUClear::extension::network::ACK}).empty());
+    peer.send(data_packet(7, 1, 4, true, "bbbb"));
+    REQUIRE(!peer.receive({NUClear::extension::network::ACK}).empty());
+
+    // A fragment that doesn't fit the group throws away what came before, but the node still holds this one
+    peer.send(data_packet(7, 2, 4, true, "cc"));
+    auto nack = peer.receive({NUClear::extension::network::NACK});
+    REQUIRE(nack.size() == sizeof(NACKPacket));
+    REQUIRE(as<NACKPacket>(nack).packet_id == 7);
+    REQUIRE(as<NACKPacket>(nack).cumulative == 0);
+    REQUIRE(as<NACKPacket>(nack).range_count == 1);
+    REQUIRE(as<NACKPacket>(nack).ranges.first == 2);
+    REQUIRE(as<NACKPacket>(nack).ranges.last == 2);
+
+    // A reliable group that is slower than an unreliable one would be is not thrown away
+    peer.send(data_packet(7, 0, 4, true, "aa"));
+    peer.send(data_packet(7, 1, 4, true, "bb"));
+    peer.receive({}, std::chrono::milliseconds(1500));
+    peer.send(data_packet(7, 3, 4, true, "d"));
+
+    REQUIRE(node.wait([&] { return !node.received.empty(); }));
+    auto messages = node.messages();
+    REQUIRE(messages.size() == 1);
+    REQUIRE(messages[0].second == "aabbccd");
+}
+
+TEST_CASE("Testing NUClearNetwork delivers reliable packet groups once", "[api][network][nuclearnet][replay]") {
+
+    Node node("node", 40048);
+    RawPeer peer;
+    REQUIRE(peer.join(40048, "peer"));
+
+    // Each packet is acked every time it arrives, in case the sender missed our ack
+    auto send = [&](const std::vector<char>& packet) {
+        peer.send(packet);
+        auto ack = peer.receive({NUClear::extension::network::ACK});
+        REQUIRE(!ack.empty());
+        REQUIRE(as<ACKPacket>(ack).packet_id == as<DataPacket>(packet).packet_id);
+    };
+
+    // Repeats of a single packet and of the fragment that finished a group, which are sent as retransmissions
+    const Type repeat = NUClear::extension::network::DATA_RETRANSMISSION;
+    send(data_packet(7, 0, 1, true, "single"));
+    send(data_packet(7, 0, 1, true, "single", repeat));
+    send(data_packet(8, 0, 2, true, "fragm"));
+    send(data_packet(8, 1, 2, true, "ents"));
+    send(data_packet(8, 1, 2, true, "ents", repeat));
+
+    // More groups than the old fixed list of recent packets could remember, all of them repeated
+    for (uint16_t id = 1000; id < 1300; ++id) {
+        send(data_packet(id, 0, 1, true, std::to_string(id)));
+    }
+    for (uint16_t id = 1000; id < 1300; ++id) {
+        send(data_packet(id, 0, 1, true, std::to_string(id), repeat));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto messages = node.messages();
+    REQUIRE(messages.size() == 302);
+    REQUIRE(messages[0].second == "single");
+    REQUIRE(messages[1].second == "fragments");
+    for (size_t i = 2; i < messages.size(); ++i) {
+        REQUIRE(messages[i].second == std::to_string(1000 + i - 2));
+    }
+}
+
+TEST_CASE("Testing NUClearNetwork delivers new packet groups once packet ids wrap around",
+          "[api][network][nuclearnet][replay]") {
+
+    Node node("node", 40050);
+    RawPeer peer;
+    REQUIRE(peer.join(40050, "peer"));
+
+    auto send_reliable = [&](uint16_t id, const std::string& data) {
+        peer.send(data_packet(id, 0, 1, true, data));
+        auto ack = peer.receive({NUClear::extension::network::ACK});
+        REQUIRE(!ack.empty());
+        REQUIRE(as<ACKPacket>(ack).packet_id == id);
+    };
+
+    // Finish some groups so their ids are remembered
+    send_reliable(5, "before 5");
+    send_reliable(10, "before 10");
+
+    // Unreliable data carries the ids all the way around to just before them again
+    std::vector<std::string> expected = {"before 5", "before 10"};
+    for (uint32_t id = 1011; id < 65536; id += 1000) {
+        peer.send(data_packet(uint16_t(id), 0, 1, false, std::to_string(id)));
+        expected.push_back(std::to_string(id));
+    }
+
+    // Reusing those ids is new data, not a repeat
+    peer.send(data_packet(5, 0, 1, false, "after 5"));
+    send_reliable(10, "after 10");
+    expected.push_back("after 5");
+    expected.push_back("after 10");
+
+    REQUIRE(node.wait([&] { return node.received.size() >= expected.size(); }));
+    std::vector<std::string> received;
+    for (const auto& message : node.messages()) {
+        received.push_back(message.second);
+    }
+    REQUIRE(received == expected);
+}
+
+TEST_CASE("Testing NUClearNetwork finds the path mtu to each target", "[api][network][nuclearnet][mtu]") {
+
+    // Wait for a node to find itself and then see what mtu it settles on
+    auto path_mtu = [](Node& node, std::chrono::milliseconds timeout) {
+        REQUIRE(node.wait([&] { return node.joined.count("node") == 1; }));
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        uint16_t mtu  = 0;
+        do {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            std::lock_guard<std::mutex> lock(node.mutex);
+            mtu = node.joined["node"]->mtu;
+        } while (mtu <= 1500 && std::chrono::steady_clock::now() < deadline);
+        return mtu;
+    };
+
+    // Loopback carries datagrams far bigger than our largest search
+    SECTION("Searching up to a jumbo mtu") {
+        Node node("node", 40049, 1, 9000);
+        uint16_t mtu = path_mtu(node, std::chrono::seconds(5));
+        REQUIRE(mtu > 1500);
+        REQUIRE(mtu <= 9000);
+
+        // Data split to fit the bigger mtu still arrives whole
+        std::vector<char> data(30000);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = char(i % 251);
+        }
+        node.network.send(HASH, std::make_shared<std::vector<char>>(data), "node", true);
+        REQUIRE(node.wait([&] { return !node.received.empty(); }));
+        REQUIRE(node.messages().front().second == std::string(data.begin(), data.end()));
+    }
+
+    // Without a search we keep the mtu we were given
+    SECTION("Not searching") {
+        Node node("node", 40049, 1, 0);
+        REQUIRE(path_mtu(node, std::chrono::milliseconds(500)) == 1500);
+    }
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "nuclear_bits/extension/network/NUClearNetwork.hpp"
+
+/*
+ * Measures the throughput of the NUClear network by sending messages to ourself over loopback.
+ *
+ * Usage: test_network_benchmark [mtu] [megabytes per test] [receive sockets] [fec block size] [reassembly megabytes]
+ *                               [max path mtu]
+ *
+ * To see how well parity protects unreliable messages, add some loss to loopback first with something like
+ * `tc qdisc add dev lo root netem loss 2%`. Limiting the reassembly megabytes shows how messages are dropped when
+ * they arrive faster than they can be put back together. Giving a max path mtu searches for the largest datagram
+ * loopback carries up to that size and uses it instead of mtu.
+ */
+
+namespace {
+
+using NUClear::extension::network::NUClearNetwork;
+using clock_type = std::chrono::steady_clock;
+
+constexpr in_port_t PORT = 40030;
+const std::string NAME   = "nuclear_network_benchmark";
+
+/// Each message starts with the test it is from and its index within that test so we can spot duplicates
+struct MessageId {
+    uint32_t test;
+    uint32_t index;
+};
+
+std::atomic<const NUClearNetwork::NetworkTarget*> self(nullptr);
+
+std::mutex received_mutex;
+uint32_t current_test = 0;
+std::vector<bool> received;
+size_t received_messages  = 0;
+size_t received_bytes     = 0;
+size_t duplicate_messages = 0;
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+
+    uint16_t mtu              = argc > 1 ? uint16_t(std::stoi(argv[1])) : 1500;
+    size_t megabytes          = argc > 2 ? size_t(std::stoi(argv[2])) : 64;
+    uint16_t receive_sockets  = argc > 3 ? uint16_t(std::stoi(argv[3])) : 1;
+    uint16_t fec_block_size   = argc > 4 ? uint16_t(std::stoi(argv[4])) : 0;
+    size_t assembler_limit    = argc > 5 ? size_t(std::stoi(argv[5])) * 1024 * 1024 : 0;
+    uint16_t max_mtu          = argc > 6 ? uint16_t(std::stoi(argv[6])) : 0;
+    const size_t TOTAL        = megabytes * 1024 * 1024;
+    const size_t MAX_MESSAGES = 16384;
+    const uint64_t HASH       = 0x4e55436c65617221;
+    const auto DRAIN_TIME     = std::chrono::seconds(5);
+
+    NUClearNetwork network;
+    network.set_packet_callback([](const NUClearNetwork::NetworkTarget&,
+                                   const uint64_t&,
+                                   const bool&,
+                                   const clock_type::time_point&,
+                                   std::vector<char>&& payload) {
+        MessageId id;
+        std::memcpy(&id, payload.data(), sizeof(id));
+
+        // Ignore anything that arrives late from a previous test
+        std::lock_guard<std::mutex> lock(received_mutex);
+        if (id.test == current_test && id.index < received.size()) {
+            if (received[id.index]) {
+                ++duplicate_messages;
+            }
+            else {
+                received[id.index] = true;
+                received_bytes += payload.size();
+                ++received_messages;
+            }
+        }
+    });
+    network.set_join_callback([](const NUClearNetwork::NetworkTarget& target) {
+        if (target.name == NAME) {
+            self = &target;
+        }
+    });
+    network.set_leave_callback([](const NUClearNetwork::NetworkTarget&) {});
+    network.set_next_event_callback([](clock_type::time_point) {});
+
+    // Announce to ourself so we send all our data over loopback
+    network.reset(NAME, "127.0.0.1", PORT, mtu, receive_sockets, 0, fec_block_size, 4096, max_mtu);
+    if (assembler_limit != 0) {
+        network.set_assembler_limits(assembler_limit, assembler_limit);
+    }
+
+    // Process the network on its own thread like the IO thread would
+    std::atomic<bool> running(true);
+    std::thread receiver([&] {
+        std::vector<pollfd> fds;
+        for (auto& fd : network.listen_fds()) {
+            fds.push_back(pollfd{fd, POLLIN, 0});
+        }
+        while (running) {
+            ::poll(fds.data(), nfds_t(fds.size()), 10);
+            network.process();
+        }
+    });
+
+    // Wait until we have found ourself
+    auto start = clock_type::now();
+    while (self == nullptr && clock_type::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (self == nullptr) {
+        std::cerr << "Unable to connect to ourself over loopback" << std::endl;
+        running = false;
+        receiver.join();
+        return 1;
+    }
+
+    // Give the path mtu search a moment to finish
+    if (max_mtu != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        std::printf("path mtu %u\n", unsigned(self.load()->mtu));
+    }
+
+    std::printf("%10s %9s %9s %10s %11s %10s %12s %12s %8s\n",
+                "size",
+                "reliable",
+                "messages",
+                "delivered",
+                "duplicates",
+                "MB/s",
+                "messages/s",
+                "retransmits",
+                "evicted");
+
+    for (size_t size : {size_t(64), size_t(1024), size_t(65536), size_t(1024 * 1024)}) {
+        for (bool reliable : {false, true}) {
+
+            // Packet ids are only 16 bits so we must not have too many reliable messages in flight at once
+            size_t count = std::min(std::max(size_t(1), TOTAL / size), MAX_MESSAGES);
+
+            /* Mutex Scope */ {
+                std::lock_guard<std::mutex> lock(received_mutex);
+                ++current_test;
+                received.assign(count, false);
+                received_messages  = 0;
+                received_bytes     = 0;
+                duplicate_messages = 0;
+            }
+
+            // Make all our messages up front so we only time the network
+            std::vector<std::shared_ptr<const std::vector<char>>> payloads;
+            for (uint32_t i = 0; i < count; ++i) {
+                std::vector<char> payload(size, 'x');
+                MessageId id{current_test, i};
+                std::memcpy(payload.data(), &id, sizeof(id));
+                payloads.push_back(std::make_shared<const std::vector<char>>(std::move(payload)));
+            }
+
+            // Send all our messages as fast as we can
+            uint64_t fragments_sent          = self.load()->fragments_sent;
+            uint64_t fragments_retransmitted = self.load()->fragments_retransmitted;
+            uint64_t evicted                 = network.assembler_evictions();
+            start                            = clock_type::now();
+            for (const auto& payload : payloads) {
+                network.send(HASH, payload, NAME, reliable);
+            }
+            auto sent = clock_type::now();
+
+            // Wait for everything to arrive, or until it stops arriving
+            size_t last_received = 0;
+            auto last_progress   = clock_type::now();
+            auto end             = sent;
+            for (bool done = false; !done && clock_type::now() - last_progress < DRAIN_TIME;) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+                std::lock_guard<std::mutex> lock(received_mutex);
+                if (received_messages != last_received) {
+                    last_received = received_messages;
+                    last_progress = end = clock_type::now();
+                }
+                done = received_messages == count;
+            }
+
+            std::lock_guard<std::mutex> lock(received_mutex);
+            double seconds = std::chrono::duration<double>(end - start).count();
+            fragments_sent          = self.load()->fragments_sent - fragments_sent;
+            fragments_retransmitted = self.load()->fragments_retransmitted - fragments_retransmitted;
+            evicted                 = network.assembler_evictions() - evicted;
+            std::printf("%10zu %9s %9zu %9.1f%% %11zu %10.1f %12.0f %11.1f%% %8" PRIu64 "\n",
+                        size,
+                        reliable ? "yes" : "no",
+                        count,
+                        100.0 * double(received_messages) / double(count),
+                        duplicate_messages,
+                        double(received_bytes) / seconds / (1024.0 * 1024.0),
+                        double(received_messages) / seconds,
+                        fragments_sent == 0 ? 0.0 : 100.0 * double(fragments_retransmitted) / double(fragments_sent),
+                        evicted);
+            std::fflush(stdout);
+        }
+    }
+
+    running = false;
+    receiver.join();
+    network.shutdown();
+
+    return 0;
+}
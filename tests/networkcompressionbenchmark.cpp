@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "nuclear_bits/extension/network/NUClearNetwork.hpp"
+#include "nuclear_bits/extension/network/lz4.hpp"
+
+/*
+ * Compares sending large messages raw with compressing them first, over loopback.
+ *
+ * The messages look like the large data we send in practice. Occupancy grids are mostly the same value with a few
+ * features, and point clouds are floats with noise in their low bits. For each we report how much smaller compression
+ * makes them, how long compressing takes, and how many messages per second get through each way.
+ *
+ * Usage: test_network_compression_benchmark [messages per test]
+ */
+
+namespace {
+
+using NUClear::extension::network::NUClearNetwork;
+using clock_type = std::chrono::steady_clock;
+
+constexpr in_port_t PORT = 40032;
+const std::string NAME   = "nuclear_network_compression_benchmark";
+const uint64_t HASH      = 0x4e55436c65617223;
+
+std::atomic<const NUClearNetwork::NetworkTarget*> self(nullptr);
+std::atomic<size_t> received_messages(0);
+std::atomic<size_t> received_bytes(0);
+
+/// A 512x512 occupancy grid that is mostly unknown with some open space and walls
+std::vector<char> occupancy_grid() {
+    std::vector<char> grid(512 * 512, char(-1));
+    for (int y = 100; y < 400; ++y) {
+        for (int x = 80; x < 450; ++x) {
+            bool wall        = x == 80 || x == 449 || y == 100 || y == 399 || (x % 97 == 0 && y % 50 > 10);
+            grid[y * 512 + x] = wall ? char(100) : char(0);
+        }
+    }
+    return grid;
+}
+
+/// A point cloud of 20000 xyz floats on a noisy surface
+std::vector<char> point_cloud() {
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 0.002f);
+    std::vector<float> points;
+    for (int i = 0; i < 20000; ++i) {
+        float x = float(i % 200) * 0.01f;
+        float y = float(i / 200) * 0.01f;
+        points.push_back(x);
+        points.push_back(y);
+        points.push_back(std::sin(x) * 0.5f + noise(rng));
+    }
+    std::vector<char> out(points.size() * sizeof(float));
+    std::memcpy(out.data(), points.data(), out.size());
+    return out;
+}
+
+/// Random bytes, which can't be compressed at all
+std::vector<char> random_bytes() {
+    std::mt19937 rng(42);
+    std::vector<char> out(256 * 1024);
+    for (auto& c : out) {
+        c = char(rng());
+    }
+    return out;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+
+    size_t messages       = argc > 1 ? size_t(std::stoi(argv[1])) : 64;
+    const auto DRAIN_TIME = std::chrono::seconds(5);
+
+    NUClearNetwork network;
+    network.set_packet_callback([](const NUClearNetwork::NetworkTarget&,
+                                   const uint64_t& hash,
+                                   const bool&,
+                                   const clock_type::time_point&,
+                                   std::vector<char>&& payload) {
+        if (hash == HASH) {
+            received_bytes += payload.size();
+            ++received_messages;
+        }
+    });
+    network.set_join_callback([](const NUClearNetwork::NetworkTarget& target) {
+        if (target.name == NAME) {
+            self = &target;
+        }
+    });
+    network.set_leave_callback([](const NUClearNetwork::NetworkTarget&) {});
+    network.set_next_event_callback([](clock_type::time_point) {});
+
+    // Announce to ourself so we send all our data over loopback
+    network.reset(NAME, "127.0.0.1", PORT);
+
+    // Process the network on its own thread like the IO thread would
+    std::atomic<bool> running(true);
+    std::thread receiver([&] {
+        std::vector<pollfd> fds;
+        for (auto& fd : network.listen_fds()) {
+            fds.push_back(pollfd{fd, POLLIN, 0});
+        }
+        while (running) {
+            ::poll(fds.data(), nfds_t(fds.size()), 10);
+            network.process();
+        }
+    });
+
+    // Wait until we have found ourself
+    auto start = clock_type::now();
+    while (self == nullptr && clock_type::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (self == nullptr) {
+        std::cerr << "Unable to connect to ourself over loopback" << std::endl;
+        running = false;
+        receiver.join();
+        return 1;
+    }
+
+    std::printf("%15s %10s %8s %14s %10s %10s %10s %12s\n",
+                "data",
+                "size",
+                "ratio",
+                "compress us",
+                "compressed",
+                "delivered",
+                "MB/s",
+                "messages/s");
+
+    std::vector<std::pair<std::string, std::vector<char>>> tests = {
+        {"occupancy grid", occupancy_grid()}, {"point cloud", point_cloud()}, {"random", random_bytes()}};
+
+    for (auto& test : tests) {
+
+        auto payload = std::make_shared<const std::vector<char>>(test.second);
+
+        // Time compression on its own
+        auto c_start = clock_type::now();
+        auto block   = NUClear::extension::network::lz4::compress(payload->data(), payload->size());
+        double compress_us = std::chrono::duration<double, std::micro>(clock_type::now() - c_start).count();
+
+        for (bool compress : {false, true}) {
+            received_messages = 0;
+            received_bytes    = 0;
+
+            // Send reliably so we measure what actually gets through
+            start = clock_type::now();
+            for (size_t i = 0; i < messages; ++i) {
+                network.send(HASH, payload, NAME, true, compress);
+            }
+
+            // Wait for everything to arrive, or until it stops arriving
+            size_t last_received = 0;
+            auto last_progress   = clock_type::now();
+            auto end             = last_progress;
+            while (received_messages < messages && clock_type::now() - last_progress < DRAIN_TIME) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                if (received_messages != last_received) {
+                    last_received = received_messages;
+                    last_progress = end = clock_type::now();
+                }
+            }
+
+            double seconds = std::chrono::duration<double>(end - start).count();
+            std::printf("%15s %10zu %8.2f %14.0f %10s %9.1f%% %10.1f %12.1f\n",
+                        test.first.c_str(),
+                        payload->size(),
+                        double(payload->size()) / double(block.size()),
+                        compress_us,
+                        compress ? "yes" : "no",
+                        100.0 * double(received_messages) / double(messages),
+                        double(received_bytes) / seconds / (1024.0 * 1024.0),
+                        double(received_messages) / seconds);
+            std::fflush(stdout);
+        }
+    }
+
+    running = false;
+    receiver.join();
+    network.shutdown();
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2013      Trent Houliston <trent@houliston.me>, Jake Woods <jake.f.woods@gmail.com>
+ *               2014-2017 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <poll.h>
+#include <ctime>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "nuclear_bits/extension/network/NUClearNetwork.hpp"
+
+/*
+ * Measures how much work the sender does to deliver reliable messages to many peers at once.
+ *
+ * Every peer is its own NUClearNetwork in this process, found using multicast announces. The sender sends reliable
+ * messages to everyone, so it must process an ACK from every peer for every packet it sends. We report how long it
+ * took and how much CPU time the sender's network thread used.
+ *
+ * Usage: test_network_peers_benchmark [peers] [messages per test]
+ */
+
+namespace {
+
+using NUClear::extension::network::NUClearNetwork;
+using clock_type = std::chrono::steady_clock;
+
+const std::string ADDRESS = "239.226.152.162";
+constexpr in_port_t PORT  = 40031;
+const std::string SENDER  = "nuclear_peers_benchmark_sender";
+const std::string PEER    = "nuclear_peers_benchmark_peer";
+constexpr uint64_t HASH   = 0x4e55436c65617222;
+
+/// How much CPU time the calling thread has used
+double thread_cpu_seconds() {
+    timespec ts{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return double(ts.tv_sec) + double(ts.tv_nsec) * 1e-9;
+}
+
+/// A network and the thread that processes it
+struct Node {
+    NUClearNetwork network;
+    std::thread thread;
+    std::atomic<size_t> received{0};
+    std::atomic<double> cpu_seconds{0.0};
+};
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+
+    size_t peers    = argc > 1 ? size_t(std::stoi(argv[1])) : 30;
+    size_t messages = argc > 2 ? size_t(std::stoi(argv[2])) : 512;
+    const auto DRAIN_TIME = std::chrono::seconds(5);
+
+    std::atomic<bool> running(true);
+    std::atomic<size_t> joined(0);
+
+    // Make our sender and all our peers
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (size_t i = 0; i <= peers; ++i) {
+        nodes.push_back(std::make_unique<Node>());
+        Node& node = *nodes.back();
+
+        node.network.set_packet_callback([&node](const NUClearNetwork::NetworkTarget&,
+                                                 const uint64_t& hash,
+                                                 const bool&,
+                                                 const clock_type::time_point&,
+                                                 std::vector<char>&&) {
+            if (hash == HASH) {
+                ++node.received;
+            }
+        });
+        node.network.set_join_callback([i, &joined](const NUClearNetwork::NetworkTarget& target) {
+            if (i == 0 && target.name.compare(0, PEER.size(), PEER) == 0) {
+                ++joined;
+            }
+        });
+        node.network.set_leave_callback([](const NUClearNetwork::NetworkTarget&) {});
+        node.network.set_next_event_callback([](clock_type::time_point) {});
+        node.network.reset(i == 0 ? SENDER : PEER + std::to_string(i), ADDRESS, PORT);
+    }
+
+    // Process each network on its own thread like the IO thread would
+    for (auto& n : nodes) {
+        Node& node = *n;
+        node.thread = std::thread([&node, &running] {
+            std::vector<pollfd> fds;
+            for (auto& fd : node.network.listen_fds()) {
+                fds.push_back(pollfd{fd, POLLIN, 0});
+            }
+            while (running) {
+                ::poll(fds.data(), nfds_t(fds.size()), 10);
+                node.network.process();
+                node.cpu_seconds = thread_cpu_seconds();
+            }
+        });
+    }
+
+    // Wait until the sender has found all the peers
+    auto start = clock_type::now();
+    while (joined < peers && clock_type::now() - start < std::chrono::seconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    int result = 0;
+    if (joined < peers) {
+        std::cerr << "Only found " << joined << " of " << peers << " peers using multicast" << std::endl;
+        result = 1;
+    }
+    else {
+        std::printf("%6s %10s %9s %10s %10s %10s %14s\n",
+                    "peers",
+                    "size",
+                    "messages",
+                    "delivered",
+                    "seconds",
+                    "MB/s",
+                    "sender cpu ms");
+
+        for (size_t size : {size_t(64), size_t(8192), size_t(65536)}) {
+
+            // Reset our counters
+            for (size_t i = 1; i < nodes.size(); ++i) {
+                nodes[i]->received = 0;
+            }
+            auto payload = std::make_shared<const std::vector<char>>(size, 'x');
+            double cpu   = nodes[0]->cpu_seconds;
+
+            // Send reliably to everyone
+            start = clock_type::now();
+            for (size_t i = 0; i < messages; ++i) {
+                nodes[0]->network.send(HASH, payload, "", true);
+            }
+
+            // Wait for everything to arrive, or until it stops arriving
+            size_t total         = 0;
+            size_t last_total    = 0;
+            auto last_progress   = clock_type::now();
+            auto end             = last_progress;
+            while (total < peers * messages && clock_type::now() - last_progress < DRAIN_TIME) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+                total = 0;
+                for (size_t i = 1; i < nodes.size(); ++i) {
+                    total += nodes[i]->received;
+                }
+                if (total != last_total) {
+                    last_total    = total;
+                    last_progress = end = clock_type::now();
+                }
+            }
+
+            double seconds = std::chrono::duration<double>(end - start).count();
+            std::printf("%6zu %10zu %9zu %9.1f%% %10.3f %10.1f %14.1f\n",
+                        peers,
+                        size,
+                        messages,
+                        100.0 * double(total) / double(peers * messages),
+                        seconds,
+                        double(total * size) / seconds / (1024.0 * 1024.0),
+                        (nodes[0]->cpu_seconds - cpu) * 1000.0);
+            std::fflush(stdout);
+        }
+    }
+
+    running = false;
+    for (auto& node : nodes) {
+        node->thread.join();
+        node->network.shutdown();
+    }
+
+    return result;
+}